@@ -18,9 +18,14 @@
 #define DISTRIBUTED_POINT_FUNCTIONS_DCF_DISTRIBUTED_COMPARISON_FUNCTION_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/meta/type_traits.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "dcf/distributed_comparison_function.pb.h"
 #include "dpf/distributed_point_function.h"
 #include "dpf/distributed_point_function.pb.h"
@@ -43,19 +48,40 @@ class DistributedComparisonFunction {
   absl::StatusOr<std::pair<DcfKey, DcfKey>> GenerateKeys(absl::uint128 alpha,
                                                          const Value& beta);
 
-  // Template for automatic conversion to Value proto. Disabled if the argument
-  // is convertible to `absl::uint128` or `Value` to make overloading
-  // unambiguous.
+  // Template for native beta types. Disabled if the argument is convertible
+  // to `Value` to make overloading unambiguous. Unlike the `Value` overload,
+  // this dispatches the per-level value corrections at compile time via the
+  // typed DPF key generation, so no `Value` protos are built for the
+  // log_domain_size levels and no value-correction map lookups happen. Prefer
+  // it when generating keys in bulk.
   template <typename T, typename = absl::enable_if_t<
                             !std::is_convertible<T, Value>::value &&
                             is_supported_type_v<T>>>
   absl::StatusOr<std::pair<DcfKey, DcfKey>> GenerateKeys(absl::uint128 alpha,
                                                          const T& beta) {
-    absl::StatusOr<Value> value = dpf_->ToValue(beta);
-    if (!value.ok()) {
-      return value.status();
+    const int log_domain_size = parameters_.parameters().log_domain_size();
+    std::vector<T> dpf_values(log_domain_size, beta);
+    for (int i = 0; i < log_domain_size; ++i) {
+      // beta_i = 0 if alpha_i == 0, and beta otherwise.
+      bool current_bit =
+          (alpha & (absl::uint128{1} << (log_domain_size - i - 1))) != 0;
+      if (!current_bit) {
+        dpf_values[i] = T{};
+      }
     }
-    return GenerateKeys(alpha, *value);
+
+    absl::StatusOr<std::pair<DpfKey, DpfKey>> keys =
+        dpf_->GenerateKeysIncrementalTyped<T>(
+            alpha >> 1,  // We can ignore the last bit of alpha, since it is
+                         // encoded in dpf_values.back().
+            dpf_values);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    std::pair<DcfKey, DcfKey> result;
+    *(result.first.mutable_key()) = std::move(keys->first);
+    *(result.second.mutable_key()) = std::move(keys->second);
+    return result;
   }
 
   // Evaluates a DcfKey at the given point `x`.
@@ -65,6 +91,19 @@ class DistributedComparisonFunction {
   template <typename T>
   absl::StatusOr<T> Evaluate(const DcfKey& key, absl::uint128 x);
 
+  // Evaluates a DcfKey at every element of `xs` in a single descent through
+  // the underlying incremental DPF tree: the key is validated once, and each
+  // hierarchy level is evaluated for the whole batch with one call, reusing
+  // the partial evaluations of the previous level. This is much faster than
+  // calling `Evaluate` in a loop, which re-descends from the root for every
+  // level of every x.
+  //
+  // Returns INVALID_ARGUMENT if `key` or any element of `xs` do not match the
+  // parameters passed at construction.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> BatchEvaluate(
+      const DcfKey& key, absl::Span<const absl::uint128> xs) const;
+
   // DistributedComparisonFunction is neither copyable nor movable.
   DistributedComparisonFunction(const DistributedComparisonFunction&) = delete;
   DistributedComparisonFunction& operator=(
@@ -106,6 +145,83 @@ absl::StatusOr<T> DistributedComparisonFunction::Evaluate(const DcfKey& key,
   return result;
 }
 
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedComparisonFunction::BatchEvaluate(
+    const DcfKey& key, absl::Span<const absl::uint128> xs) const {
+  const int log_domain_size = parameters_.parameters().log_domain_size();
+  const auto num_evaluations = static_cast<int64_t>(xs.size());
+  std::vector<T> result(num_evaluations);
+  if (num_evaluations == 0) {
+    return result;
+  }
+
+  // Check if `xs` are inside the domain.
+  absl::uint128 max_evaluation_point = absl::Uint128Max();
+  if (log_domain_size < 128) {
+    max_evaluation_point = (absl::uint128{1} << log_domain_size) - 1;
+  }
+  for (int64_t j = 0; j < num_evaluations; ++j) {
+    if (xs[j] > max_evaluation_point) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("`xs[", j, "]` larger than the domain size"));
+    }
+  }
+
+  // Validate `key` once. The per-level prefixes are validated by
+  // `EvaluateUntil` below.
+  absl::StatusOr<EvaluationState> state =
+      dpf_->CreateEvaluationState(key.key());
+  if (!state.ok()) {
+    return state.status();
+  }
+
+  // The first hierarchy level has a single-element domain. Its value
+  // contributes to every x whose most significant bit is 0.
+  EvaluationScratch scratch;
+  std::vector<T> dpf_evaluation(1);
+  absl::Status status = dpf_->EvaluateUntil<T>(
+      0, {}, *state, absl::MakeSpan(dpf_evaluation), scratch);
+  if (!status.ok()) {
+    return status;
+  }
+  for (int64_t j = 0; j < num_evaluations; ++j) {
+    if ((xs[j] & (absl::uint128{1} << (log_domain_size - 1))) == 0) {
+      result[j] += dpf_evaluation[0];
+    }
+  }
+
+  // Descend one level at a time. At level i, pass the level-(i-1) prefixes of
+  // all xs, so each call expands exactly one tree level for the whole batch
+  // and `state` keeps the partial evaluations for the next level.
+  std::vector<absl::uint128> prefixes(num_evaluations);
+  dpf_evaluation.resize(2 * num_evaluations);
+  for (int i = 1; i < log_domain_size; ++i) {
+    for (int64_t j = 0; j < num_evaluations; ++j) {
+      prefixes[j] = 0;
+      if (log_domain_size - i + 1 < 128) {
+        prefixes[j] = xs[j] >> (log_domain_size - i + 1);
+      }
+    }
+    status = dpf_->EvaluateUntil<T>(i, prefixes, *state,
+                                    absl::MakeSpan(dpf_evaluation), scratch);
+    if (!status.ok()) {
+      return status;
+    }
+    for (int64_t j = 0; j < num_evaluations; ++j) {
+      // The expansion of each prefix contains both of its children; select
+      // the one on the path to xs[j].
+      const int path_bit = static_cast<int>(
+          (xs[j] & (absl::uint128{1} << (log_domain_size - i))) != 0);
+      const int current_bit = static_cast<int>(
+          (xs[j] & (absl::uint128{1} << (log_domain_size - i - 1))) != 0);
+      if (current_bit == 0) {
+        result[j] += dpf_evaluation[2 * j + path_bit];
+      }
+    }
+  }
+  return result;
+}
+
 }  // namespace distributed_point_functions
 
 #endif  // DISTRIBUTED_POINT_FUNCTIONS_DCF_DISTRIBUTED_COMPARISON_FUNCTION_H_
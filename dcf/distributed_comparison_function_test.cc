@@ -121,6 +121,61 @@ TYPED_TEST(DcfTest, GenEval) {
   }
 }
 
+TYPED_TEST(DcfTest, BatchEvaluateMatchesEvaluate) {
+  using ValueType = typename TypeParam::ValueType;
+  const absl::uint128 domain_size = absl::uint128{1}
+                                    << TypeParam::kLogDomainSize;
+  ValueType beta;
+  SetTo42(beta);
+  const absl::uint128 alpha = domain_size / 2;
+  DcfKey key_0, key_1;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, key_1),
+                           this->dcf_->GenerateKeys(alpha, beta));
+
+  std::vector<absl::uint128> xs(static_cast<int64_t>(domain_size));
+  for (int64_t i = 0; i < static_cast<int64_t>(domain_size); ++i) {
+    xs[i] = i;
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> batch_0,
+      this->dcf_->template BatchEvaluate<ValueType>(key_0, xs));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> batch_1,
+      this->dcf_->template BatchEvaluate<ValueType>(key_1, xs));
+  ASSERT_EQ(batch_0.size(), xs.size());
+  ASSERT_EQ(batch_1.size(), xs.size());
+
+  for (int64_t i = 0; i < static_cast<int64_t>(domain_size); ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        ValueType result_0,
+        this->dcf_->template Evaluate<ValueType>(key_0, xs[i]));
+    EXPECT_EQ(batch_0[i], result_0) << "x=" << xs[i];
+    if (xs[i] < alpha) {
+      EXPECT_EQ(ValueType(batch_0[i] + batch_1[i]), beta) << "x=" << xs[i];
+    } else {
+      EXPECT_EQ(ValueType(batch_0[i] + batch_1[i]), ValueType{})
+          << "x=" << xs[i];
+    }
+  }
+}
+
+TEST(DcfTest, BatchEvaluateFailsOnOutOfRangeEvaluationPoint) {
+  DcfParameters parameters;
+  parameters.mutable_parameters()->set_log_domain_size(5);
+  *(parameters.mutable_parameters()->mutable_value_type()) =
+      ToValueType<uint32_t>();
+  DPF_ASSERT_OK_AND_ASSIGN(auto dcf,
+                           DistributedComparisonFunction::Create(parameters));
+  DcfKey key_0, key_1;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, key_1),
+                           dcf->GenerateKeys(23, uint32_t{42}));
+
+  std::vector<absl::uint128> xs = {0, absl::uint128{1} << 5};
+  EXPECT_THAT(dcf->BatchEvaluate<uint32_t>(key_0, xs),
+              dpf_internal::StatusIs(absl::StatusCode::kInvalidArgument,
+                                     "`xs[1]` larger than the domain size"));
+}
+
 TEST(DcfTest, WorksCorrectlyOnUint64TWithLargeDomain) {
   using ValueType = uint64_t;
   const absl::uint128 domain_size = absl::uint128{1} << 64;
@@ -173,6 +228,23 @@ TEST(DcfTest, WorksCorrectlyOnUint64TWithLargeDomain) {
           << "x=" << evaluation_points[i] << ", alpha=" << alpha;
     }
   }
+
+  // BatchEvaluate must match point-wise evaluation on the same points.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> batch_0,
+      dcf->BatchEvaluate<ValueType>(key_0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> batch_1,
+      dcf->BatchEvaluate<ValueType>(key_1, evaluation_points));
+  for (int i = 0; i < kNumEvaluationPoints; ++i) {
+    if (evaluation_points[i] < alpha) {
+      EXPECT_EQ(ValueType(batch_0[i] + batch_1[i]), beta)
+          << "x=" << evaluation_points[i] << ", alpha=" << alpha;
+    } else {
+      EXPECT_EQ(ValueType(batch_0[i] + batch_1[i]), ValueType{})
+          << "x=" << evaluation_points[i] << ", alpha=" << alpha;
+    }
+  }
 }
 
 }  // namespace
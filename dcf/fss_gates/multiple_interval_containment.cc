@@ -14,14 +14,17 @@
 
 #include "dcf/fss_gates/multiple_interval_containment.h"
 
+#include <memory>
+#include <string>
 #include <utility>
 
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "dcf/distributed_comparison_function.h"
 #include "dcf/fss_gates/multiple_interval_containment.pb.h"
-#include "dcf/fss_gates/prng/basic_rng.h"
+#include "dcf/fss_gates/prng/buffered_aes_ctr_prng.h"
 #include "dpf/distributed_point_function.pb.h"
 #include "dpf/status_macros.h"
 
@@ -147,6 +150,12 @@ absl::StatusOr<std::pair<MicKey, MicKey>> MultipleIntervalContainmentGate::Gen(
   *(k0.mutable_dcfkey()) = key_0;
   *(k1.mutable_dcfkey()) = key_1;
 
+  // Seed a buffered counter-mode PRNG once for all intervals, instead of
+  // calling into OpenSSL for every output mask share.
+  DPF_ASSIGN_OR_RETURN(std::string seed, BufferedAesCtrPrng::GenerateSeed());
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<BufferedAesCtrPrng> rng,
+                       BufferedAesCtrPrng::Create(seed));
+
   // Line 3
   for (int i = 0; i < mic_parameters_.intervals_size(); i++) {
     absl::uint128 p = absl::MakeUint128(
@@ -174,9 +183,6 @@ absl::StatusOr<std::pair<MicKey, MicKey>> MultipleIntervalContainmentGate::Gen(
         (alpha_q_prime > q_prime ? 1 : 0) + (alpha_q == (N - 1) ? 1 : 0);
     z = z % N;
 
-    const absl::string_view kSampleSeed = absl::string_view();
-    DPF_ASSIGN_OR_RETURN(
-        auto rng, distributed_point_functions::BasicRng::Create(kSampleSeed));
     DPF_ASSIGN_OR_RETURN(absl::uint128 z_0, rng->Rand128());
 
     z_0 = z_0 % N;
@@ -274,5 +280,76 @@ MultipleIntervalContainmentGate::Eval(MicKey k, absl::uint128 x) {
   return res;
 }
 
+absl::StatusOr<std::vector<std::vector<absl::uint128>>>
+MultipleIntervalContainmentGate::BatchEval(const MicKey& k,
+                                           absl::Span<const absl::uint128> xs) {
+  // Setting N = 2 ^ log_group_size
+  absl::uint128 N = absl::uint128(1) << mic_parameters_.log_group_size();
+
+  // Checking whether each x is a group element
+  for (const absl::uint128 x : xs) {
+    if (x < 0 || x >= N) {
+      return absl::InvalidArgumentError(
+          "Masked input should be between 0 and 2^log_group_size");
+    }
+  }
+
+  const int num_intervals = mic_parameters_.intervals_size();
+  const auto num_evaluations = static_cast<int64_t>(xs.size());
+
+  // Parse the interval bounds once, instead of per evaluated point.
+  std::vector<absl::uint128> p(num_intervals), q(num_intervals),
+      q_prime(num_intervals);
+  for (int i = 0; i < num_intervals; i++) {
+    p[i] = absl::MakeUint128(
+        mic_parameters_.intervals(i).lower_bound().value_uint128().high(),
+        mic_parameters_.intervals(i).lower_bound().value_uint128().low());
+    q[i] = absl::MakeUint128(
+        mic_parameters_.intervals(i).upper_bound().value_uint128().high(),
+        mic_parameters_.intervals(i).upper_bound().value_uint128().low());
+    q_prime[i] = (q[i] + 1) % N;
+  }
+
+  // Collect the shifted DCF inputs of all intervals and all xs (Lines 3-4 of
+  // https://eprint.iacr.org/2020/1392 Fig. 14 Eval), and evaluate them in one
+  // batched DCF descent.
+  std::vector<absl::uint128> dcf_inputs;
+  dcf_inputs.reserve(num_evaluations * 2 * num_intervals);
+  for (int64_t j = 0; j < num_evaluations; ++j) {
+    for (int i = 0; i < num_intervals; i++) {
+      dcf_inputs.push_back((xs[j] + N - 1 - p[i]) % N);
+      dcf_inputs.push_back((xs[j] + N - 1 - q_prime[i]) % N);
+    }
+  }
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<absl::uint128> dcf_outputs,
+      dcf_->BatchEvaluate<absl::uint128>(k.dcfkey(), dcf_inputs));
+
+  // Combine the DCF outputs with the output mask shares (Line 7).
+  std::vector<std::vector<absl::uint128>> res(num_evaluations);
+  for (int64_t j = 0; j < num_evaluations; ++j) {
+    res[j].reserve(num_intervals);
+    for (int i = 0; i < num_intervals; i++) {
+      absl::uint128 s_p = dcf_outputs[(j * num_intervals + i) * 2] % N;
+      absl::uint128 s_q_prime =
+          dcf_outputs[(j * num_intervals + i) * 2 + 1] % N;
+
+      absl::uint128 z =
+          absl::MakeUint128(k.output_mask_share(i).value_uint128().high(),
+                            k.output_mask_share(i).value_uint128().low());
+
+      absl::uint128 y = (k.dcfkey().key().party()
+                             ? ((xs[j] > p[i] ? 1 : 0) -
+                                (xs[j] > q_prime[i] ? 1 : 0))
+                             : 0) -
+                        s_p + s_q_prime + z;
+
+      res[j].push_back(y % N);
+    }
+  }
+
+  return res;
+}
+
 }  // namespace fss_gates
 }  // namespace distributed_point_functions
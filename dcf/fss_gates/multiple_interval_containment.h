@@ -18,6 +18,7 @@
 
 #include "absl/numeric/int128.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "dcf/distributed_comparison_function.h"
 #include "dcf/fss_gates/multiple_interval_containment.pb.h"
 #include "dpf/status_macros.h"
@@ -72,6 +73,17 @@ class MultipleIntervalContainmentGate {
   // and needs to be interpreted as an element in the output group Z_{2 ^ n}.
   absl::StatusOr<std::vector<absl::uint128>> Eval(MicKey k, absl::uint128 x);
 
+  // As `Eval`, but evaluates `k` on every element of `xs` at once. The i-th
+  // element of the result is the output of `Eval(k, xs[i])`. All shifted DCF
+  // inputs of all intervals and all xs are evaluated in a single batched DCF
+  // descent, which shares the tree traversal between inputs whose paths
+  // coincide in their upper bits and batches the AES calls of each level. The
+  // key is also taken by reference and parsed once, instead of being copied
+  // and re-validated per point. This is much faster than calling `Eval` in a
+  // loop.
+  absl::StatusOr<std::vector<std::vector<absl::uint128>>> BatchEval(
+      const MicKey& k, absl::Span<const absl::uint128> xs);
+
  private:
   // Parameters needed for specifying a Multiple Interval Containment Gate.
   const MicParameters mic_parameters_;
@@ -0,0 +1,143 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "dcf/fss_gates/multiple_interval_containment.h"
+#include "dcf/fss_gates/multiple_interval_containment.pb.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+namespace {
+
+// Returns MIC parameters over Z_{2^log_group_size} with `num_intervals`
+// equal-width intervals covering the whole group.
+MicParameters MakeParameters(int log_group_size, int num_intervals) {
+  MicParameters parameters;
+  parameters.set_log_group_size(log_group_size);
+  const absl::uint128 interval_width =
+      (absl::uint128{1} << log_group_size) / num_intervals;
+  for (int i = 0; i < num_intervals; ++i) {
+    const absl::uint128 lower = i * interval_width;
+    const absl::uint128 upper = lower + interval_width - 1;
+    Interval* interval = parameters.add_intervals();
+    interval->mutable_lower_bound()->mutable_value_uint128()->set_high(
+        absl::Uint128High64(lower));
+    interval->mutable_lower_bound()->mutable_value_uint128()->set_low(
+        absl::Uint128Low64(lower));
+    interval->mutable_upper_bound()->mutable_value_uint128()->set_high(
+        absl::Uint128High64(upper));
+    interval->mutable_upper_bound()->mutable_value_uint128()->set_low(
+        absl::Uint128Low64(upper));
+  }
+  return parameters;
+}
+
+// Returns `size` random elements of Z_{2^log_group_size}.
+std::vector<absl::uint128> RandomGroupElements(int log_group_size, int size) {
+  absl::BitGen rng;
+  const absl::uint128 group_mask = (absl::uint128{1} << log_group_size) - 1;
+  std::vector<absl::uint128> result(size);
+  for (auto& element : result) {
+    element = absl::Uniform<absl::uint128>(rng) & group_mask;
+  }
+  return result;
+}
+
+// Benchmarks MIC key generation. Arguments: log_group_size, number of
+// intervals.
+void BM_MicGen(benchmark::State& state) {
+  const int log_group_size = state.range(0);
+  const int num_intervals = state.range(1);
+  std::unique_ptr<MultipleIntervalContainmentGate> gate =
+      MultipleIntervalContainmentGate::Create(
+          MakeParameters(log_group_size, num_intervals))
+          .value();
+
+  const absl::uint128 r_in = RandomGroupElements(log_group_size, 1)[0];
+  const std::vector<absl::uint128> r_out =
+      RandomGroupElements(log_group_size, num_intervals);
+  for (auto s : state) {
+    std::pair<MicKey, MicKey> keys = gate->Gen(r_in, r_out).value();
+    benchmark::DoNotOptimize(keys);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MicGen)->ArgsProduct({{16, 32, 64}, {1, 4, 16, 64, 256}});
+
+// Benchmarks single-point MIC evaluation. Arguments: log_group_size, number
+// of intervals.
+void BM_MicEval(benchmark::State& state) {
+  const int log_group_size = state.range(0);
+  const int num_intervals = state.range(1);
+  std::unique_ptr<MultipleIntervalContainmentGate> gate =
+      MultipleIntervalContainmentGate::Create(
+          MakeParameters(log_group_size, num_intervals))
+          .value();
+
+  const absl::uint128 r_in = RandomGroupElements(log_group_size, 1)[0];
+  const std::vector<absl::uint128> r_out =
+      RandomGroupElements(log_group_size, num_intervals);
+  MicKey key;
+  std::tie(key, std::ignore) = gate->Gen(r_in, r_out).value();
+
+  const absl::uint128 group_mask = (absl::uint128{1} << log_group_size) - 1;
+  absl::uint128 x = 0;
+  for (auto s : state) {
+    std::vector<absl::uint128> evaluation = gate->Eval(key, x).value();
+    x = (x + 1) & group_mask;
+    benchmark::DoNotOptimize(evaluation);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MicEval)->ArgsProduct({{16, 32, 64}, {1, 4, 16, 64, 256}});
+
+// Benchmarks batched MIC evaluation. Arguments: log_group_size, number of
+// intervals, batch size. Items processed counts evaluated points, so the
+// items/sec counter is directly comparable with `BM_MicEval`.
+void BM_MicBatchEval(benchmark::State& state) {
+  const int log_group_size = state.range(0);
+  const int num_intervals = state.range(1);
+  const int batch_size = state.range(2);
+  std::unique_ptr<MultipleIntervalContainmentGate> gate =
+      MultipleIntervalContainmentGate::Create(
+          MakeParameters(log_group_size, num_intervals))
+          .value();
+
+  const absl::uint128 r_in = RandomGroupElements(log_group_size, 1)[0];
+  const std::vector<absl::uint128> r_out =
+      RandomGroupElements(log_group_size, num_intervals);
+  MicKey key;
+  std::tie(key, std::ignore) = gate->Gen(r_in, r_out).value();
+
+  const std::vector<absl::uint128> xs =
+      RandomGroupElements(log_group_size, batch_size);
+  for (auto s : state) {
+    std::vector<std::vector<absl::uint128>> evaluation =
+        gate->BatchEval(key, xs).value();
+    benchmark::DoNotOptimize(evaluation);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_MicBatchEval)
+    ->ArgsProduct({{16, 64}, {1, 16, 256}, {16, 256, 4096}});
+
+}  // namespace
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
@@ -0,0 +1,103 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/fss_gates/prng/buffered_aes_ctr_prng.h"
+
+#include <openssl/rand.h>
+
+#include <cstring>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+constexpr int kSeedLengthBytes = sizeof(absl::uint128);
+
+}  // namespace
+
+BufferedAesCtrPrng::BufferedAesCtrPrng(Aes128FixedKeyHash aes)
+    : aes_(std::move(aes)),
+      buffer_(kRefillBlocks),
+      counter_(0),
+      // Start with an exhausted buffer, so the first call to Rand refills.
+      position_(kRefillBlocks * static_cast<int64_t>(sizeof(absl::uint128))) {}
+
+absl::StatusOr<std::unique_ptr<BufferedAesCtrPrng>> BufferedAesCtrPrng::Create(
+    absl::string_view seed) {
+  if (static_cast<int>(seed.size()) != SeedLength()) {
+    return absl::InvalidArgumentError(
+        "`seed` must have exactly `SeedLength()` bytes");
+  }
+  absl::uint128 key;
+  std::memcpy(&key, seed.data(), kSeedLengthBytes);
+  DPF_ASSIGN_OR_RETURN(Aes128FixedKeyHash aes,
+                       Aes128FixedKeyHash::Create(key));
+  return absl::WrapUnique(new BufferedAesCtrPrng(std::move(aes)));
+}
+
+absl::Status BufferedAesCtrPrng::Refill() {
+  for (int i = 0; i < kRefillBlocks; ++i) {
+    buffer_[i] = counter_ + i;
+  }
+  // Evaluating in place is safe, as `Evaluate` copies its input.
+  DPF_RETURN_IF_ERROR(
+      aes_.Evaluate(absl::MakeConstSpan(buffer_), absl::MakeSpan(buffer_)));
+  counter_ += kRefillBlocks;
+  position_ = 0;
+  return absl::OkStatus();
+}
+
+template <typename T>
+absl::StatusOr<T> BufferedAesCtrPrng::Rand() {
+  constexpr auto kBufferSizeBytes =
+      kRefillBlocks * static_cast<int64_t>(sizeof(absl::uint128));
+  if (position_ + static_cast<int64_t>(sizeof(T)) > kBufferSizeBytes) {
+    DPF_RETURN_IF_ERROR(Refill());
+  }
+  T result;
+  std::memcpy(&result, reinterpret_cast<const char*>(buffer_.data()) + position_,
+              sizeof(T));
+  position_ += sizeof(T);
+  return result;
+}
+
+absl::StatusOr<uint8_t> BufferedAesCtrPrng::Rand8() { return Rand<uint8_t>(); }
+
+absl::StatusOr<uint64_t> BufferedAesCtrPrng::Rand64() {
+  return Rand<uint64_t>();
+}
+
+absl::StatusOr<absl::uint128> BufferedAesCtrPrng::Rand128() {
+  return Rand<absl::uint128>();
+}
+
+absl::StatusOr<std::string> BufferedAesCtrPrng::GenerateSeed() {
+  std::string seed(kSeedLengthBytes, '\0');
+  int success = RAND_bytes(reinterpret_cast<uint8_t*>(&seed[0]), seed.size());
+  if (!success) {
+    return absl::InternalError(
+        "BufferedAesCtrPrng::GenerateSeed - Failed to create randomness");
+  }
+  return seed;
+}
+
+int BufferedAesCtrPrng::SeedLength() { return kSeedLengthBytes; }
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,95 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PRNG_BUFFERED_AES_CTR_PRNG_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PRNG_BUFFERED_AES_CTR_PRNG_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dcf/fss_gates/prng/prng.h"
+#include "dpf/aes_128_fixed_key_hash.h"
+
+namespace distributed_point_functions {
+
+// A SecurePrng that is seeded once and then expands the seed in counter mode
+// with AES (via Aes128FixedKeyHash keyed by the seed). Randomness is generated
+// in 4 KiB blocks and served from a buffer, so unlike BasicRng, sampling does
+// not call into OpenSSL's RAND_bytes for every 8/64/128-bit draw. Use this for
+// randomness drawn in tight loops, such as FSS gate key generation.
+//
+// Unlike BasicRng, BufferedAesCtrPrng is deterministic given the seed: two
+// instances created from the same seed produce the same stream.
+//
+// BufferedAesCtrPrng is not thread-safe.
+class BufferedAesCtrPrng : public SecurePrng {
+ public:
+  // Creates a BufferedAesCtrPrng from `seed`, which must be exactly
+  // `SeedLength()` bytes.
+  //
+  // Returns INVALID_ARGUMENT if `seed` has the wrong size, or INTERNAL in
+  // case of OpenSSL errors.
+  static absl::StatusOr<std::unique_ptr<BufferedAesCtrPrng>> Create(
+      absl::string_view seed);
+
+  // Samples 8, 64, or 128 bits of pseudorandomness from the buffer, refilling
+  // it with AES in counter mode when it runs out.
+  //
+  // Returns INTERNAL in case of OpenSSL errors while refilling.
+  absl::StatusOr<uint8_t> Rand8() override;
+  absl::StatusOr<uint64_t> Rand64() override;
+  absl::StatusOr<absl::uint128> Rand128() override;
+
+  // Samples a fresh random seed of `SeedLength()` bytes using OpenSSL
+  // RAND_bytes.
+  //
+  // Returns an INTERNAL error code if the sampling fails.
+  static absl::StatusOr<std::string> GenerateSeed();
+  static int SeedLength();
+
+ private:
+  explicit BufferedAesCtrPrng(Aes128FixedKeyHash aes);
+
+  // Fills `buffer_` with the AES evaluations of the next `kRefillBlocks`
+  // counter values and resets `position_`.
+  absl::Status Refill();
+
+  // Common implementation of the Rand* methods.
+  template <typename T>
+  absl::StatusOr<T> Rand();
+
+  // Number of 128-bit blocks generated per refill. 256 blocks = 4 KiB, large
+  // enough to amortize the AES batch setup while staying in the L1 cache.
+  static constexpr int kRefillBlocks = 256;
+
+  // AES keyed by the seed, used to expand counter blocks.
+  Aes128FixedKeyHash aes_;
+
+  // Buffered pseudorandom blocks, served byte-wise by `Rand`.
+  std::vector<absl::uint128> buffer_;
+
+  // Next counter value to expand on refill.
+  absl::uint128 counter_;
+
+  // Read position in `buffer_`, in bytes.
+  int64_t position_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PRNG_BUFFERED_AES_CTR_PRNG_H_
@@ -16,16 +16,61 @@
 
 #include "dpf/aes_128_fixed_key_hash.h"
 
+#include <utility>
 #include <vector>
 
+#include "dpf/internal/hash_seeds_hwy.h"
+
 namespace distributed_point_functions {
 
 Aes128FixedKeyHash::Aes128FixedKeyHash(
-    bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx, absl::uint128 key)
-    : cipher_ctx_(std::move(cipher_ctx)), key_(key) {}
+    bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx, absl::uint128 key,
+    const AES_KEY& expanded_key)
+    : key_(key), expanded_key_(expanded_key) {
+  for (std::atomic<EVP_CIPHER_CTX*>& slot : cipher_ctx_pool_) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+  cipher_ctx_pool_[0].store(cipher_ctx.release(), std::memory_order_relaxed);
+}
 
-absl::StatusOr<Aes128FixedKeyHash> Aes128FixedKeyHash::Create(
-    absl::uint128 key) {
+Aes128FixedKeyHash::Aes128FixedKeyHash(Aes128FixedKeyHash&& other)
+    : key_(other.key_), expanded_key_(other.expanded_key_) {
+  for (int i = 0; i < kCipherContextPoolSize; ++i) {
+    cipher_ctx_pool_[i].store(
+        other.cipher_ctx_pool_[i].exchange(nullptr,
+                                           std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+}
+
+Aes128FixedKeyHash& Aes128FixedKeyHash::operator=(Aes128FixedKeyHash&& other) {
+  if (this != &other) {
+    key_ = other.key_;
+    expanded_key_ = other.expanded_key_;
+    for (int i = 0; i < kCipherContextPoolSize; ++i) {
+      EVP_CIPHER_CTX* ctx = cipher_ctx_pool_[i].exchange(
+          other.cipher_ctx_pool_[i].exchange(nullptr,
+                                             std::memory_order_relaxed),
+          std::memory_order_relaxed);
+      if (ctx != nullptr) {
+        EVP_CIPHER_CTX_free(ctx);
+      }
+    }
+  }
+  return *this;
+}
+
+Aes128FixedKeyHash::~Aes128FixedKeyHash() {
+  for (std::atomic<EVP_CIPHER_CTX*>& slot : cipher_ctx_pool_) {
+    EVP_CIPHER_CTX* ctx = slot.load(std::memory_order_relaxed);
+    if (ctx != nullptr) {
+      EVP_CIPHER_CTX_free(ctx);
+    }
+  }
+}
+
+absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>>
+Aes128FixedKeyHash::CreateCipherContext(absl::uint128 key) {
   bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx(EVP_CIPHER_CTX_new());
   if (!cipher_ctx) {
     return absl::InternalError("Failed to allocate AES context");
@@ -41,7 +86,53 @@ absl::StatusOr<Aes128FixedKeyHash> Aes128FixedKeyHash::Create(
   if (openssl_status != 1) {
     return absl::InternalError("Failed to set up AES context");
   }
-  return Aes128FixedKeyHash(std::move(cipher_ctx), key);
+  return cipher_ctx;
+}
+
+absl::StatusOr<Aes128FixedKeyHash> Aes128FixedKeyHash::Create(
+    absl::uint128 key) {
+  absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>> cipher_ctx =
+      CreateCipherContext(key);
+  if (!cipher_ctx.ok()) {
+    return cipher_ctx.status();
+  }
+  // Expand the round keys once, for the SIMD hashing path in `Evaluate`.
+  alignas(16) AES_KEY expanded_key;
+  int openssl_status = AES_set_encrypt_key(
+      reinterpret_cast<const uint8_t*>(&key), 128, &expanded_key);
+  if (openssl_status != 0) {
+    return absl::InternalError("Failed to set up AES key");
+  }
+  return Aes128FixedKeyHash(*std::move(cipher_ctx), key, expanded_key);
+}
+
+absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>>
+Aes128FixedKeyHash::AcquireCipherContext() const {
+  for (std::atomic<EVP_CIPHER_CTX*>& slot : cipher_ctx_pool_) {
+    EVP_CIPHER_CTX* ctx = slot.exchange(nullptr, std::memory_order_acquire);
+    if (ctx != nullptr) {
+      return bssl::UniquePtr<EVP_CIPHER_CTX>(ctx);
+    }
+  }
+  // All pooled contexts are in use by concurrent calls. Create a fresh one;
+  // `ReleaseCipherContext` will add it to the pool when done, up to
+  // `kCipherContextPoolSize` contexts.
+  return CreateCipherContext(key_);
+}
+
+void Aes128FixedKeyHash::ReleaseCipherContext(
+    bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx) const {
+  EVP_CIPHER_CTX* ctx = cipher_ctx.release();
+  for (std::atomic<EVP_CIPHER_CTX*>& slot : cipher_ctx_pool_) {
+    EVP_CIPHER_CTX* expected = nullptr;
+    if (slot.compare_exchange_strong(expected, ctx,
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  // Pool is full; drop the context.
+  EVP_CIPHER_CTX_free(ctx);
 }
 
 absl::Status Aes128FixedKeyHash::Evaluate(absl::Span<const absl::uint128> in,
@@ -53,6 +144,18 @@ absl::Status Aes128FixedKeyHash::Evaluate(absl::Span<const absl::uint128> in,
     // Nothing to do.
     return absl::OkStatus();
   }
+  // Fast path: direct AES instructions via Highway, bypassing EVP dispatch.
+  if (dpf_internal::HashSeeds(
+          static_cast<int64_t>(in.size()), in.data(), out.data(),
+          reinterpret_cast<const uint8_t*>(expanded_key_.rd_key))) {
+    return absl::OkStatus();
+  }
+  absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>> cipher_ctx =
+      AcquireCipherContext();
+  if (!cipher_ctx.ok()) {
+    return cipher_ctx.status();
+  }
+  absl::Status status = absl::OkStatus();
   // Compute orthomorphism sigma for each element in `in`, `kBatchSize` elements
   // at a time.
   auto in_size = static_cast<int64_t>(in.size());
@@ -68,20 +171,24 @@ absl::Status Aes128FixedKeyHash::Evaluate(absl::Span<const absl::uint128> in,
     }
     int out_len;
     int openssl_status = EVP_EncryptUpdate(
-        cipher_ctx_.get(), reinterpret_cast<uint8_t*>(out.data() + start_block),
-        &out_len, reinterpret_cast<const uint8_t*>(sigma_in.data()),
+        cipher_ctx->get(),
+        reinterpret_cast<uint8_t*>(out.data() + start_block), &out_len,
+        reinterpret_cast<const uint8_t*>(sigma_in.data()),
         static_cast<int>(batch_size * sizeof(absl::uint128)));
     if (openssl_status != 1) {
-      return absl::InternalError("AES encryption failed");
+      status = absl::InternalError("AES encryption failed");
+      break;
     }
     if (out_len != static_cast<int>(sizeof(absl::uint128)) * batch_size) {
-      return absl::InternalError("OpenSSL output size does not match");
+      status = absl::InternalError("OpenSSL output size does not match");
+      break;
     }
     for (int64_t i = 0; i < batch_size; ++i) {
       out[start_block + i] ^= sigma_in[i];
     }
   }
-  return absl::OkStatus();
+  ReleaseCipherContext(*std::move(cipher_ctx));
+  return status;
 }
 
 }  // namespace distributed_point_functions
@@ -17,8 +17,12 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_AES_128_FIXED_KEY_HASH_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_AES_128_FIXED_KEY_HASH_H_
 
+#include <openssl/aes.h>
 #include <openssl/cipher.h>
 
+#include <array>
+#include <atomic>
+
 #include "absl/numeric/int128.h"
 #include "absl/status/statusor.h"
 
@@ -46,6 +50,16 @@ class Aes128FixedKeyHash {
   // Computes hash values of each block in `in`, writing the output to `out`.
   // It is safe to call this method if `in` and `out` overlap.
   //
+  // When SIMD AES instructions are available, hashing is done with direct AES
+  // intrinsics via Highway (see dpf/internal/hash_seeds_hwy.h), using the
+  // round keys expanded once at `Create`. Otherwise falls back to OpenSSL's
+  // EVP interface.
+  //
+  // This method is safe to call concurrently from multiple threads. The SIMD
+  // path is stateless; the EVP fallback acquires an AES context from a small
+  // lock-free pool, creating a fresh one when the pool is exhausted, so
+  // concurrent calls do not contend with each other.
+  //
   // Returns INVALID_ARGUMENT if sizes of `in` and `out` don't match or their
   // sizes in bytes exceed an `int`, or INTERNAL in case of OpenSSL errors.
   absl::Status Evaluate(absl::Span<const absl::uint128> in,
@@ -55,9 +69,12 @@ class Aes128FixedKeyHash {
   Aes128FixedKeyHash(const Aes128FixedKeyHash&) = delete;
   Aes128FixedKeyHash& operator=(const Aes128FixedKeyHash&) = delete;
 
-  // Aes128FixedKeyHash is movable (it just wraps a bssl::UniquePtr).
-  Aes128FixedKeyHash(Aes128FixedKeyHash&&) = default;
-  Aes128FixedKeyHash& operator=(Aes128FixedKeyHash&&) = default;
+  // Aes128FixedKeyHash is movable. Moving is not thread-safe: no concurrent
+  // calls to `Evaluate` may be in flight on either operand.
+  Aes128FixedKeyHash(Aes128FixedKeyHash&& other);
+  Aes128FixedKeyHash& operator=(Aes128FixedKeyHash&& other);
+
+  ~Aes128FixedKeyHash();
 
   // Returns the key used to construct this hash function.
   // DO NOT SEND THIS TO ANY OTHER PARTY!
@@ -68,16 +85,42 @@ class Aes128FixedKeyHash {
   // comfortably fit in the L1 CPU cache.
   static constexpr int kBatchSize = 64;
 
+  // The maximum number of AES contexts kept in the pool. Contexts acquired
+  // while the pool is empty are created on the fly; contexts released while
+  // the pool is full are freed. The pool thus only grows up to the maximum
+  // number of concurrent `Evaluate` calls observed, bounded by this constant.
+  static constexpr int kCipherContextPoolSize = 16;
+
  private:
   // Called by `Create`.
   Aes128FixedKeyHash(bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx,
-                     absl::uint128 key);
+                     absl::uint128 key, const AES_KEY& expanded_key);
 
-  // The OpenSSL encryption context used by `Evaluate`.
-  bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx_;
+  // Creates a fresh ECB encryption context for `key`. Returns INTERNAL in
+  // case of allocation failures or OpenSSL errors.
+  static absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>> CreateCipherContext(
+      absl::uint128 key);
+
+  // Takes a context out of `cipher_ctx_pool_`, or creates a new one if the
+  // pool is empty.
+  absl::StatusOr<bssl::UniquePtr<EVP_CIPHER_CTX>> AcquireCipherContext() const;
+
+  // Returns `cipher_ctx` to `cipher_ctx_pool_`, freeing it if the pool is
+  // full.
+  void ReleaseCipherContext(bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx) const;
+
+  // Pool of OpenSSL encryption contexts used by `Evaluate`. Each slot holds
+  // either an idle context or nullptr. Slots are claimed and returned with
+  // atomic exchanges, so no locks are taken on the hot path.
+  mutable std::array<std::atomic<EVP_CIPHER_CTX*>, kCipherContextPoolSize>
+      cipher_ctx_pool_;
 
   // The key used to construct this hash function.
   absl::uint128 key_;
+
+  // The AES-128 key schedule for `key_`, expanded once at `Create` and used
+  // by the SIMD hashing path. Aligned for 128-bit vector loads.
+  alignas(16) AES_KEY expanded_key_;
 };
 
 }  // namespace distributed_point_functions
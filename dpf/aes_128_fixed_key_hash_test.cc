@@ -16,6 +16,8 @@
 
 #include "dpf/aes_128_fixed_key_hash.h"
 
+#include <thread>  // NOLINT(build/c++11)
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -134,6 +136,37 @@ TEST(PseudorandomGeneratorTest, TestSpecificOutputValues) {
                   absl::MakeUint128(0x530098817046d284, 0x43e61d3273a04f7c)));
 }
 
+TEST(PseudorandomGeneratorTest, ConcurrentEvaluationsGenerateCorrectOutput) {
+  DPF_ASSERT_OK_AND_ASSIGN(Aes128FixedKeyHash prg,
+                           Aes128FixedKeyHash::Create(kKey0));
+  // Use more threads than pooled contexts, to exercise context creation while
+  // the pool is exhausted.
+  const int kNumThreads = 2 * Aes128FixedKeyHash::kCipherContextPoolSize;
+  const int kNumIterations = 100;
+  std::vector<absl::uint128> in{kSeed0, kSeed1};
+  std::vector<absl::uint128> expected(in.size());
+  DPF_ASSERT_OK(prg.Evaluate(in, absl::MakeSpan(expected)));
+
+  std::vector<std::vector<absl::uint128>> outputs(
+      kNumThreads, std::vector<absl::uint128>(in.size()));
+  std::vector<std::thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&prg, &in, &out = outputs[i]] {
+      for (int j = 0; j < kNumIterations; ++j) {
+        DPF_EXPECT_OK(prg.Evaluate(in, absl::MakeSpan(out)));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_THAT(outputs[i], testing::ElementsAreArray(expected)) << i;
+  }
+}
+
 TEST(PseudorandomGeneratorTest, EvaluateFailsWhenSizesDontMatch) {
   std::vector<absl::uint128> in{kSeed0};
   DPF_ASSERT_OK_AND_ASSIGN(Aes128FixedKeyHash prg,
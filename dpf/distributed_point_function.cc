@@ -17,10 +17,20 @@
 #include <glog/logging.h>
 #include <openssl/rand.h>
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
-
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "dpf/internal/domain_index_hwy.h"
 #include "dpf/internal/evaluate_prg_hwy.h"
 #include "dpf/internal/get_hwy_mode.h"
+#include "dpf/internal/numa.h"
 #include "dpf/status_macros.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "hwy/aligned_allocator.h"
@@ -41,8 +51,286 @@ constexpr absl::uint128 kPrgKeyRight =
 constexpr absl::uint128 kPrgKeyValue =
     absl::MakeUint128(0x05a5d1588c5423e3ULL, 0x46a31101b21d1c98ULL);
 
+// Minimum number of output seeds per thread in `ExpandSeedsParallel`. Smaller
+// expansions are done sequentially, since thread startup would dominate.
+constexpr int64_t kMinSeedsPerThread = int64_t{1} << 14;
+
+// Version tag at the start of keys serialized with `SerializeKeyCompact`.
+// Version 2 packs the control bits of all levels into a single bitfield and
+// serializes integer value corrections with `bitsize` / 8 bytes instead of a
+// fixed 8.
+constexpr uint8_t kCompactKeyVersion = 2;
+
+#ifdef DPF_ENABLE_EVALUATION_STATS
+// Sink for `EvaluationStats` counters, registered per thread via
+// `SetEvaluationStatsSink`.
+thread_local EvaluationStats* evaluation_stats_sink = nullptr;
+#endif
+
+// Returns the index of `needle` in the sorted span `haystack`, or -1 if it is
+// not present. `cursor` is the index of the previously found element and is
+// updated on success. Queries arriving in nondecreasing order are resolved by
+// galloping forward from the cursor, so a sorted query span turns into a
+// single linear merge pass over `haystack`; out-of-order queries fall back to
+// a binary search over the whole span.
+int64_t FindSortedPrefix(absl::Span<const absl::uint128> haystack,
+                         absl::uint128 needle, int64_t& cursor) {
+  const auto size = static_cast<int64_t>(haystack.size());
+  int64_t begin = 0;
+  int64_t end = size;
+  if (cursor < size && haystack[cursor] <= needle) {
+    // Query in nondecreasing order: gallop forward from the cursor. After the
+    // loop, all elements equal to `needle` lie in [begin, end).
+    begin = cursor;
+    end = cursor + 1;
+    int64_t step = 1;
+    while (end < size && haystack[end] <= needle) {
+      begin = end;
+      end += step;
+      step *= 2;
+    }
+    end = std::min(end, size);
+  }
+  const absl::uint128* it =
+      std::lower_bound(haystack.begin() + begin, haystack.begin() + end, needle);
+  if (it == haystack.begin() + end || *it != needle) {
+    return -1;
+  }
+  cursor = static_cast<int64_t>(it - haystack.begin());
+  return cursor;
+}
+
+// Appends the lowest `num_bytes` bytes of `value` to `out` in little-endian
+// order.
+void AppendIntegerCompact(uint64_t value, int num_bytes, std::string& out) {
+  for (int i = 0; i < num_bytes; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+// Reads fixed-width little-endian integers from a key serialized with
+// `SerializeKeyCompact`, keeping track of the current position and remaining
+// bytes.
+class CompactKeyReader {
+ public:
+  explicit CompactKeyReader(absl::string_view data) : data_(data), pos_(0) {}
+
+  // Reads the next `num_bytes` bytes as a little-endian integer. Returns
+  // INVALID_ARGUMENT if fewer than `num_bytes` bytes remain.
+  absl::StatusOr<uint64_t> ReadInteger(int num_bytes) {
+    if (data_.size() - pos_ < static_cast<size_t>(num_bytes)) {
+      return absl::InvalidArgumentError(
+          "`serialized` ended unexpectedly while parsing a compact key");
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; ++i) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i]))
+               << (8 * i);
+    }
+    pos_ += num_bytes;
+    return value;
+  }
+
+  // Returns the number of bytes left to read.
+  size_t remaining() const { return data_.size() - pos_; }
+
+ private:
+  absl::string_view data_;
+  size_t pos_;
+};
+
+// Returns the number of bytes used to serialize an integer with the given
+// `bitsize` in the compact key format.
+int CompactIntegerBytes(int bitsize) { return std::max(1, bitsize / 8); }
+
+// Serializes `integer` with the given `bitsize` to `out`, taking
+// `CompactIntegerBytes(bitsize)` bytes. Returns INVALID_ARGUMENT if the
+// representation of `integer` doesn't match `bitsize`, or if its value doesn't
+// fit in that many bytes.
+absl::Status SerializeValueIntegerCompact(const Value::Integer& integer,
+                                          int bitsize, std::string& out) {
+  const int num_bytes = CompactIntegerBytes(bitsize);
+  if (bitsize <= 64) {
+    if (integer.value_case() != Value::Integer::kValueUint64) {
+      return absl::InvalidArgumentError(
+          "Expected Value::Integer to be a `value_uint64`");
+    }
+    if (num_bytes < 8 && (integer.value_uint64() >> (8 * num_bytes)) != 0) {
+      return absl::InvalidArgumentError(
+          "Value::Integer too large for its `bitsize`");
+    }
+    AppendIntegerCompact(integer.value_uint64(), num_bytes, out);
+  } else {
+    if (integer.value_case() != Value::Integer::kValueUint128) {
+      return absl::InvalidArgumentError(
+          "Expected Value::Integer to be a `value_uint128`");
+    }
+    AppendIntegerCompact(integer.value_uint128().low(), sizeof(uint64_t), out);
+    AppendIntegerCompact(integer.value_uint128().high(), sizeof(uint64_t), out);
+  }
+  return absl::OkStatus();
+}
+
+// Parses a Value::Integer with the given `bitsize` from `reader` into `out`.
+absl::Status ParseValueIntegerCompact(CompactKeyReader& reader, int bitsize,
+                                      Value::Integer& out) {
+  if (bitsize <= 64) {
+    DPF_ASSIGN_OR_RETURN(uint64_t value,
+                         reader.ReadInteger(CompactIntegerBytes(bitsize)));
+    out.set_value_uint64(value);
+  } else {
+    DPF_ASSIGN_OR_RETURN(uint64_t low, reader.ReadInteger(sizeof(uint64_t)));
+    DPF_ASSIGN_OR_RETURN(uint64_t high, reader.ReadInteger(sizeof(uint64_t)));
+    out.mutable_value_uint128()->set_low(low);
+    out.mutable_value_uint128()->set_high(high);
+  }
+  return absl::OkStatus();
+}
+
+// Serializes `value` to `out`, laid out according to `type`. Since the layout
+// is fully determined by `type`, no framing or tags are written. Returns
+// INVALID_ARGUMENT if `value` doesn't match `type`.
+absl::Status SerializeValueCompact(const Value& value, const ValueType& type,
+                                   std::string& out) {
+  switch (type.type_case()) {
+    case ValueType::kInteger:
+      if (value.value_case() != Value::kInteger) {
+        return absl::InvalidArgumentError("Expected Value to be an `integer`");
+      }
+      return SerializeValueIntegerCompact(value.integer(),
+                                          type.integer().bitsize(), out);
+    case ValueType::kTuple: {
+      if (value.value_case() != Value::kTuple) {
+        return absl::InvalidArgumentError("Expected Value to be a `tuple`");
+      }
+      if (value.tuple().elements_size() != type.tuple().elements_size()) {
+        return absl::InvalidArgumentError(
+            "Tuple size doesn't match the ValueType");
+      }
+      for (int i = 0; i < type.tuple().elements_size(); ++i) {
+        DPF_RETURN_IF_ERROR(SerializeValueCompact(
+            value.tuple().elements(i), type.tuple().elements(i), out));
+      }
+      return absl::OkStatus();
+    }
+    case ValueType::kIntModN:
+      if (value.value_case() != Value::kIntModN) {
+        return absl::InvalidArgumentError(
+            "Expected Value to be an `int_mod_n`");
+      }
+      return SerializeValueIntegerCompact(
+          value.int_mod_n(), type.int_mod_n().base_integer().bitsize(), out);
+    case ValueType::kXorWrapper:
+      if (value.value_case() != Value::kXorWrapper) {
+        return absl::InvalidArgumentError(
+            "Expected Value to be an `xor_wrapper`");
+      }
+      return SerializeValueIntegerCompact(value.xor_wrapper(),
+                                          type.xor_wrapper().bitsize(), out);
+    default:
+      return absl::InvalidArgumentError("Unsupported ValueType");
+  }
+}
+
+// Parses a Value laid out according to `type` from `reader` into `out`.
+absl::Status ParseValueCompact(CompactKeyReader& reader, const ValueType& type,
+                               Value& out) {
+  switch (type.type_case()) {
+    case ValueType::kInteger:
+      return ParseValueIntegerCompact(reader, type.integer().bitsize(),
+                                      *out.mutable_integer());
+    case ValueType::kTuple: {
+      Value::Tuple& tuple = *out.mutable_tuple();
+      for (int i = 0; i < type.tuple().elements_size(); ++i) {
+        DPF_RETURN_IF_ERROR(ParseValueCompact(reader, type.tuple().elements(i),
+                                              *tuple.add_elements()));
+      }
+      return absl::OkStatus();
+    }
+    case ValueType::kIntModN:
+      return ParseValueIntegerCompact(reader,
+                                      type.int_mod_n().base_integer().bitsize(),
+                                      *out.mutable_int_mod_n());
+    case ValueType::kXorWrapper:
+      return ParseValueIntegerCompact(reader, type.xor_wrapper().bitsize(),
+                                      *out.mutable_xor_wrapper());
+    default:
+      return absl::InvalidArgumentError("Unsupported ValueType");
+  }
+}
+
 }  // namespace
 
+absl::StatusOr<EvaluationScratch::Buffer> EvaluationScratch::Acquire(
+    int64_t size) {
+  // Reuse the smallest retained buffer that fits. `buffers_` is sorted by
+  // capacity.
+  auto it = std::lower_bound(buffers_.begin(), buffers_.end(), size,
+                             [](const Buffer& buffer, int64_t size) {
+                               return buffer.capacity < size;
+                             });
+  if (it != buffers_.end()) {
+    Buffer buffer = std::move(*it);
+    buffers_.erase(it);
+    return buffer;
+  }
+  // Nothing fits -> allocate a fresh buffer, rounding the capacity up to the
+  // next power of two so that slowly growing sizes don't allocate every call.
+  int64_t capacity = 1;
+  while (capacity < size) {
+    capacity *= 2;
+  }
+  Buffer buffer;
+  buffer.data = hwy::AllocateAligned<absl::uint128>(capacity);
+  if (buffer.data == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  buffer.capacity = capacity;
+  return buffer;
+}
+
+void EvaluationScratch::Release(Buffer buffer) {
+  auto it = std::lower_bound(buffers_.begin(), buffers_.end(), buffer.capacity,
+                             [](const Buffer& buffer, int64_t capacity) {
+                               return buffer.capacity < capacity;
+                             });
+  buffers_.insert(it, std::move(buffer));
+}
+
+absl::StatusOr<EvaluationScratch::Buffer>
+DistributedPointFunction::AcquireBuffer(int64_t size,
+                                        EvaluationScratch* scratch) {
+  if (scratch != nullptr) {
+    return scratch->Acquire(size);
+  }
+  EvaluationScratch::Buffer buffer;
+  buffer.data = hwy::AllocateAligned<absl::uint128>(std::max<int64_t>(size, 1));
+  if (buffer.data == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  if (EvaluationStats* stats = GetEvaluationStatsSink()) {
+    stats->allocated_bytes += std::max<int64_t>(size, 1) *
+                              static_cast<int64_t>(sizeof(absl::uint128));
+  }
+#endif
+  // Leave `capacity` at 0: the buffer was not acquired from a scratch and
+  // should be freed by `RecycleBuffer`.
+  return buffer;
+}
+
+void DistributedPointFunction::RecycleBuffer(
+    hwy::AlignedFreeUniquePtr<absl::uint128[]> data, int64_t capacity,
+    EvaluationScratch* scratch) {
+  if (scratch != nullptr && data != nullptr && capacity > 0) {
+    EvaluationScratch::Buffer buffer;
+    buffer.data = std::move(data);
+    buffer.capacity = capacity;
+    scratch->Release(std::move(buffer));
+  }
+  // Otherwise, `data` is freed when it goes out of scope.
+}
+
 DistributedPointFunction::DistributedPointFunction(
     std::unique_ptr<dpf_internal::ProtoValidator> proto_validator,
     std::vector<int> blocks_needed, Aes128FixedKeyHash prg_left,
@@ -101,7 +389,8 @@ DistributedPointFunction::ComputeValueCorrection(
 // Expands the PRG seeds at the next `tree_level`, updates `seeds` and
 // `control_bits`, and writes the next correction word to `keys`.
 absl::Status DistributedPointFunction::GenerateNext(
-    int tree_level, absl::uint128 alpha, absl::Span<const Value> beta,
+    int tree_level, absl::uint128 alpha,
+    ValueCorrectionCallback compute_value_correction,
     absl::Span<absl::uint128> seeds, absl::Span<bool> control_bits,
     absl::Span<DpfKey> keys) const {
   // As in `GenerateKeysIncremental`, we annotate code with the corresponding
@@ -121,10 +410,10 @@ absl::Status DistributedPointFunction::GenerateNext(
     if (shift_amount < 128) {
       alpha_prefix = alpha >> shift_amount;
     }
-    DPF_ASSIGN_OR_RETURN(
-        std::vector<Value> value_correction,
-        ComputeValueCorrection(hierarchy_level, seeds, alpha_prefix,
-                               beta[hierarchy_level], control_bits[1]));
+    DPF_ASSIGN_OR_RETURN(std::vector<Value> value_correction,
+                         compute_value_correction(hierarchy_level, seeds,
+                                                  alpha_prefix,
+                                                  control_bits[1]));
     for (const Value& value : value_correction) {
       *(correction_word->add_value_correction()) = value;
     }
@@ -203,6 +492,158 @@ absl::Status DistributedPointFunction::GenerateNext(
   return absl::OkStatus();
 }
 
+absl::StatusOr<std::vector<std::vector<Value>>>
+DistributedPointFunction::ComputeValueCorrectionBatch(
+    int hierarchy_level, absl::Span<const absl::uint128> seeds,
+    absl::Span<const absl::uint128> alphas, absl::Span<const Value> betas,
+    absl::Span<const bool> control_bits) const {
+  const auto num_keys = static_cast<int64_t>(alphas.size());
+  const int num_levels = static_cast<int>(parameters_.size());
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+
+  // Lay out the value PRG inputs of all keys contiguously, so that the whole
+  // batch is hashed with a single call to prg_value_.
+  std::vector<absl::uint128> expanded_seeds(2 * blocks_needed * num_keys);
+  for (int64_t j = 0; j < num_keys; ++j) {
+    auto expanded_seed_a = expanded_seeds.begin() + 2 * blocks_needed * j;
+    auto expanded_seed_b = expanded_seed_a + blocks_needed;
+    std::iota(expanded_seed_a, expanded_seed_b, seeds[2 * j]);
+    std::iota(expanded_seed_b, expanded_seed_b + blocks_needed,
+              seeds[2 * j + 1]);
+  }
+
+  // Evaluate PRG in place (this is safe as `Evaluate` creates a copy of the
+  // input).
+  DPF_RETURN_IF_ERROR(
+      prg_value_.Evaluate(expanded_seeds, absl::MakeSpan(expanded_seeds)));
+
+  // Look up the value correction function once for the whole batch.
+  DPF_ASSIGN_OR_RETURN(
+      ValueCorrectionFunction func,
+      GetValueCorrectionFunction(parameters_[hierarchy_level]));
+  const int shift_amount = parameters_.back().log_domain_size() -
+                           parameters_[hierarchy_level].log_domain_size();
+
+  std::vector<std::vector<Value>> result(num_keys);
+  for (int64_t j = 0; j < num_keys; ++j) {
+    absl::uint128 alpha_prefix = 0;
+    if (shift_amount < 128) {
+      alpha_prefix = alphas[j] >> shift_amount;
+    }
+    int index_in_block = DomainToBlockIndex(alpha_prefix, hierarchy_level);
+    const absl::uint128* expanded_seed_a =
+        expanded_seeds.data() + 2 * blocks_needed * j;
+    DPF_ASSIGN_OR_RETURN(
+        result[j],
+        func(absl::string_view(reinterpret_cast<const char*>(expanded_seed_a),
+                               blocks_needed * sizeof(absl::uint128)),
+             absl::string_view(
+                 reinterpret_cast<const char*>(expanded_seed_a + blocks_needed),
+                 blocks_needed * sizeof(absl::uint128)),
+             index_in_block, betas[j * num_levels + hierarchy_level],
+             control_bits[2 * j + 1]));
+  }
+  return result;
+}
+
+absl::Status DistributedPointFunction::GenerateNextBatch(
+    int tree_level, absl::Span<const absl::uint128> alphas,
+    absl::Span<const Value> betas, absl::Span<absl::uint128> seeds,
+    absl::Span<bool> control_bits,
+    absl::Span<std::pair<DpfKey, DpfKey>> keys) const {
+  const auto num_keys = static_cast<int64_t>(alphas.size());
+
+  // Add this level's correction word to the first key of each pair. The
+  // second key gets a copy at the end.
+  std::vector<CorrectionWord*> correction_words(num_keys);
+  for (int64_t j = 0; j < num_keys; ++j) {
+    correction_words[j] = keys[j].first.add_correction_words();
+  }
+
+  // Value corrections for all keys, with a single value PRG call. See
+  // `GenerateNext` for why this is done before the seed expansion.
+  if (tree_to_hierarchy_.contains(tree_level - 1)) {
+    int hierarchy_level = tree_to_hierarchy_.at(tree_level - 1);
+    DPF_ASSIGN_OR_RETURN(
+        std::vector<std::vector<Value>> value_corrections,
+        ComputeValueCorrectionBatch(hierarchy_level, seeds, alphas, betas,
+                                    control_bits));
+    for (int64_t j = 0; j < num_keys; ++j) {
+      for (Value& value : value_corrections[j]) {
+        *(correction_words[j]->add_value_correction()) = std::move(value);
+      }
+    }
+  }
+
+  // Expand the seeds of all keys with one PRG call per branch, instead of
+  // two-seed calls per key.
+  std::vector<absl::uint128> expanded_left(2 * num_keys);
+  std::vector<absl::uint128> expanded_right(2 * num_keys);
+  DPF_RETURN_IF_ERROR(prg_left_.Evaluate(seeds, absl::MakeSpan(expanded_left)));
+  DPF_RETURN_IF_ERROR(
+      prg_right_.Evaluate(seeds, absl::MakeSpan(expanded_right)));
+
+  // The per-key correction logic is identical to `GenerateNext`.
+  for (int64_t j = 0; j < num_keys; ++j) {
+    std::array<std::array<absl::uint128, 2>, 2> expanded_seeds = {
+        {{expanded_left[2 * j], expanded_left[2 * j + 1]},
+         {expanded_right[2 * j], expanded_right[2 * j + 1]}}};
+    std::array<std::array<bool, 2>, 2> expanded_control_bits;
+    expanded_control_bits[0][0] =
+        dpf_internal::ExtractAndClearLowestBit(expanded_seeds[0][0]);
+    expanded_control_bits[0][1] =
+        dpf_internal::ExtractAndClearLowestBit(expanded_seeds[0][1]);
+    expanded_control_bits[1][0] =
+        dpf_internal::ExtractAndClearLowestBit(expanded_seeds[1][0]);
+    expanded_control_bits[1][1] =
+        dpf_internal::ExtractAndClearLowestBit(expanded_seeds[1][1]);
+
+    bool current_bit = 0;
+    if (parameters_.back().log_domain_size() - tree_level < 128) {
+      current_bit =
+          (alphas[j] &
+           (absl::uint128{1}
+            << (parameters_.back().log_domain_size() - tree_level))) != 0;
+    }
+    bool keep = current_bit, lose = !current_bit;
+
+    absl::uint128 seed_correction =
+        expanded_seeds[lose][0] ^ expanded_seeds[lose][1];
+
+    std::array<bool, 2> control_bit_correction;
+    control_bit_correction[0] = expanded_control_bits[0][0] ^
+                                expanded_control_bits[0][1] ^ current_bit ^ 1;
+    control_bit_correction[1] =
+        expanded_control_bits[1][0] ^ expanded_control_bits[1][1] ^ current_bit;
+
+    seeds[2 * j] = expanded_seeds[keep][0];
+    seeds[2 * j + 1] = expanded_seeds[keep][1];
+    if (control_bits[2 * j]) {
+      seeds[2 * j] ^= seed_correction;
+    }
+    if (control_bits[2 * j + 1]) {
+      seeds[2 * j + 1] ^= seed_correction;
+    }
+
+    control_bits[2 * j] = expanded_control_bits[keep][0] ^
+                          (control_bits[2 * j] && control_bit_correction[keep]);
+    control_bits[2 * j + 1] =
+        expanded_control_bits[keep][1] ^
+        (control_bits[2 * j + 1] && control_bit_correction[keep]);
+
+    correction_words[j]->mutable_seed()->set_high(
+        absl::Uint128High64(seed_correction));
+    correction_words[j]->mutable_seed()->set_low(
+        absl::Uint128Low64(seed_correction));
+    correction_words[j]->set_control_left(control_bit_correction[0]);
+    correction_words[j]->set_control_right(control_bit_correction[1]);
+
+    *(keys[j].second.add_correction_words()) = *correction_words[j];
+  }
+
+  return absl::OkStatus();
+}
+
 absl::uint128 DistributedPointFunction::DomainToTreeIndex(
     absl::uint128 domain_index, int hierarchy_level) const {
   int block_index_bits = parameters_[hierarchy_level].log_domain_size() -
@@ -220,6 +661,59 @@ int DistributedPointFunction::DomainToBlockIndex(absl::uint128 domain_index,
                           ((absl::uint128{1} << block_index_bits) - 1));
 }
 
+absl::StatusOr<PrecomputedEvaluationPoints>
+DistributedPointFunction::PrecomputeEvaluationPoints(
+    absl::Span<const absl::uint128> evaluation_points,
+    int hierarchy_level) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  const auto num_evaluation_points =
+      static_cast<int64_t>(evaluation_points.size());
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  absl::uint128 max_evaluation_point = absl::Uint128Max();
+  if (log_domain_size < 128) {
+    max_evaluation_point = (absl::uint128{1} << log_domain_size) - 1;
+  }
+  for (int64_t i = 0; i < num_evaluation_points; ++i) {
+    if (evaluation_points[i] > max_evaluation_point) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("`evaluation_points[", i,
+                       "]` larger than the domain size at hierarchy level ",
+                       hierarchy_level));
+    }
+  }
+  PrecomputedEvaluationPoints result;
+  result.hierarchy_level_ = hierarchy_level;
+  result.evaluation_points_.assign(evaluation_points.begin(),
+                                   evaluation_points.end());
+  result.tree_indices_ = hwy::AllocateAligned<absl::uint128>(
+      std::max<int64_t>(num_evaluation_points, 1));
+  if (result.tree_indices_ == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  result.block_indices_.resize(num_evaluation_points);
+  // When `hierarchy_level` packs multiple elements per block, the tree index
+  // drops the block-index bits of each point; otherwise these translations
+  // are the identity resp. zero, so the buffers work for any value type.
+  if (num_evaluation_points > 0 &&
+      !dpf_internal::DomainToTreeAndBlockIndices(
+          num_evaluation_points, evaluation_points.data(),
+          log_domain_size - hierarchy_to_tree_[hierarchy_level],
+          result.tree_indices_.get(), result.block_indices_.data())) {
+    for (int64_t i = 0; i < num_evaluation_points; ++i) {
+      result.tree_indices_[i] =
+          DomainToTreeIndex(evaluation_points[i], hierarchy_level);
+      result.block_indices_[i] =
+          DomainToBlockIndex(evaluation_points[i], hierarchy_level);
+    }
+  }
+  return result;
+}
+
 absl::Status DistributedPointFunction::EvaluateSeeds(
     absl::Span<const absl::uint128> seeds, absl::Span<const bool> control_bits,
     absl::Span<const absl::uint128> paths,
@@ -268,10 +762,241 @@ absl::Status DistributedPointFunction::EvaluateSeeds(
   return absl::OkStatus();
 }
 
+absl::Status DistributedPointFunction::EvaluateSeeds(
+    absl::Span<const absl::uint128> seeds,
+    const dpf_internal::PackedControlBits& control_bits,
+    absl::Span<const absl::uint128> paths,
+    absl::Span<const CorrectionWord* const> correction_words,
+    absl::Span<absl::uint128> seeds_out,
+    dpf_internal::PackedControlBits& control_bits_out) const {
+  if (static_cast<int64_t>(seeds.size()) != control_bits.size() ||
+      seeds.size() != paths.size() || seeds.size() != seeds_out.size() ||
+      static_cast<int64_t>(seeds.size()) != control_bits_out.size()) {
+    return absl::InvalidArgumentError(
+        "`seeds`, `control_bits`, `paths`, `seeds_out`, and `control_bits_out` "
+        "must all have equal sizes");
+  }
+  auto num_seeds = static_cast<int64_t>(seeds.size());
+  auto num_levels = static_cast<int>(correction_words.size());
+  if (num_seeds == 0 || num_levels == 0) {
+    return absl::OkStatus();  // Nothing to do.
+  }
+
+  // Parse correction words for each level.
+  auto correction_seeds = hwy::AllocateAligned<absl::uint128>(num_levels);
+  if (correction_seeds == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  BitVector correction_controls_left(num_levels),
+      correction_controls_right(num_levels);
+  for (int level = 0; level < num_levels; ++level) {
+    const CorrectionWord& correction = *(correction_words[level]);
+    correction_seeds[level] =
+        absl::MakeUint128(correction.seed().high(), correction.seed().low());
+    correction_controls_left[level] = correction.control_left();
+    correction_controls_right[level] = correction.control_right();
+  }
+
+  DPF_RETURN_IF_ERROR(dpf_internal::EvaluateSeedsPacked(
+      num_seeds, num_levels, seeds.data(), control_bits.words(), paths.data(),
+      correction_seeds.get(), correction_controls_left.data(),
+      correction_controls_right.data(), prg_left_, prg_right_, seeds_out.data(),
+      control_bits_out.words()));
+  return absl::OkStatus();
+}
+
+absl::Status DistributedPointFunction::EvaluateSeeds(
+    absl::Span<const absl::uint128> seeds,
+    const dpf_internal::PackedControlBits& control_bits,
+    absl::Span<const absl::uint128> paths, const CompiledDpfKey& compiled_key,
+    int start_level, int num_levels, absl::Span<absl::uint128> seeds_out,
+    dpf_internal::PackedControlBits& control_bits_out) const {
+  if (static_cast<int64_t>(seeds.size()) != control_bits.size() ||
+      seeds.size() != paths.size() || seeds.size() != seeds_out.size() ||
+      static_cast<int64_t>(seeds.size()) != control_bits_out.size()) {
+    return absl::InvalidArgumentError(
+        "`seeds`, `control_bits`, `paths`, `seeds_out`, and `control_bits_out` "
+        "must all have equal sizes");
+  }
+  auto num_seeds = static_cast<int64_t>(seeds.size());
+  if (num_seeds == 0 || num_levels == 0) {
+    return absl::OkStatus();  // Nothing to do.
+  }
+  DCHECK(start_level >= 0 &&
+         start_level + num_levels <=
+             static_cast<int>(compiled_key.correction_controls_left_.size()));
+
+  // The correction words were already parsed into flat arrays by
+  // `CompileDpfKey`, so we can pass them to the evaluation kernel directly.
+  DPF_RETURN_IF_ERROR(dpf_internal::EvaluateSeedsPacked(
+      num_seeds, num_levels, seeds.data(), control_bits.words(), paths.data(),
+      compiled_key.correction_seeds_.get() + start_level,
+      compiled_key.correction_controls_left_.data() + start_level,
+      compiled_key.correction_controls_right_.data() + start_level, prg_left_,
+      prg_right_, seeds_out.data(), control_bits_out.words()));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<CompiledDpfKey> DistributedPointFunction::CompileDpfKey(
+    const DpfKey& key) const {
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  CompiledDpfKey compiled;
+  compiled.key_ = key;
+  compiled.seed_ = absl::MakeUint128(key.seed().high(), key.seed().low());
+  compiled.party_ = static_cast<bool>(key.party());
+  const int num_levels = key.correction_words_size();
+  compiled.correction_seeds_ =
+      hwy::AllocateAligned<absl::uint128>(std::max(num_levels, 1));
+  if (compiled.correction_seeds_ == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  compiled.correction_controls_left_.resize(num_levels);
+  compiled.correction_controls_right_.resize(num_levels);
+  for (int level = 0; level < num_levels; ++level) {
+    const CorrectionWord& correction = key.correction_words(level);
+    compiled.correction_seeds_[level] =
+        absl::MakeUint128(correction.seed().high(), correction.seed().low());
+    compiled.correction_controls_left_[level] = correction.control_left();
+    compiled.correction_controls_right_[level] = correction.control_right();
+  }
+  return compiled;
+}
+
+absl::StatusOr<std::string> DistributedPointFunction::SerializeKeyCompact(
+    const DpfKey& key) const {
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  std::string serialized;
+  serialized.push_back(static_cast<char>(kCompactKeyVersion));
+  serialized.push_back(static_cast<char>(key.party()));
+  AppendIntegerCompact(key.seed().low(), sizeof(uint64_t), serialized);
+  AppendIntegerCompact(key.seed().high(), sizeof(uint64_t), serialized);
+  // Pack the control-bit corrections of all levels into a single bitfield:
+  // bits `2 * level` and `2 * level + 1` hold `control_left` and
+  // `control_right` of `level`. Spending a whole byte per level instead would
+  // add almost 6% to the size of keys with single-integer outputs.
+  const int num_levels = key.correction_words_size();
+  const size_t control_offset = serialized.size();
+  serialized.resize(control_offset + (2 * num_levels + 7) / 8, '\0');
+  for (int level = 0; level < num_levels; ++level) {
+    const CorrectionWord& correction = key.correction_words(level);
+    const int bit = 2 * level;
+    serialized[control_offset + bit / 8] |= static_cast<char>(
+        static_cast<int>(correction.control_left()) << (bit % 8) |
+        static_cast<int>(correction.control_right()) << (bit % 8 + 1));
+  }
+  for (int level = 0; level < num_levels; ++level) {
+    const CorrectionWord& correction = key.correction_words(level);
+    AppendIntegerCompact(correction.seed().low(), sizeof(uint64_t), serialized);
+    AppendIntegerCompact(correction.seed().high(), sizeof(uint64_t),
+                         serialized);
+    if (tree_to_hierarchy_.contains(level)) {
+      // `level` corresponds to a hierarchy level, so `correction` carries
+      // value corrections of the type at that level. The number of corrections
+      // depends only on `parameters_`, but the validator doesn't pin it down,
+      // so we write an explicit count to be able to round-trip any valid key.
+      const ValueType& type =
+          parameters_[tree_to_hierarchy_.at(level)].value_type();
+      AppendIntegerCompact(correction.value_correction_size(), sizeof(uint32_t),
+                           serialized);
+      for (const Value& value : correction.value_correction()) {
+        DPF_RETURN_IF_ERROR(SerializeValueCompact(value, type, serialized));
+      }
+    }
+  }
+  AppendIntegerCompact(key.last_level_value_correction_size(),
+                       sizeof(uint32_t), serialized);
+  for (const Value& value : key.last_level_value_correction()) {
+    DPF_RETURN_IF_ERROR(SerializeValueCompact(
+        value, parameters_.back().value_type(), serialized));
+  }
+  return serialized;
+}
+
+absl::StatusOr<DpfKey> DistributedPointFunction::ParseKeyCompact(
+    absl::string_view serialized) const {
+  CompactKeyReader reader(serialized);
+  DPF_ASSIGN_OR_RETURN(uint64_t version, reader.ReadInteger(1));
+  if (version != kCompactKeyVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported compact key version ", version));
+  }
+  DPF_ASSIGN_OR_RETURN(uint64_t party, reader.ReadInteger(1));
+  if (party > 1) {
+    return absl::InvalidArgumentError("`party` must be 0 or 1");
+  }
+  DpfKey key;
+  key.set_party(static_cast<int>(party));
+  DPF_ASSIGN_OR_RETURN(uint64_t seed_low, reader.ReadInteger(sizeof(uint64_t)));
+  DPF_ASSIGN_OR_RETURN(uint64_t seed_high,
+                       reader.ReadInteger(sizeof(uint64_t)));
+  key.mutable_seed()->set_low(seed_low);
+  key.mutable_seed()->set_high(seed_high);
+  const int num_levels = tree_levels_needed_ - 1;
+  const int num_control_bytes = (2 * num_levels + 7) / 8;
+  std::vector<uint8_t> control_bytes(num_control_bytes);
+  for (int i = 0; i < num_control_bytes; ++i) {
+    DPF_ASSIGN_OR_RETURN(uint64_t control_byte, reader.ReadInteger(1));
+    control_bytes[i] = static_cast<uint8_t>(control_byte);
+  }
+  // Reject nonzero bits past the last level, so every key has a unique
+  // serialization.
+  if (num_control_bytes > 0 &&
+      (control_bytes.back() >> (2 * num_levels - 8 * (num_control_bytes - 1))) !=
+          0) {
+    return absl::InvalidArgumentError(
+        "Control bits past the last level must be zero");
+  }
+  key.mutable_correction_words()->Reserve(num_levels);
+  for (int level = 0; level < num_levels; ++level) {
+    CorrectionWord& correction = *key.add_correction_words();
+    DPF_ASSIGN_OR_RETURN(uint64_t low, reader.ReadInteger(sizeof(uint64_t)));
+    DPF_ASSIGN_OR_RETURN(uint64_t high, reader.ReadInteger(sizeof(uint64_t)));
+    correction.mutable_seed()->set_low(low);
+    correction.mutable_seed()->set_high(high);
+    const int bit = 2 * level;
+    correction.set_control_left(
+        (control_bytes[bit / 8] >> (bit % 8) & 1) != 0);
+    correction.set_control_right(
+        (control_bytes[bit / 8] >> (bit % 8 + 1) & 1) != 0);
+    if (tree_to_hierarchy_.contains(level)) {
+      const ValueType& type =
+          parameters_[tree_to_hierarchy_.at(level)].value_type();
+      DPF_ASSIGN_OR_RETURN(uint64_t num_values,
+                           reader.ReadInteger(sizeof(uint32_t)));
+      if (num_values > reader.remaining()) {
+        return absl::InvalidArgumentError("Invalid value correction count");
+      }
+      for (uint64_t i = 0; i < num_values; ++i) {
+        DPF_RETURN_IF_ERROR(ParseValueCompact(
+            reader, type, *correction.add_value_correction()));
+      }
+    }
+  }
+  DPF_ASSIGN_OR_RETURN(uint64_t num_values,
+                       reader.ReadInteger(sizeof(uint32_t)));
+  if (num_values > reader.remaining()) {
+    return absl::InvalidArgumentError("Invalid value correction count");
+  }
+  for (uint64_t i = 0; i < num_values; ++i) {
+    DPF_RETURN_IF_ERROR(
+        ParseValueCompact(reader, parameters_.back().value_type(),
+                          *key.add_last_level_value_correction()));
+  }
+  if (reader.remaining() != 0) {
+    return absl::InvalidArgumentError(
+        "Trailing bytes after parsing a compact key");
+  }
+  // Validate once at the end, so parsed keys satisfy the same invariants as
+  // keys from `GenerateKeys`.
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  return key;
+}
+
 absl::StatusOr<DistributedPointFunction::DpfExpansion>
 DistributedPointFunction::ExpandSeeds(
     const DpfExpansion& partial_evaluations,
-    absl::Span<const CorrectionWord* const> correction_words) const {
+    absl::Span<const CorrectionWord* const> correction_words,
+    EvaluationScratch* scratch) const {
   int num_expansions = static_cast<int>(correction_words.size());
   DCHECK(num_expansions < 63);
 
@@ -282,41 +1007,63 @@ DistributedPointFunction::ExpandSeeds(
   int64_t output_size = current_level_size << num_expansions;
   std::vector<absl::uint128> prg_buffer_left(max_batch_size),
       prg_buffer_right(max_batch_size);
-
-  // Copy seeds and control bits. We will swap these after every expansion.
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  EvaluationStats* stats = GetEvaluationStatsSink();
+  const int64_t stats_start_nanos =
+      stats != nullptr ? dpf_internal::EvaluationStatsNowNanos() : 0;
+#endif
+
+  // The expansion happens in place in a single buffer of `output_size` seeds:
+  // each level is kept right-aligned, with the parents of the next expansion
+  // in the last `current_level_size` slots and their children written starting
+  // `2 * current_level_size` slots from the end. Since the children of the
+  // first s parents of a level end at least s slots before the (s+1)-th
+  // parent, a parent is only overwritten after it has been read into the PRG
+  // buffers. This halves peak memory compared to ping-ponging two full-size
+  // buffers, and avoids per-level copies. After the last level, the expansion
+  // starts at offset 0.
   DpfExpansion expansion;
-  expansion.seeds = hwy::AllocateAligned<absl::uint128>(output_size);
-  if (expansion.seeds == nullptr) {
-    return absl::ResourceExhaustedError("Memory allocation error");
-  }
+  DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                       AcquireBuffer(output_size, scratch));
+  expansion.seeds = std::move(buffer.data);
+  expansion.seeds_capacity = buffer.capacity;
   std::copy_n(partial_evaluations.seeds.get(), current_level_size,
-              expansion.seeds.get());
+              expansion.seeds.get() + (output_size - current_level_size));
   expansion.control_bits = partial_evaluations.control_bits;
-  expansion.control_bits.reserve(output_size);
-  DpfExpansion next_level_expansion;
-  next_level_expansion.seeds = hwy::AllocateAligned<absl::uint128>(output_size);
-  if (next_level_expansion.seeds == nullptr) {
-    return absl::ResourceExhaustedError("Memory allocation error");
-  }
-  next_level_expansion.control_bits.reserve(output_size);
+  expansion.control_bits.Reserve(output_size);
+  // The packed control bits are small (one bit per seed), so they are still
+  // double-buffered and swapped after every level.
+  dpf_internal::PackedControlBits next_level_control_bits;
+  next_level_control_bits.Reserve(output_size);
 
   // We use an iterative expansion here to pipeline AES as much as possible.
   for (int i = 0; i < num_expansions; ++i) {
-    next_level_expansion.control_bits.resize(0);
+#ifdef DPF_ENABLE_EVALUATION_STATS
+    if (stats != nullptr) {
+      stats->prg_left_blocks += current_level_size;
+      stats->prg_right_blocks += current_level_size;
+      stats->seeds_expanded_per_level.push_back(2 * current_level_size);
+    }
+#endif
+    next_level_control_bits.Clear();
     absl::uint128 correction_seed = absl::MakeUint128(
         correction_words[i]->seed().high(), correction_words[i]->seed().low());
     bool correction_control_left = correction_words[i]->control_left();
     bool correction_control_right = correction_words[i]->control_right();
+    absl::uint128* const read_seeds =
+        expansion.seeds.get() + (output_size - current_level_size);
+    absl::uint128* const write_seeds =
+        expansion.seeds.get() + (output_size - 2 * current_level_size);
     // Expand PRG.
     for (int64_t start_block = 0; start_block < current_level_size;
          start_block += max_batch_size) {
       int64_t batch_size =
           std::min<int64_t>(current_level_size - start_block, max_batch_size);
       DPF_RETURN_IF_ERROR(prg_left_.Evaluate(
-          absl::MakeConstSpan(expansion.seeds.get() + start_block, batch_size),
+          absl::MakeConstSpan(read_seeds + start_block, batch_size),
           absl::MakeSpan(prg_buffer_left).subspan(0, batch_size)));
       DPF_RETURN_IF_ERROR(prg_right_.Evaluate(
-          absl::MakeConstSpan(expansion.seeds.get() + start_block, batch_size),
+          absl::MakeConstSpan(read_seeds + start_block, batch_size),
           absl::MakeSpan(prg_buffer_right).subspan(0, batch_size)));
 
       // Merge results into next level of seeds and perform correction.
@@ -326,32 +1073,251 @@ DistributedPointFunction::ExpandSeeds(
           prg_buffer_left[j] ^= correction_seed;
           prg_buffer_right[j] ^= correction_seed;
         }
-        next_level_expansion.seeds[index_expanded] = prg_buffer_left[j];
-        next_level_expansion.seeds[index_expanded + 1] = prg_buffer_right[j];
-        next_level_expansion.control_bits.push_back(
-            dpf_internal::ExtractAndClearLowestBit(
-                next_level_expansion.seeds[index_expanded]));
-        next_level_expansion.control_bits.push_back(
-            dpf_internal::ExtractAndClearLowestBit(
-                next_level_expansion.seeds[index_expanded + 1]));
+        bool control_bit_left =
+            dpf_internal::ExtractAndClearLowestBit(prg_buffer_left[j]);
+        bool control_bit_right =
+            dpf_internal::ExtractAndClearLowestBit(prg_buffer_right[j]);
+        write_seeds[index_expanded] = prg_buffer_left[j];
+        write_seeds[index_expanded + 1] = prg_buffer_right[j];
         if (expansion.control_bits[start_block + j]) {
-          next_level_expansion.control_bits[index_expanded] ^=
-              correction_control_left;
-          next_level_expansion.control_bits[index_expanded + 1] ^=
-              correction_control_right;
+          control_bit_left ^= correction_control_left;
+          control_bit_right ^= correction_control_right;
         }
+        next_level_control_bits.PushBack(control_bit_left);
+        next_level_control_bits.PushBack(control_bit_right);
       }
     }
-    std::swap(expansion, next_level_expansion);
+    std::swap(expansion.control_bits, next_level_control_bits);
     current_level_size *= 2;
   }
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  if (stats != nullptr) {
+    stats->expand_nanos +=
+        dpf_internal::EvaluationStatsNowNanos() - stats_start_nanos;
+  }
+#endif
   return expansion;
 }
 
+absl::StatusOr<DistributedPointFunction::DpfExpansion>
+DistributedPointFunction::ExpandSeedsParallel(
+    const DpfExpansion& partial_evaluations,
+    absl::Span<const CorrectionWord* const> correction_words,
+    EvaluationScratch* scratch, int num_threads) const {
+  const int num_expansions = static_cast<int>(correction_words.size());
+  const auto input_size =
+      static_cast<int64_t>(partial_evaluations.control_bits.size());
+  DCHECK(num_expansions < 63);
+  const int64_t output_size = input_size << num_expansions;
+  if (num_threads <= 0) {
+    num_threads = num_evaluation_threads_;
+  }
+  if (num_threads <= 1 || output_size < num_threads * kMinSeedsPerThread) {
+    return ExpandSeeds(partial_evaluations, correction_words, scratch);
+  }
+
+  // Expand sequentially until the frontier contains at least one subtree per
+  // thread. The subtrees below the frontier are independent afterwards.
+  int sequential_levels = 0;
+  while (sequential_levels < num_expansions &&
+         (input_size << sequential_levels) < num_threads) {
+    ++sequential_levels;
+  }
+  DPF_ASSIGN_OR_RETURN(
+      DpfExpansion frontier,
+      ExpandSeeds(partial_evaluations,
+                  correction_words.subspan(0, sequential_levels), scratch));
+  if (sequential_levels == num_expansions) {
+    return frontier;
+  }
+  absl::Span<const CorrectionWord* const> remaining_correction_words =
+      correction_words.subspan(sequential_levels);
+  const auto frontier_size = static_cast<int64_t>(frontier.control_bits.size());
+  const int64_t outputs_per_frontier_seed =
+      int64_t{1} << remaining_correction_words.size();
+
+  // On multi-socket machines, the frontier is split into one contiguous shard
+  // per NUMA node, and each worker thread is pinned to its shard's node, so
+  // almost all seed traffic stays socket-local.
+  int num_nodes = dpf_internal::NumNumaNodes();
+  if (num_nodes > num_threads) {
+    num_nodes = num_threads;
+  }
+
+  // Allocate the joint output, and expand contiguous frontier ranges into
+  // their slices of the output on worker threads. `Aes128FixedKeyHash` is
+  // thread-safe, so all threads share prg_left_ and prg_right_. The scratch is
+  // not thread-safe, so only the shared output buffer is acquired from it;
+  // the per-task range buffers below allocate directly. When sharding across
+  // NUMA nodes, the output is allocated fresh instead: recycled scratch
+  // buffers already have their pages placed, while fresh pages are
+  // first-touched — and thereby placed — by the socket that expands into
+  // them. The packed control bits are two orders of magnitude smaller than
+  // the seeds, so their placement on the calling thread's node doesn't
+  // matter.
+  DpfExpansion expansion;
+  if (num_nodes > 1) {
+    expansion.seeds = hwy::AllocateAligned<absl::uint128>(output_size);
+    if (expansion.seeds == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    expansion.seeds_capacity = output_size;
+  } else {
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(output_size, scratch));
+    expansion.seeds = std::move(buffer.data);
+    expansion.seeds_capacity = buffer.capacity;
+  }
+  expansion.control_bits.Resize(output_size);
+  // Task boundaries are multiples of `range_alignment` frontier seeds, so
+  // that each task's slice of the packed output control bits starts at a word
+  // boundary. Otherwise, two threads could write to the same word
+  // concurrently. `outputs_per_frontier_seed` is a power of two, so aligning
+  // `range_start` to `range_alignment` frontier seeds aligns `range_start *
+  // outputs_per_frontier_seed` to a full word.
+  const int64_t range_alignment = std::max<int64_t>(
+      int64_t{1},
+      dpf_internal::PackedControlBits::kBitsPerWord /
+          std::min(outputs_per_frontier_seed,
+                   dpf_internal::PackedControlBits::kBitsPerWord));
+  // Instead of statically assigning one range per thread, the frontier is
+  // split into tasks of roughly `kMinSeedsPerThread` outputs each, which
+  // threads claim dynamically from a shared counter. Threads that finish
+  // their tasks early pick up remaining ones instead of idling, so skewed
+  // per-call workloads (e.g. heavy-hitters prefix sets of varying size) and
+  // stragglers don't leave cores unused.
+  const int64_t task_size =
+      range_alignment *
+      std::max<int64_t>(int64_t{1}, kMinSeedsPerThread / (range_alignment *
+                                                          outputs_per_frontier_seed));
+  // One contiguous frontier shard per NUMA node, each with its own task
+  // counter. Shard boundaries are multiples of `range_alignment`, so tasks
+  // never straddle shards and the word-boundary argument above still holds.
+  struct ExpansionShard {
+    int64_t begin = 0;
+    int64_t end = 0;
+    std::atomic<int64_t> next_range_start{0};
+  };
+  int64_t shard_size = (frontier_size + num_nodes - 1) / num_nodes;
+  shard_size =
+      range_alignment * ((shard_size + range_alignment - 1) / range_alignment);
+  auto shards = std::make_unique<ExpansionShard[]>(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    shards[i].begin = std::min<int64_t>(i * shard_size, frontier_size);
+    shards[i].end = std::min<int64_t>((i + 1) * shard_size, frontier_size);
+    shards[i].next_range_start = shards[i].begin;
+  }
+  std::vector<absl::Status> thread_statuses(num_threads, absl::OkStatus());
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([this, &frontier, &expansion,
+                          remaining_correction_words, task_size,
+                          outputs_per_frontier_seed, &shards, num_nodes,
+                          home_node = t % num_nodes,
+                          &status = thread_statuses[t]] {
+      if (num_nodes > 1) {
+        // Best effort: a failed pin only costs locality, not correctness.
+        dpf_internal::PinCurrentThreadToNode(home_node);
+      }
+      // Drain the home shard first; once it is exhausted, steal tasks from
+      // the other nodes' shards so stragglers don't leave cores idle. Stolen
+      // tasks pay cross-socket latency, but only at the tail of the call.
+      for (int n = 0; n < num_nodes; ++n) {
+        ExpansionShard& shard = shards[(home_node + n) % num_nodes];
+        while (true) {
+          const int64_t range_start = shard.next_range_start.fetch_add(
+              task_size, std::memory_order_relaxed);
+          if (range_start >= shard.end) {
+            break;
+          }
+          const int64_t range_end =
+              std::min(range_start + task_size, shard.end);
+          const int64_t range_size = range_end - range_start;
+          DpfExpansion range;
+          range.seeds = hwy::AllocateAligned<absl::uint128>(range_size);
+          if (range.seeds == nullptr) {
+            status = absl::ResourceExhaustedError("Memory allocation error");
+            return;
+          }
+          std::copy_n(frontier.seeds.get() + range_start, range_size,
+                      range.seeds.get());
+          range.control_bits.Resize(range_size);
+          range.control_bits.CopyBitsFrom(frontier.control_bits, range_start,
+                                          range_size, 0);
+          absl::StatusOr<DpfExpansion> expanded_range =
+              ExpandSeeds(range, remaining_correction_words);
+          if (!expanded_range.ok()) {
+            status = expanded_range.status();
+            return;
+          }
+          // Frontier ranges are contiguous, so each range expands into a
+          // contiguous slice of the output.
+          std::copy_n(expanded_range->seeds.get(),
+                      range_size * outputs_per_frontier_seed,
+                      expansion.seeds.get() +
+                          range_start * outputs_per_frontier_seed);
+          // This is safe to do concurrently because all destination ranges
+          // start at word boundaries; see `range_alignment` above.
+          expansion.control_bits.CopyBitsFrom(
+              expanded_range->control_bits, 0,
+              range_size * outputs_per_frontier_seed,
+              range_start * outputs_per_frontier_seed);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const absl::Status& status : thread_statuses) {
+    DPF_RETURN_IF_ERROR(status);
+  }
+  RecycleBuffer(std::move(frontier.seeds), frontier.seeds_capacity, scratch);
+  return expansion;
+}
+
+absl::Status DistributedPointFunction::SetNumEvaluationThreads(
+    int num_threads) {
+  if (num_threads < 1) {
+    return absl::InvalidArgumentError("`num_threads` must be at least 1");
+  }
+  num_evaluation_threads_ = num_threads;
+  return absl::OkStatus();
+}
+
+bool DistributedPointFunction::EvaluationStatsEnabled() {
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void DistributedPointFunction::SetEvaluationStatsSink(EvaluationStats* sink) {
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  evaluation_stats_sink = sink;
+#else
+  (void)sink;
+#endif
+}
+
+EvaluationStats* DistributedPointFunction::GetEvaluationStatsSink() {
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  return evaluation_stats_sink;
+#else
+  return nullptr;
+#endif
+}
+
+absl::string_view DistributedPointFunction::GetHwyModeAsString() {
+  return dpf_internal::GetHwyModeAsString();
+}
+
 absl::StatusOr<DistributedPointFunction::DpfExpansion>
 DistributedPointFunction::ComputePartialEvaluations(
     absl::Span<const absl::uint128> prefixes, int hierarchy_level,
-    bool update_ctx, EvaluationContext& ctx) const {
+    bool update_ctx, EvaluationContext& ctx, EvaluationScratch* scratch) const {
   int64_t num_prefixes = static_cast<int64_t>(prefixes.size());
 
   DpfExpansion partial_evaluations;
@@ -359,64 +1325,96 @@ DistributedPointFunction::ComputePartialEvaluations(
   int stop_level = hierarchy_to_tree_[hierarchy_level];
   if (ctx.partial_evaluations_size() > 0 && start_level <= stop_level) {
     // We have partial evaluations from a tree level before the current one.
-    // Parse `ctx.partial_evaluations` into a btree_map for quick lookups up by
-    // prefix. We use a btree_map because `ctx.partial_evaluations()` will
-    // usually be sorted.
-    absl::btree_map<absl::uint128, std::pair<absl::uint128, bool>>
-        previous_partial_evaluations;
+    // Parse `ctx.partial_evaluations` into sorted flat parallel arrays of
+    // prefixes, seeds, and control bits. `ctx.partial_evaluations()` is
+    // written in the order of the caller's prefixes and will therefore
+    // usually already be sorted, making the sortedness check below a single
+    // linear pass.
+    const int64_t num_previous = ctx.partial_evaluations_size();
+    std::vector<absl::uint128> previous_prefixes;
+    std::vector<absl::uint128> previous_seeds;
+    std::vector<bool> previous_control_bits;
+    previous_prefixes.reserve(num_previous);
+    previous_seeds.reserve(num_previous);
+    previous_control_bits.reserve(num_previous);
+    bool previous_is_sorted = true;
     for (const PartialEvaluation& element : ctx.partial_evaluations()) {
       absl::uint128 prefix =
           absl::MakeUint128(element.prefix().high(), element.prefix().low());
-      // Try inserting `(seed, control_bit)` at `prefix` into
-      // partial_evaluations. Return an error if `prefix` is already present
-      // with a different seed or control bit.
-      auto value = std::make_pair(
-          absl::MakeUint128(element.seed().high(), element.seed().low()),
-          element.control_bit());
-      auto it = previous_partial_evaluations.try_emplace(
-          previous_partial_evaluations.end(), prefix, value);
-      if (it->second != value) {
+      if (!previous_prefixes.empty() && prefix < previous_prefixes.back()) {
+        previous_is_sorted = false;
+      }
+      previous_prefixes.push_back(prefix);
+      previous_seeds.push_back(
+          absl::MakeUint128(element.seed().high(), element.seed().low()));
+      previous_control_bits.push_back(element.control_bit());
+    }
+    if (!previous_is_sorted) {
+      // Sort the parallel arrays by prefix through a permutation.
+      std::vector<int64_t> order(num_previous);
+      std::iota(order.begin(), order.end(), int64_t{0});
+      std::sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+        return previous_prefixes[a] < previous_prefixes[b];
+      });
+      std::vector<absl::uint128> sorted_prefixes(num_previous),
+          sorted_seeds(num_previous);
+      std::vector<bool> sorted_control_bits(num_previous);
+      for (int64_t i = 0; i < num_previous; ++i) {
+        sorted_prefixes[i] = previous_prefixes[order[i]];
+        sorted_seeds[i] = previous_seeds[order[i]];
+        sorted_control_bits[i] = previous_control_bits[order[i]];
+      }
+      previous_prefixes = std::move(sorted_prefixes);
+      previous_seeds = std::move(sorted_seeds);
+      previous_control_bits = std::move(sorted_control_bits);
+    }
+    // Duplicate prefixes are now adjacent. They are allowed as long as seed
+    // and control bit match.
+    for (int64_t i = 1; i < num_previous; ++i) {
+      if (previous_prefixes[i] == previous_prefixes[i - 1] &&
+          (previous_seeds[i] != previous_seeds[i - 1] ||
+           previous_control_bits[i] != previous_control_bits[i - 1])) {
         return absl::InvalidArgumentError(
             "Duplicate prefix in `ctx.partial_evaluations()` with mismatching "
             "seed or control bit");
       }
     }
-    // Now select all partial evaluations from the map that correspond to
-    // `prefixes`.
-    partial_evaluations.seeds =
-        hwy::AllocateAligned<absl::uint128>(num_prefixes);
-    if (partial_evaluations.seeds == nullptr) {
-      return absl::ResourceExhaustedError("Memory allocation error");
-    }
-    partial_evaluations.control_bits.reserve(num_prefixes);
+    // Now select all partial evaluations that correspond to `prefixes`. Since
+    // `prefixes` is usually sorted as well, this amounts to a linear merge of
+    // the two sorted spans; see `FindSortedPrefix`.
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(num_prefixes, scratch));
+    partial_evaluations.seeds = std::move(buffer.data);
+    partial_evaluations.seeds_capacity = buffer.capacity;
+    partial_evaluations.control_bits.Reserve(num_prefixes);
+    int64_t cursor = 0;
     for (int64_t i = 0; i < num_prefixes; ++i) {
       absl::uint128 previous_prefix = 0;
       if (stop_level - start_level < 128) {
         previous_prefix = prefixes[i] >> (stop_level - start_level);
       }
-      auto it = previous_partial_evaluations.find(previous_prefix);
-      if (it == previous_partial_evaluations.end()) {
+      const int64_t index =
+          FindSortedPrefix(previous_prefixes, previous_prefix, cursor);
+      if (index < 0) {
         return absl::InvalidArgumentError(absl::StrCat(
             "Prefix not present in ctx.partial_evaluations at hierarchy level ",
             hierarchy_level));
       }
-      const std::pair<absl::uint128, bool>& partial_evaluation = it->second;
       partial_evaluations.seeds[partial_evaluations.control_bits.size()] =
-          partial_evaluation.first;
-      partial_evaluations.control_bits.push_back(partial_evaluation.second);
+          previous_seeds[index];
+      partial_evaluations.control_bits.PushBack(previous_control_bits[index]);
     }
   } else {
     // No partial evaluations in `ctx` -> Start from the beginning.
-    partial_evaluations.seeds =
-        hwy::AllocateAligned<absl::uint128>(num_prefixes);
-    if (partial_evaluations.seeds == nullptr) {
-      return absl::ResourceExhaustedError("Memory allocation error");
-    }
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(num_prefixes, scratch));
+    partial_evaluations.seeds = std::move(buffer.data);
+    partial_evaluations.seeds_capacity = buffer.capacity;
     auto seeds = absl::MakeSpan(partial_evaluations.seeds.get(), num_prefixes);
     std::fill(
         seeds.begin(), seeds.end(),
         absl::MakeUint128(ctx.key().seed().high(), ctx.key().seed().low()));
-    partial_evaluations.control_bits.resize(
+    partial_evaluations.control_bits.Resize(
         num_prefixes, static_cast<bool>(ctx.key().party()));
     start_level = 0;
   }
@@ -428,7 +1426,7 @@ DistributedPointFunction::ComputePartialEvaluations(
       EvaluateSeeds(seeds, partial_evaluations.control_bits, prefixes,
                     absl::MakeConstSpan(ctx.key().correction_words())
                         .subspan(start_level, stop_level - start_level),
-                    seeds, absl::MakeSpan(partial_evaluations.control_bits)));
+                    seeds, partial_evaluations.control_bits));
 
   // Update `partial_evaluations` in `ctx` if there are more evaluations to
   // come.
@@ -455,21 +1453,22 @@ DistributedPointFunction::ComputePartialEvaluations(
 absl::StatusOr<DistributedPointFunction::DpfExpansion>
 DistributedPointFunction::ExpandAndUpdateContext(
     int hierarchy_level, absl::Span<const absl::uint128> prefixes,
-    EvaluationContext& ctx) const {
+    EvaluationContext& ctx, EvaluationScratch* scratch,
+    int num_threads) const {
   // Expand seeds by expanding either the DPF key seed, or
   // `ctx.partial_evaluations` for the given `prefixes`.
   DpfExpansion selected_partial_evaluations;
   int start_level = 0;
   if (prefixes.empty()) {
     // First expansion -> Expand seed of the DPF key.
-    selected_partial_evaluations.seeds = hwy::AllocateAligned<absl::uint128>(1);
-    if (selected_partial_evaluations.seeds == nullptr) {
-      return absl::ResourceExhaustedError("Memory allocation error");
-    }
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(1, scratch));
+    selected_partial_evaluations.seeds = std::move(buffer.data);
+    selected_partial_evaluations.seeds_capacity = buffer.capacity;
     selected_partial_evaluations.seeds[0] =
         absl::MakeUint128(ctx.key().seed().high(), ctx.key().seed().low());
-    selected_partial_evaluations.control_bits = {
-        static_cast<bool>(ctx.key().party())};
+    selected_partial_evaluations.control_bits.PushBack(
+        static_cast<bool>(ctx.key().party()));
   } else {
     // Second or later expansion -> Extract all seeds for `prefixes` from
     // `ctx.partial_evaluations`. Update `ctx` if this is not the last
@@ -480,7 +1479,7 @@ DistributedPointFunction::ExpandAndUpdateContext(
     DPF_ASSIGN_OR_RETURN(
         selected_partial_evaluations,
         ComputePartialEvaluations(prefixes, ctx.previous_hierarchy_level(),
-                                  update_ctx, ctx));
+                                  update_ctx, ctx, scratch));
     start_level = hierarchy_to_tree_[ctx.previous_hierarchy_level()];
   }
 
@@ -488,25 +1487,370 @@ DistributedPointFunction::ExpandAndUpdateContext(
   int stop_level = hierarchy_to_tree_[hierarchy_level];
   DPF_ASSIGN_OR_RETURN(
       DpfExpansion expansion,
-      ExpandSeeds(selected_partial_evaluations,
-                  absl::MakeConstSpan(ctx.key().correction_words())
-                      .subspan(start_level, stop_level - start_level)));
+      ExpandSeedsParallel(selected_partial_evaluations,
+                          absl::MakeConstSpan(ctx.key().correction_words())
+                              .subspan(start_level, stop_level - start_level),
+                          scratch, num_threads));
+  RecycleBuffer(std::move(selected_partial_evaluations.seeds),
+                selected_partial_evaluations.seeds_capacity, scratch);
 
   // Update hierarchy level in ctx.
   ctx.set_previous_hierarchy_level(hierarchy_level);
   return expansion;
 }
 
-absl::StatusOr<hwy::AlignedFreeUniquePtr<absl::uint128[]>>
+absl::StatusOr<DistributedPointFunction::DpfExpansion>
+DistributedPointFunction::ComputePartialEvaluations(
+    absl::Span<const absl::uint128> prefixes, int hierarchy_level,
+    bool update_state, EvaluationState& state,
+    EvaluationScratch* scratch) const {
+  int64_t num_prefixes = static_cast<int64_t>(prefixes.size());
+
+  DpfExpansion partial_evaluations;
+  int start_level = hierarchy_to_tree_[state.partial_evaluations_level_];
+  int stop_level = hierarchy_to_tree_[hierarchy_level];
+  if (state.expansion_hierarchy_level_ == hierarchy_level &&
+      state.expansion_control_bits_.size() > 0) {
+    // The previous call retained its full expansion at `stop_level`, so the
+    // seeds for the surviving `prefixes` can be selected from it directly,
+    // without any PRG evaluations. Pruned subtrees are simply never read.
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(num_prefixes, scratch));
+    partial_evaluations.seeds = std::move(buffer.data);
+    partial_evaluations.seeds_capacity = buffer.capacity;
+    partial_evaluations.control_bits.Reserve(num_prefixes);
+    const int log_stride = state.expansion_log_stride_;
+    absl::uint128 stride_mask = absl::Uint128Max();
+    if (log_stride < 128) {
+      stride_mask = (absl::uint128{1} << log_stride) - 1;
+    }
+    int64_t cursor = 0;
+    for (int64_t i = 0; i < num_prefixes; ++i) {
+      absl::uint128 parent_prefix = 0;
+      if (log_stride < 128) {
+        parent_prefix = prefixes[i] >> log_stride;
+      }
+      int64_t index = 0;
+      if (!state.expansion_prefixes_.empty()) {
+        index =
+            FindSortedPrefix(state.expansion_prefixes_, parent_prefix, cursor);
+        if (index < 0) {
+          return absl::InvalidArgumentError(absl::StrCat(
+              "Prefix not present in the partial evaluations of `state` at "
+              "hierarchy level ",
+              hierarchy_level));
+        }
+      }
+      const int64_t seed_index =
+          (index << log_stride) +
+          static_cast<int64_t>(prefixes[i] & stride_mask);
+      partial_evaluations.seeds[partial_evaluations.control_bits.size()] =
+          state.expansion_seeds_[seed_index];
+      partial_evaluations.control_bits.PushBack(
+          state.expansion_control_bits_[seed_index]);
+    }
+    // The selected seeds are already at `stop_level`, so the path evaluation
+    // below has nothing to do.
+    start_level = stop_level;
+  } else if (!state.partial_prefixes_.empty() && start_level <= stop_level) {
+    // We have partial evaluations from a tree level before the current one.
+    // `state.partial_prefixes_` is sorted, so sorted query prefixes resolve
+    // through a linear merge, and unsorted ones through a binary search; see
+    // `FindSortedPrefix`.
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(num_prefixes, scratch));
+    partial_evaluations.seeds = std::move(buffer.data);
+    partial_evaluations.seeds_capacity = buffer.capacity;
+    partial_evaluations.control_bits.Reserve(num_prefixes);
+    int64_t cursor = 0;
+    for (int64_t i = 0; i < num_prefixes; ++i) {
+      absl::uint128 previous_prefix = 0;
+      if (stop_level - start_level < 128) {
+        previous_prefix = prefixes[i] >> (stop_level - start_level);
+      }
+      const int64_t index =
+          FindSortedPrefix(state.partial_prefixes_, previous_prefix, cursor);
+      if (index < 0) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Prefix not present in the partial evaluations of `state` at "
+            "hierarchy level ",
+            hierarchy_level));
+      }
+      partial_evaluations.seeds[partial_evaluations.control_bits.size()] =
+          state.partial_seeds_[index];
+      partial_evaluations.control_bits.PushBack(
+          state.partial_control_bits_[index]);
+    }
+  } else {
+    // No partial evaluations in `state` -> Start from the beginning.
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(num_prefixes, scratch));
+    partial_evaluations.seeds = std::move(buffer.data);
+    partial_evaluations.seeds_capacity = buffer.capacity;
+    auto seeds = absl::MakeSpan(partial_evaluations.seeds.get(), num_prefixes);
+    std::fill(seeds.begin(), seeds.end(),
+              absl::MakeUint128(state.key_.seed().high(),
+                                state.key_.seed().low()));
+    partial_evaluations.control_bits.Resize(
+        num_prefixes, static_cast<bool>(state.key_.party()));
+    start_level = 0;
+  }
+
+  // Evaluate the DPF up to current_tree_level.
+  auto seeds = absl::MakeSpan(partial_evaluations.seeds.get(),
+                              partial_evaluations.control_bits.size());
+  DPF_RETURN_IF_ERROR(
+      EvaluateSeeds(seeds, partial_evaluations.control_bits, prefixes,
+                    absl::MakeConstSpan(state.key_.correction_words())
+                        .subspan(start_level, stop_level - start_level),
+                    seeds, partial_evaluations.control_bits));
+
+  // Save the partial evaluations back to `state` if there are more
+  // evaluations to come. Unlike the proto-backed context, this is a plain
+  // copy of the seed array plus (in the common case of sorted `prefixes`) the
+  // prefixes themselves.
+  if (update_state) {
+    state.partial_seeds_ =
+        hwy::AllocateAligned<absl::uint128>(std::max<int64_t>(num_prefixes, 1));
+    if (state.partial_seeds_ == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    state.partial_prefixes_.resize(num_prefixes);
+    state.partial_control_bits_.Clear();
+    state.partial_control_bits_.Reserve(num_prefixes);
+    if (std::is_sorted(prefixes.begin(), prefixes.end())) {
+      std::copy(prefixes.begin(), prefixes.end(),
+                state.partial_prefixes_.begin());
+      std::copy_n(partial_evaluations.seeds.get(), num_prefixes,
+                  state.partial_seeds_.get());
+      for (int64_t i = 0; i < num_prefixes; ++i) {
+        state.partial_control_bits_.PushBack(
+            partial_evaluations.control_bits[i]);
+      }
+    } else {
+      // Sort via an index permutation so lookups above can use binary search.
+      std::vector<int64_t> order(num_prefixes);
+      std::iota(order.begin(), order.end(), int64_t{0});
+      std::sort(order.begin(), order.end(), [&prefixes](int64_t a, int64_t b) {
+        return prefixes[a] < prefixes[b];
+      });
+      for (int64_t i = 0; i < num_prefixes; ++i) {
+        state.partial_prefixes_[i] = prefixes[order[i]];
+        state.partial_seeds_[i] = partial_evaluations.seeds[order[i]];
+        state.partial_control_bits_.PushBack(
+            partial_evaluations.control_bits[order[i]]);
+      }
+    }
+  } else {
+    state.partial_prefixes_.clear();
+    state.partial_seeds_ = nullptr;
+    state.partial_control_bits_.Clear();
+  }
+  state.partial_evaluations_level_ = hierarchy_level;
+  return partial_evaluations;
+}
+
+absl::StatusOr<DistributedPointFunction::DpfExpansion>
+DistributedPointFunction::ExpandAndUpdateState(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationState& state, EvaluationScratch* scratch,
+    int num_threads) const {
+  // Expand seeds by expanding either the DPF key seed, or the partial
+  // evaluations in `state` for the given `prefixes`.
+  DpfExpansion selected_partial_evaluations;
+  int start_level = 0;
+  if (prefixes.empty()) {
+    // First expansion -> Expand seed of the DPF key.
+    DPF_ASSIGN_OR_RETURN(EvaluationScratch::Buffer buffer,
+                         AcquireBuffer(1, scratch));
+    selected_partial_evaluations.seeds = std::move(buffer.data);
+    selected_partial_evaluations.seeds_capacity = buffer.capacity;
+    selected_partial_evaluations.seeds[0] =
+        absl::MakeUint128(state.key_.seed().high(), state.key_.seed().low());
+    selected_partial_evaluations.control_bits.PushBack(
+        static_cast<bool>(state.key_.party()));
+  } else {
+    // Second or later expansion -> Extract all seeds for `prefixes` from
+    // `state`. Update `state` if this is not the last evaluation.
+    bool update_state =
+        (hierarchy_level < static_cast<int>(parameters_.size()) - 1);
+    DCHECK(state.previous_hierarchy_level_ >= 0);
+    DPF_ASSIGN_OR_RETURN(
+        selected_partial_evaluations,
+        ComputePartialEvaluations(prefixes, state.previous_hierarchy_level_,
+                                  update_state, state, scratch));
+    start_level = hierarchy_to_tree_[state.previous_hierarchy_level_];
+  }
+
+  // Expand up to the next hierarchy level.
+  int stop_level = hierarchy_to_tree_[hierarchy_level];
+  DPF_ASSIGN_OR_RETURN(
+      DpfExpansion expansion,
+      ExpandSeedsParallel(selected_partial_evaluations,
+                          absl::MakeConstSpan(state.key_.correction_words())
+                              .subspan(start_level, stop_level - start_level),
+                          scratch, num_threads));
+  RecycleBuffer(std::move(selected_partial_evaluations.seeds),
+                selected_partial_evaluations.seeds_capacity, scratch);
+
+  // Retain the expansion for the next call if requested; see
+  // `EvaluationState::set_retain_expansion`. Only sorted prefixes are
+  // retained, so the selection above can resolve parents with
+  // `FindSortedPrefix`. Any previously retained expansion is dropped either
+  // way, which is what lazily frees pruned subtrees.
+  if (state.retain_expansion_ &&
+      hierarchy_level < static_cast<int>(parameters_.size()) - 1 &&
+      std::is_sorted(prefixes.begin(), prefixes.end())) {
+    const int64_t expansion_size =
+        static_cast<int64_t>(expansion.control_bits.size());
+    state.expansion_seeds_ = hwy::AllocateAligned<absl::uint128>(
+        std::max<int64_t>(expansion_size, 1));
+    if (state.expansion_seeds_ == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    std::copy_n(expansion.seeds.get(), expansion_size,
+                state.expansion_seeds_.get());
+    state.expansion_control_bits_ = expansion.control_bits;
+    state.expansion_prefixes_.assign(prefixes.begin(), prefixes.end());
+    state.expansion_log_stride_ = stop_level - start_level;
+    state.expansion_hierarchy_level_ = hierarchy_level;
+  } else {
+    state.expansion_prefixes_.clear();
+    state.expansion_seeds_ = nullptr;
+    state.expansion_control_bits_.Clear();
+    state.expansion_hierarchy_level_ = -1;
+  }
+
+  state.previous_hierarchy_level_ = hierarchy_level;
+  return expansion;
+}
+
+absl::Status DistributedPointFunction::ValidateEvaluateUntilParams(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    int previous_hierarchy_level) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  if (hierarchy_level <= previous_hierarchy_level) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be greater than "
+        "`ctx.previous_hierarchy_level`");
+  }
+  if ((previous_hierarchy_level < 0) != (prefixes.empty())) {
+    return absl::InvalidArgumentError(
+        "`prefixes` must be empty if and only if this is the first call with "
+        "`ctx`.");
+  }
+
+  int previous_log_domain_size = 0;
+  if (!prefixes.empty()) {
+    DCHECK(previous_hierarchy_level >= 0);
+    previous_log_domain_size =
+        parameters_[previous_hierarchy_level].log_domain_size();
+    for (absl::uint128 prefix : prefixes) {
+      if (previous_log_domain_size < 128 &&
+          prefix >= (absl::uint128{1} << previous_log_domain_size)) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Index %d out of range for hierarchy level %d",
+                            prefix, previous_hierarchy_level));
+      }
+    }
+  }
+  if (parameters_[hierarchy_level].log_domain_size() -
+          previous_log_domain_size >
+      62) {
+    return absl::InvalidArgumentError(
+        "Output size would be larger than 2**62. Please evaluate fewer "
+        "hierarchy levels at once.");
+  }
+  return absl::OkStatus();
+}
+
+void DistributedPointFunction::ComputeTreeIndices(
+    absl::Span<const absl::uint128> prefixes, int previous_hierarchy_level,
+    std::vector<absl::uint128>& tree_indices,
+    std::vector<std::pair<int64_t, int>>& prefix_map) const {
+  const int64_t prefixes_size = static_cast<int64_t>(prefixes.size());
+  prefix_map.clear();
+  prefix_map.reserve(prefixes_size);
+
+  // Translate all prefixes in one batched pass; see
+  // `dpf_internal::DomainToTreeAndBlockIndices`.
+  tree_indices.resize(prefixes_size);
+  std::vector<int> block_indices(prefixes_size);
+  if (prefixes_size > 0 &&
+      !dpf_internal::DomainToTreeAndBlockIndices(
+          prefixes_size, prefixes.data(),
+          parameters_[previous_hierarchy_level].log_domain_size() -
+              hierarchy_to_tree_[previous_hierarchy_level],
+          tree_indices.data(), block_indices.data())) {
+    for (int64_t i = 0; i < prefixes_size; ++i) {
+      tree_indices[i] = DomainToTreeIndex(prefixes[i], previous_hierarchy_level);
+      block_indices[i] = DomainToBlockIndex(prefixes[i],
+                                            previous_hierarchy_level);
+    }
+  }
+
+  if (std::is_sorted(tree_indices.begin(), tree_indices.end())) {
+    // `prefixes` (and thus `tree_indices`) is usually sorted, so duplicates
+    // are adjacent and can be compacted in place with a single unique pass.
+    int64_t num_unique = 0;
+    for (int64_t i = 0; i < prefixes_size; ++i) {
+      if (num_unique == 0 || tree_indices[i] != tree_indices[num_unique - 1]) {
+        tree_indices[num_unique++] = tree_indices[i];
+      }
+      prefix_map.push_back(std::make_pair(num_unique - 1, block_indices[i]));
+    }
+    tree_indices.resize(num_unique);
+    return;
+  }
+
+  // Unsorted prefixes: deduplicate through an inverse map, preserving the
+  // order of first appearance.
+  std::vector<absl::uint128> translated_tree_indices = std::move(tree_indices);
+  tree_indices.clear();
+  tree_indices.reserve(prefixes_size);
+  absl::btree_map<absl::uint128, int64_t> tree_indices_inverse;
+  for (int64_t i = 0; i < prefixes_size; ++i) {
+    // Check if `tree_index` already exists in `tree_indices`.
+    size_t previous_size = tree_indices_inverse.size();
+    auto it = tree_indices_inverse.try_emplace(tree_indices_inverse.end(),
+                                               translated_tree_indices[i],
+                                               tree_indices.size());
+    if (tree_indices_inverse.size() > previous_size) {
+      tree_indices.push_back(translated_tree_indices[i]);
+    }
+    prefix_map.push_back(std::make_pair(it->second, block_indices[i]));
+  }
+}
+
+absl::StatusOr<EvaluationScratch::Buffer>
 DistributedPointFunction::HashExpandedSeeds(
-    int hierarchy_level, absl::Span<const absl::uint128> expansion) const {
+    int hierarchy_level, absl::Span<const absl::uint128> expansion,
+    EvaluationScratch* scratch) const {
   const auto expansion_size = static_cast<int64_t>(expansion.size());
   const int blocks_needed = blocks_needed_[hierarchy_level];
-  auto hashed_expansion =
-      hwy::AllocateAligned<absl::uint128>(expansion_size * blocks_needed);
-  if (hashed_expansion == nullptr) {
-    return absl::ResourceExhaustedError("Memory allocation error");
-  }
+  DPF_ASSIGN_OR_RETURN(
+      EvaluationScratch::Buffer hashed_expansion,
+      AcquireBuffer(expansion_size * blocks_needed, scratch));
+  DPF_RETURN_IF_ERROR(HashExpandedSeedsInto(hierarchy_level, expansion,
+                                            hashed_expansion.data.get()));
+  return hashed_expansion;
+}
+
+absl::Status DistributedPointFunction::HashExpandedSeedsInto(
+    int hierarchy_level, absl::Span<const absl::uint128> expansion,
+    absl::uint128* hashed_expansion) const {
+  const auto expansion_size = static_cast<int64_t>(expansion.size());
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  EvaluationStats* stats = GetEvaluationStatsSink();
+  const int64_t stats_start_nanos =
+      stats != nullptr ? dpf_internal::EvaluationStatsNowNanos() : 0;
+#endif
   for (int64_t i = 0; i < expansion_size; ++i) {
     for (int j = 0; j < blocks_needed; ++j) {
       hashed_expansion[i * blocks_needed + j] = expansion[i] + j;
@@ -516,11 +1860,60 @@ DistributedPointFunction::HashExpandedSeeds(
   // Evaluate PRG in place (this is safe as `Evaluate` creates a copy of the
   // input).
   absl::Span<absl::uint128> hashed_expansion_span(
-      hashed_expansion.get(), expansion_size * blocks_needed);
+      hashed_expansion, expansion_size * blocks_needed);
   DPF_RETURN_IF_ERROR(
       prg_value_.Evaluate(hashed_expansion_span, hashed_expansion_span));
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  if (stats != nullptr) {
+    stats->prg_value_blocks += expansion_size * blocks_needed;
+    stats->hash_nanos +=
+        dpf_internal::EvaluationStatsNowNanos() - stats_start_nanos;
+  }
+#endif
+  return absl::OkStatus();
+}
 
-  return hashed_expansion;
+absl::Status DistributedPointFunction::PipelineHashAndCorrect(
+    int64_t num_blocks, int64_t chunk_blocks, int64_t buffer_size,
+    absl::FunctionRef<absl::Status(int64_t begin, int64_t end,
+                                   absl::uint128* hashed)>
+        hash_chunk,
+    absl::FunctionRef<void(int64_t begin, int64_t end,
+                           const absl::uint128* hashed)>
+        correct_chunk) {
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> buffers[2] = {
+      hwy::AllocateAligned<absl::uint128>(buffer_size),
+      hwy::AllocateAligned<absl::uint128>(buffer_size)};
+  if (buffers[0] == nullptr || buffers[1] == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  const int64_t num_chunks = (num_blocks + chunk_blocks - 1) / chunk_blocks;
+  DPF_RETURN_IF_ERROR(
+      hash_chunk(0, std::min(chunk_blocks, num_blocks), buffers[0].get()));
+  for (int64_t k = 0; k < num_chunks; ++k) {
+    // Hash the next chunk into the other buffer while this thread corrects
+    // the current one. Thread creation is amortized over a full chunk of AES
+    // evaluations. `hash_chunk` only writes to `buffer`, so it can run
+    // concurrently with `correct_chunk` on the current buffer.
+    std::thread hasher;
+    absl::Status hash_status = absl::OkStatus();
+    if (k + 1 < num_chunks) {
+      const int64_t begin = (k + 1) * chunk_blocks;
+      const int64_t end = std::min(begin + chunk_blocks, num_blocks);
+      absl::uint128* buffer = buffers[(k + 1) % 2].get();
+      hasher = std::thread([hash_chunk, begin, end, buffer, &hash_status] {
+        hash_status = hash_chunk(begin, end, buffer);
+      });
+    }
+    correct_chunk(k * chunk_blocks,
+                  std::min((k + 1) * chunk_blocks, num_blocks),
+                  buffers[k % 2].get());
+    if (hasher.joinable()) {
+      hasher.join();
+    }
+    DPF_RETURN_IF_ERROR(hash_status);
+  }
+  return absl::OkStatus();
 }
 
 absl::StatusOr<std::string>
@@ -640,6 +2033,20 @@ DistributedPointFunction::GenerateKeysIncremental(
         "`alpha` must be smaller than the output domain size");
   }
 
+  // Compute value corrections through the string-keyed function map, looking
+  // up the registered function for each hierarchy level's value type.
+  return GenerateKeysImpl(
+      alpha, [this, beta](int hierarchy_level,
+                          absl::Span<const absl::uint128> seeds,
+                          absl::uint128 alpha_prefix, bool invert) {
+        return ComputeValueCorrection(hierarchy_level, seeds, alpha_prefix,
+                                      beta[hierarchy_level], invert);
+      });
+}
+
+absl::StatusOr<std::pair<DpfKey, DpfKey>>
+DistributedPointFunction::GenerateKeysImpl(
+    absl::uint128 alpha, ValueCorrectionCallback compute_value_correction) {
   std::array<DpfKey, 2> keys;
   keys[0].set_party(0);
   keys[1].set_party(1);
@@ -668,7 +2075,8 @@ DistributedPointFunction::GenerateKeysIncremental(
   keys[0].mutable_correction_words()->Reserve(tree_levels_needed_ - 1);
   keys[1].mutable_correction_words()->Reserve(tree_levels_needed_ - 1);
   for (int i = 1; i < tree_levels_needed_; i++) {
-    DPF_RETURN_IF_ERROR(GenerateNext(i, alpha, beta, absl::MakeSpan(seeds),
+    DPF_RETURN_IF_ERROR(GenerateNext(i, alpha, compute_value_correction,
+                                     absl::MakeSpan(seeds),
                                      absl::MakeSpan(control_bits),
                                      absl::MakeSpan(keys)));
   }
@@ -676,8 +2084,8 @@ DistributedPointFunction::GenerateKeysIncremental(
   // Compute output correction word for last layer.
   DPF_ASSIGN_OR_RETURN(
       std::vector<Value> last_level_value_correction,
-      ComputeValueCorrection(parameters_.size() - 1, seeds, alpha, beta.back(),
-                             control_bits[1]));
+      compute_value_correction(parameters_.size() - 1, seeds, alpha,
+                               control_bits[1]));
   for (const Value& value : last_level_value_correction) {
     *(keys[0].add_last_level_value_correction()) = value;
     *(keys[1].add_last_level_value_correction()) = value;
@@ -686,6 +2094,114 @@ DistributedPointFunction::GenerateKeysIncremental(
   return std::make_pair(std::move(keys[0]), std::move(keys[1]));
 }
 
+absl::StatusOr<std::vector<std::pair<DpfKey, DpfKey>>>
+DistributedPointFunction::GenerateKeysBatch(
+    absl::Span<const absl::uint128> alphas, absl::Span<const Value> betas) {
+  const auto num_keys = static_cast<int64_t>(alphas.size());
+  const int num_levels = static_cast<int>(parameters_.size());
+
+  // Check validity of betas.
+  if (static_cast<int64_t>(betas.size()) != num_keys * num_levels) {
+    return absl::InvalidArgumentError(
+        "`betas` must have `parameters_.size()` elements per element of "
+        "`alphas`");
+  }
+  for (int64_t j = 0; j < num_keys; ++j) {
+    for (int i = 0; i < num_levels; ++i) {
+      absl::Status status =
+          proto_validator_->ValidateValue(betas[j * num_levels + i], i);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  // Check validity of alphas.
+  int last_level_log_domain_size = parameters_.back().log_domain_size();
+  for (int64_t j = 0; j < num_keys; ++j) {
+    if (last_level_log_domain_size < 128 &&
+        alphas[j] >= (absl::uint128{1} << last_level_log_domain_size)) {
+      return absl::InvalidArgumentError(
+          "each element of `alphas` must be smaller than the output domain "
+          "size");
+    }
+  }
+
+  std::vector<std::pair<DpfKey, DpfKey>> keys(num_keys);
+  if (num_keys == 0) {
+    return keys;
+  }
+
+  // Sample all random seeds with a single call, and initialize the per-key
+  // state as in `GenerateKeysIncremental`. `seeds` and `control_bits` hold
+  // two elements per key, one per party.
+  std::vector<absl::uint128> seeds(2 * num_keys);
+  RAND_bytes(reinterpret_cast<uint8_t*>(seeds.data()),
+             seeds.size() * sizeof(absl::uint128));
+  auto control_bits = std::make_unique<bool[]>(2 * num_keys);
+  for (int64_t j = 0; j < num_keys; ++j) {
+    keys[j].first.set_party(0);
+    keys[j].second.set_party(1);
+    keys[j].first.mutable_seed()->set_high(absl::Uint128High64(seeds[2 * j]));
+    keys[j].first.mutable_seed()->set_low(absl::Uint128Low64(seeds[2 * j]));
+    keys[j].second.mutable_seed()->set_high(
+        absl::Uint128High64(seeds[2 * j + 1]));
+    keys[j].second.mutable_seed()->set_low(
+        absl::Uint128Low64(seeds[2 * j + 1]));
+    control_bits[2 * j] = 0;
+    control_bits[2 * j + 1] = 1;
+    keys[j].first.mutable_correction_words()->Reserve(tree_levels_needed_ - 1);
+    keys[j].second.mutable_correction_words()->Reserve(tree_levels_needed_ - 1);
+  }
+
+  // Advance all keys in lockstep, one tree level at a time.
+  for (int i = 1; i < tree_levels_needed_; i++) {
+    DPF_RETURN_IF_ERROR(GenerateNextBatch(
+        i, alphas, betas, absl::MakeSpan(seeds),
+        absl::MakeSpan(control_bits.get(), 2 * num_keys), absl::MakeSpan(keys)));
+  }
+
+  // Compute output correction words for the last layer.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::vector<Value>> last_level_value_corrections,
+      ComputeValueCorrectionBatch(
+          num_levels - 1, seeds, alphas, betas,
+          absl::MakeConstSpan(control_bits.get(), 2 * num_keys)));
+  for (int64_t j = 0; j < num_keys; ++j) {
+    for (const Value& value : last_level_value_corrections[j]) {
+      *(keys[j].first.add_last_level_value_correction()) = value;
+      *(keys[j].second.add_last_level_value_correction()) = value;
+    }
+  }
+
+  return keys;
+}
+
+absl::StatusOr<int64_t> DistributedPointFunction::GetOutputSize(
+    int hierarchy_level, int64_t num_prefixes,
+    const EvaluationContext& ctx) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  int previous_log_domain_size = 0;
+  if (num_prefixes > 0 && ctx.previous_hierarchy_level() >= 0) {
+    previous_log_domain_size =
+        parameters_[ctx.previous_hierarchy_level()].log_domain_size();
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  if (log_domain_size - previous_log_domain_size > 62) {
+    return absl::InvalidArgumentError(
+        "Output size would be larger than 2**62. Please evaluate fewer "
+        "hierarchy levels at once.");
+  }
+  const int64_t outputs_per_prefix =
+      int64_t{1} << (log_domain_size - previous_log_domain_size);
+  return std::max<int64_t>(num_prefixes, 1) * outputs_per_prefix;
+}
+
 absl::StatusOr<EvaluationContext>
 DistributedPointFunction::CreateEvaluationContext(DpfKey key) const {
   // Check that `key` is valid.
@@ -703,4 +2219,132 @@ DistributedPointFunction::CreateEvaluationContext(DpfKey key) const {
   return result;
 }
 
+absl::StatusOr<EvaluationContext>
+DistributedPointFunction::CreateEvaluationContext(ValidatedDpfKey key) const {
+  // `key` was already validated by `ValidateKey`, so only the context needs
+  // to be assembled here.
+  EvaluationContext result;
+  for (int i = 0; i < static_cast<int>(parameters_.size()); ++i) {
+    *(result.add_parameters()) = parameters_[i];
+  }
+  *(result.mutable_key()) = std::move(key.key_);
+  // previous_hierarchy_level = -1 means that this context has not been
+  // evaluated at all.
+  result.set_previous_hierarchy_level(-1);
+  return result;
+}
+
+absl::StatusOr<ValidatedDpfKey> DistributedPointFunction::ValidateKey(
+    DpfKey key) const {
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  return ValidatedDpfKey(std::move(key));
+}
+
+absl::StatusOr<EvaluationState> DistributedPointFunction::CreateEvaluationState(
+    DpfKey key) const {
+  // Check that `key` is valid. `EvaluateUntil` relies on this and doesn't
+  // re-validate on every call.
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  EvaluationState state;
+  state.key_ = std::move(key);
+  return state;
+}
+
+absl::StatusOr<EvaluationState> DistributedPointFunction::CreateEvaluationState(
+    const EvaluationContext& ctx) const {
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateEvaluationContext(ctx));
+  EvaluationState state;
+  state.key_ = ctx.key();
+  state.previous_hierarchy_level_ = ctx.previous_hierarchy_level();
+  state.partial_evaluations_level_ = ctx.partial_evaluations_level();
+  const int64_t num_partial_evaluations = ctx.partial_evaluations_size();
+  if (num_partial_evaluations > 0) {
+    // Sort the partial evaluations by prefix, deduplicating as in the
+    // proto-backed `ComputePartialEvaluations`.
+    std::vector<std::pair<absl::uint128, std::pair<absl::uint128, bool>>>
+        elements;
+    elements.reserve(num_partial_evaluations);
+    for (const PartialEvaluation& element : ctx.partial_evaluations()) {
+      elements.push_back(std::make_pair(
+          absl::MakeUint128(element.prefix().high(), element.prefix().low()),
+          std::make_pair(
+              absl::MakeUint128(element.seed().high(), element.seed().low()),
+              element.control_bit())));
+    }
+    std::sort(elements.begin(), elements.end());
+    state.partial_seeds_ =
+        hwy::AllocateAligned<absl::uint128>(num_partial_evaluations);
+    if (state.partial_seeds_ == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    state.partial_prefixes_.reserve(num_partial_evaluations);
+    state.partial_control_bits_.Reserve(num_partial_evaluations);
+    for (int64_t i = 0; i < num_partial_evaluations; ++i) {
+      if (i > 0 && elements[i].first == elements[i - 1].first) {
+        if (elements[i].second != elements[i - 1].second) {
+          return absl::InvalidArgumentError(
+              "Duplicate prefix in `ctx.partial_evaluations()` with "
+              "mismatching seed or control bit");
+        }
+        continue;
+      }
+      state.partial_seeds_[state.partial_prefixes_.size()] =
+          elements[i].second.first;
+      state.partial_prefixes_.push_back(elements[i].first);
+      state.partial_control_bits_.PushBack(elements[i].second.second);
+    }
+  }
+  return state;
+}
+
+absl::StatusOr<EvaluationContext>
+DistributedPointFunction::SerializeEvaluationState(
+    const EvaluationState& state) const {
+  DPF_ASSIGN_OR_RETURN(EvaluationContext ctx,
+                       CreateEvaluationContext(state.key_));
+  ctx.set_previous_hierarchy_level(state.previous_hierarchy_level_);
+  ctx.set_partial_evaluations_level(state.partial_evaluations_level_);
+  const auto num_partial_evaluations =
+      static_cast<int64_t>(state.partial_prefixes_.size());
+  ctx.mutable_partial_evaluations()->Reserve(num_partial_evaluations);
+  for (int64_t i = 0; i < num_partial_evaluations; ++i) {
+    PartialEvaluation* element = ctx.add_partial_evaluations();
+    element->mutable_prefix()->set_high(
+        absl::Uint128High64(state.partial_prefixes_[i]));
+    element->mutable_prefix()->set_low(
+        absl::Uint128Low64(state.partial_prefixes_[i]));
+    element->mutable_seed()->set_high(
+        absl::Uint128High64(state.partial_seeds_[i]));
+    element->mutable_seed()->set_low(
+        absl::Uint128Low64(state.partial_seeds_[i]));
+    element->set_control_bit(state.partial_control_bits_[i]);
+  }
+  return ctx;
+}
+
+absl::StatusOr<int64_t> DistributedPointFunction::GetOutputSize(
+    int hierarchy_level, int64_t num_prefixes,
+    const EvaluationState& state) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  int previous_log_domain_size = 0;
+  if (num_prefixes > 0 && state.previous_hierarchy_level() >= 0) {
+    previous_log_domain_size =
+        parameters_[state.previous_hierarchy_level()].log_domain_size();
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  if (log_domain_size - previous_log_domain_size > 62) {
+    return absl::InvalidArgumentError(
+        "Output size would be larger than 2**62. Please evaluate fewer "
+        "hierarchy levels at once.");
+  }
+  const int64_t outputs_per_prefix =
+      int64_t{1} << (log_domain_size - previous_log_domain_size);
+  return std::max<int64_t>(num_prefixes, 1) * outputs_per_prefix;
+}
+
 }  // namespace distributed_point_functions
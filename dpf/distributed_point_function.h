@@ -20,25 +20,46 @@
 #include <glog/logging.h>
 #include <openssl/cipher.h>
 
+#ifdef DPF_ENABLE_EVALUATION_STATS
+#include <chrono>  // NOLINT(build/c++11)
+#endif
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/functional/function_ref.h"
 #include "absl/meta/type_traits.h"
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "dpf/aes_128_fixed_key_hash.h"
 #include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/domain_index_hwy.h"
+#include "dpf/internal/packed_control_bits.h"
 #include "dpf/internal/proto_validator.h"
+#include "dpf/internal/value_correction_hwy.h"
 #include "dpf/internal/value_type_helpers.h"
 #include "hwy/aligned_allocator.h"
+#include "hwy/base.h"
 
 namespace distributed_point_functions {
 
+namespace dpf_internal {
+// Implements the checkpoint format in dpf/evaluation_state_io.h; declared
+// here so `EvaluationState` can befriend it without pulling the riegeli
+// dependency into this header.
+class EvaluationStateIoAccess;
+}  // namespace dpf_internal
+
 // Type trait for all supported types. Used to provide meaningful error messages
 // in std::enable_if template guards.
 template <typename T>
@@ -66,6 +87,307 @@ ValueType ToValueType() {
   return dpf_internal::ValueTypeHelper<T>::ToValueType();
 }
 
+// A `DpfKey` that has been validated once against the parameters of a
+// `DistributedPointFunction` instance. The `EvaluateAt` and
+// `CreateEvaluationContext` overloads accepting a `ValidatedDpfKey` skip the
+// per-call validation walk over all correction words, which adds up when the
+// same key is evaluated at many point batches. The wrapper is move-only so
+// the contained key cannot change after validation. Unlike `CompiledDpfKey`
+// below, the key stays in its proto form, so validation is cheap and the key
+// can still be inspected or serialized. Create instances with
+// `DistributedPointFunction::ValidateKey`.
+class ValidatedDpfKey {
+ public:
+  // ValidatedDpfKey is movable but not copyable.
+  ValidatedDpfKey(ValidatedDpfKey&&) = default;
+  ValidatedDpfKey& operator=(ValidatedDpfKey&&) = default;
+  ValidatedDpfKey(const ValidatedDpfKey&) = delete;
+  ValidatedDpfKey& operator=(const ValidatedDpfKey&) = delete;
+
+  // Returns the validated `DpfKey`.
+  const DpfKey& key() const { return key_; }
+
+ private:
+  friend class DistributedPointFunction;
+
+  explicit ValidatedDpfKey(DpfKey key) : key_(std::move(key)) {}
+
+  DpfKey key_;
+};
+
+// A `DpfKey` parsed once into a flat, aligned in-memory layout for the
+// evaluation hot path: correction seeds are stored contiguously in an aligned
+// array and control-bit corrections in flat bool arrays, so repeated
+// evaluations don't re-walk the proto accessors or re-copy correction words.
+// Create instances with `DistributedPointFunction::CompileDpfKey`, and
+// evaluate them with the `EvaluateAt` overload accepting a `CompiledDpfKey`.
+class CompiledDpfKey {
+ public:
+  // CompiledDpfKey is movable but not copyable.
+  CompiledDpfKey(CompiledDpfKey&&) = default;
+  CompiledDpfKey& operator=(CompiledDpfKey&&) = default;
+  CompiledDpfKey(const CompiledDpfKey&) = delete;
+  CompiledDpfKey& operator=(const CompiledDpfKey&) = delete;
+
+  // Returns the `DpfKey` this key was compiled from.
+  const DpfKey& key() const { return key_; }
+
+ private:
+  friend class DistributedPointFunction;
+
+  CompiledDpfKey() = default;
+
+  // Copy of the original key. Used for the cold parts of evaluation (value
+  // corrections), which read proto fields at most once per call.
+  DpfKey key_;
+
+  // The key's seed and party, parsed from `key_`.
+  absl::uint128 seed_;
+  bool party_;
+
+  // Correction seeds for all tree levels, contiguous and aligned for SIMD
+  // loads.
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> correction_seeds_;
+
+  // Left and right control-bit corrections for all tree levels.
+  absl::InlinedVector<bool, sizeof(bool*)> correction_controls_left_;
+  absl::InlinedVector<bool, sizeof(bool*)> correction_controls_right_;
+};
+
+// Native in-memory state for incremental DPF evaluation. Serves the same
+// purpose as the `EvaluationContext` proto, but holds partial evaluations as
+// aligned seed arrays and packed control bits with a sorted prefix index
+// instead of repeated `PartialEvaluation` messages, so successive
+// `EvaluateUntil` calls don't rebuild a map from proto submessages and don't
+// write per-prefix protos back. Create instances with
+// `DistributedPointFunction::CreateEvaluationState`, and convert to/from the
+// proto form at checkpoint boundaries with `SerializeEvaluationState` and the
+// `EvaluationContext` overload of `CreateEvaluationState`. When spilling many
+// states to disk between levels, prefer the compact streamed checkpoint
+// format in dpf/evaluation_state_io.h over the proto round-trip.
+class EvaluationState {
+ public:
+  // EvaluationState is movable but not copyable.
+  EvaluationState(EvaluationState&&) = default;
+  EvaluationState& operator=(EvaluationState&&) = default;
+  EvaluationState(const EvaluationState&) = delete;
+  EvaluationState& operator=(const EvaluationState&) = delete;
+
+  // Returns the key this state was created from.
+  const DpfKey& key() const { return key_; }
+
+  // Returns the hierarchy level this state was last evaluated at, or -1 if it
+  // hasn't been evaluated at all.
+  int previous_hierarchy_level() const { return previous_hierarchy_level_; }
+
+  // Enables retaining the full seed expansion of each `EvaluateUntil` call in
+  // this state. With retention on, the next call selects the seeds of the
+  // surviving prefixes directly from the retained expansion instead of
+  // re-descending from the last saved frontier with PRG evaluations, so the
+  // per-call maintenance work is proportional to the surviving prefix set.
+  // This is the natural mode for heavy-hitters style protocols that advance
+  // one hierarchy level at a time, pruning prefixes between levels; pruned
+  // subtrees are simply never read again and are dropped wholesale when the
+  // next expansion replaces the retained one.
+  //
+  // Costs memory for one full expansion (16 bytes per output block) between
+  // calls. The retained expansion is a cache: it is not serialized by
+  // `SerializeEvaluationState`, and a state restored from a checkpoint falls
+  // back to the regular partial-evaluations path for its first call.
+  void set_retain_expansion(bool retain_expansion) {
+    retain_expansion_ = retain_expansion;
+  }
+  bool retain_expansion() const { return retain_expansion_; }
+
+ private:
+  friend class DistributedPointFunction;
+  // Reads and writes the private fields for the compact checkpoint format;
+  // see dpf/evaluation_state_io.h.
+  friend class dpf_internal::EvaluationStateIoAccess;
+
+  EvaluationState() = default;
+
+  // The key being evaluated. Validated once at construction.
+  DpfKey key_;
+
+  // The last hierarchy level `EvaluateUntil` was called with, or -1 before the
+  // first call.
+  int previous_hierarchy_level_ = -1;
+
+  // The hierarchy level the partial evaluations below correspond to.
+  int partial_evaluations_level_ = 0;
+
+  // Partial evaluations saved from the last `EvaluateUntil` call, sorted by
+  // prefix for binary search. `partial_seeds_[i]` and
+  // `partial_control_bits_[i]` hold the evaluation of `key_` at
+  // `partial_prefixes_[i]`.
+  std::vector<absl::uint128> partial_prefixes_;
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> partial_seeds_;
+  dpf_internal::PackedControlBits partial_control_bits_;
+
+  // Whether to keep the seed expansion of each `EvaluateUntil` call; see
+  // `set_retain_expansion`.
+  bool retain_expansion_ = false;
+
+  // The retained expansion, valid if `expansion_hierarchy_level_ >= 0`. It
+  // holds the seeds and control bits at the tree level of
+  // `expansion_hierarchy_level_`, where the block of
+  // 2^`expansion_log_stride_` consecutive entries starting at index
+  // i << `expansion_log_stride_` covers the subtree below
+  // `expansion_prefixes_[i]`. An empty `expansion_prefixes_` denotes an
+  // expansion below the root. Only expansions of sorted prefixes are
+  // retained, so lookups can use `FindSortedPrefix`.
+  int expansion_hierarchy_level_ = -1;
+  int expansion_log_stride_ = 0;
+  std::vector<absl::uint128> expansion_prefixes_;
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> expansion_seeds_;
+  dpf_internal::PackedControlBits expansion_control_bits_;
+};
+
+// An opt-in arena for the intermediate seed and hash buffers allocated during
+// DPF evaluation. Without it, every evaluation call performs fresh aligned
+// allocations of up to several output-sized buffers, which at large domain
+// sizes means repeated multi-GB allocator traffic. Callers that repeatedly
+// evaluate the same shapes can construct an `EvaluationScratch` once and pass
+// it to the `EvaluateUntil`/`EvaluateAt` overloads accepting one; buffers are
+// then recycled across calls, with capacities growing geometrically and
+// retained at their high-water mark.
+//
+// Not thread-safe: a scratch object must not be used by concurrent evaluation
+// calls. Internal expansion threads do not touch the scratch.
+class EvaluationScratch {
+ public:
+  EvaluationScratch() = default;
+
+  // EvaluationScratch is movable but not copyable.
+  EvaluationScratch(EvaluationScratch&&) = default;
+  EvaluationScratch& operator=(EvaluationScratch&&) = default;
+  EvaluationScratch(const EvaluationScratch&) = delete;
+  EvaluationScratch& operator=(const EvaluationScratch&) = delete;
+
+  // Releases all retained buffers.
+  void Clear() { buffers_.clear(); }
+
+ private:
+  friend class DistributedPointFunction;
+
+  // An aligned buffer together with its capacity, which may be larger than
+  // the size it was acquired with.
+  struct Buffer {
+    hwy::AlignedFreeUniquePtr<absl::uint128[]> data;
+    int64_t capacity = 0;
+  };
+
+  // Returns a buffer with capacity at least `size`, reusing the smallest
+  // retained buffer that fits. If none fits, allocates a fresh buffer with
+  // capacity rounded up to the next power of two, so repeated calls with
+  // slowly growing sizes don't allocate every time.
+  //
+  // Returns RESOURCE_EXHAUSTED if allocation fails.
+  absl::StatusOr<Buffer> Acquire(int64_t size);
+
+  // Returns `buffer` to the arena for reuse by subsequent `Acquire` calls.
+  void Release(Buffer buffer);
+
+  // Retained buffers, sorted by capacity.
+  std::vector<Buffer> buffers_;
+};
+
+// Evaluation points translated once into the tree and block indices consumed
+// by `EvaluateAt`. Evaluating the same points under many keys (e.g., one key
+// per client) otherwise re-validates the points and re-derives the indices on
+// every call, including an aligned allocation for the tree indices. Build an
+// instance with `DistributedPointFunction::PrecomputeEvaluationPoints` and
+// pass it to the `EvaluateAt`/`EvaluateAtBatch` overloads accepting one;
+// per-key work then shrinks to seed evaluation, hashing, and value
+// correction. The `DistributedPointFunction` that created the instance must
+// outlive it.
+class PrecomputedEvaluationPoints {
+ public:
+  // PrecomputedEvaluationPoints is movable but not copyable.
+  PrecomputedEvaluationPoints(PrecomputedEvaluationPoints&&) = default;
+  PrecomputedEvaluationPoints& operator=(PrecomputedEvaluationPoints&&) =
+      default;
+  PrecomputedEvaluationPoints(const PrecomputedEvaluationPoints&) = delete;
+  PrecomputedEvaluationPoints& operator=(const PrecomputedEvaluationPoints&) =
+      delete;
+
+  // Returns the hierarchy level the points were precomputed for.
+  int hierarchy_level() const { return hierarchy_level_; }
+
+  // Returns the number of evaluation points.
+  int64_t size() const {
+    return static_cast<int64_t>(evaluation_points_.size());
+  }
+
+ private:
+  friend class DistributedPointFunction;
+
+  PrecomputedEvaluationPoints() = default;
+
+  int hierarchy_level_ = 0;
+
+  // Copy of the points passed to `PrecomputeEvaluationPoints`.
+  std::vector<absl::uint128> evaluation_points_;
+
+  // Tree index of each point, in an aligned buffer as required by the seed
+  // evaluation kernels.
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> tree_indices_;
+
+  // Block index of each point within its hashed 128-bit block. All zeros when
+  // each block holds a single element.
+  std::vector<int> block_indices_;
+};
+
+// Counters collected during DPF evaluation, for diagnosing whether time is
+// spent in PRG expansion, value hashing, or correction. Collection is
+// compiled in only when the library is built with
+// `DPF_ENABLE_EVALUATION_STATS` (with Bazel: `--define
+// dpf_enable_evaluation_stats=true`); otherwise all instrumentation is
+// compiled out and evaluation is unaffected. To collect, register a sink for
+// the calling thread with `DistributedPointFunction::SetEvaluationStatsSink`.
+//
+// Only work performed on the registering thread is counted; helper threads
+// spawned by parallel or pipelined evaluation are not instrumented. In the
+// pipelined hash-and-correct path, `correct_nanos` covers the fused stage, so
+// stage timings can overlap there.
+struct EvaluationStats {
+  // Number of 128-bit AES blocks processed by the left and right seed
+  // expansion PRGs.
+  int64_t prg_left_blocks = 0;
+  int64_t prg_right_blocks = 0;
+  // Number of 128-bit AES blocks processed by the value-hashing PRG.
+  int64_t prg_value_blocks = 0;
+  // Bytes of freshly allocated seed and hash buffers. Buffers recycled from
+  // an `EvaluationScratch` are not counted.
+  int64_t allocated_bytes = 0;
+  // Number of seeds produced at each expanded tree level, in expansion order,
+  // across all expansions since the sink was registered.
+  std::vector<int64_t> seeds_expanded_per_level;
+  // Wall-clock nanoseconds spent expanding seeds, hashing expanded seeds, and
+  // applying the value correction, respectively.
+  int64_t expand_nanos = 0;
+  int64_t hash_nanos = 0;
+  int64_t correct_nanos = 0;
+};
+
+#ifdef DPF_ENABLE_EVALUATION_STATS
+namespace dpf_internal {
+
+// Monotonic timestamp used for the `*_nanos` fields of `EvaluationStats`.
+inline int64_t EvaluationStatsNowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace dpf_internal
+#endif  // DPF_ENABLE_EVALUATION_STATS
+
+// Forward declaration, defined after `DistributedPointFunction`.
+template <typename T>
+class LazyEvaluation;
+
 // Implements key generation and evaluation of distributed point functions.
 // A distributed point function (DPF) is parameterized by an index `alpha` and a
 // value `beta`. The key generation procedure produces two keys `k_a`, `k_b`.
@@ -127,8 +449,8 @@ class DistributedPointFunction {
   // This function provides three overloads: One with `absl::uint128` for
   // `beta`, which implies the output type is a simple integer; One with a
   // `Value` proto for `beta`, which can be used for all supported value types;
-  // And a templated version that computes the Value by calling ToValue<T> on
-  // the argument.
+  // And a templated version that computes the value correction directly from
+  // the native argument, without converting it to a `Value` proto.
   //
   // Example Usages (assuming a std::unique_ptr<DistributedPointFunction> dpf):
   //
@@ -169,20 +491,58 @@ class DistributedPointFunction {
     return GenerateKeysIncremental(alpha, absl::MakeConstSpan(&beta, 1));
   }
 
-  // Template for automatic conversion to Value proto. Disabled if the argument
-  // is convertible to `absl::uint128` or `Value` to make overloading
-  // unambiguous.
+  // Template for native beta types. Disabled if the argument is convertible
+  // to `absl::uint128` or `Value` to make overloading unambiguous. Dispatches
+  // the value correction computation at compile time via
+  // `dpf_internal::ValueTypeHelper<T>`, and thus never materializes `Value`
+  // protos for `beta` or serialized `ValueType` lookup keys. No call to
+  // `RegisterValueType<T>` is needed for this overload.
   template <typename T, typename = absl::enable_if_t<
                             !std::is_convertible<T, absl::uint128>::value &&
                             !std::is_convertible<T, Value>::value &&
                             is_supported_type_v<T>>>
   absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeys(absl::uint128 alpha,
                                                          const T& beta) {
-    absl::StatusOr<Value> value = ToValue<T>(beta);
-    if (!value.ok()) {
-      return value.status();
+    return GenerateKeysTyped<T>(alpha, beta);
+  }
+
+  // As the templated `GenerateKeys` overload, but available for all supported
+  // types, including plain integers. Useful in generic code where `T` may be
+  // an integer type, which the `GenerateKeys` overload set resolves to the
+  // `absl::uint128` overload.
+  template <typename T, typename = absl::enable_if_t<is_supported_type_v<T>>>
+  absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeysTyped(
+      absl::uint128 alpha, const T& beta) {
+    if (parameters_.size() != 1) {
+      return absl::InvalidArgumentError(
+          "`beta` has to have the same size as `parameters` passed at "
+          "construction");
     }
-    return GenerateKeysIncremental(alpha, absl::MakeConstSpan(&(*value), 1));
+    absl::StatusOr<bool> types_equal = dpf_internal::ValueTypesAreEqual(
+        ToValueType<T>(), parameters_[0].value_type());
+    if (!types_equal.ok()) {
+      return types_equal.status();
+    }
+    if (!*types_equal) {
+      return absl::InvalidArgumentError(
+          "`beta` does not match the value type passed at construction");
+    }
+    // Check validity of alpha.
+    int log_domain_size = parameters_[0].log_domain_size();
+    if (log_domain_size < 128 &&
+        alpha >= (absl::uint128{1} << log_domain_size)) {
+      return absl::InvalidArgumentError(
+          "`alpha` must be smaller than the output domain size");
+    }
+    return GenerateKeysImpl(
+        alpha,
+        [this, &beta](int hierarchy_level,
+                      absl::Span<const absl::uint128> seeds,
+                      absl::uint128 alpha_prefix,
+                      bool invert) -> absl::StatusOr<std::vector<Value>> {
+          return ComputeValueCorrectionTyped<T>(hierarchy_level, seeds,
+                                                alpha_prefix, beta, invert);
+        });
   }
 
   // Generates a pair of keys for an incremental DPF. For each parameter i
@@ -252,6 +612,70 @@ class DistributedPointFunction {
   absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeysIncremental(
       absl::uint128 alpha, T0&& beta_0, Tn&&... beta_n);
 
+  // As the `GenerateKeysIncremental` overloads above, but with one native
+  // `beta` element per hierarchy level. Dispatches all value corrections at
+  // compile time via `dpf_internal::ValueTypeHelper<T>`, so no `Value` protos
+  // are materialized and no serialized `ValueType` map lookups happen at any
+  // level. All hierarchy levels must have the value type corresponding to
+  // `T`. No call to `RegisterValueType<T>` is needed for this overload.
+  template <typename T, typename = absl::enable_if_t<is_supported_type_v<T>>>
+  absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeysIncrementalTyped(
+      absl::uint128 alpha, absl::Span<const T> beta) {
+    if (beta.size() != parameters_.size()) {
+      return absl::InvalidArgumentError(
+          "`beta` has to have the same size as `parameters` passed at "
+          "construction");
+    }
+    const ValueType value_type = ToValueType<T>();
+    for (int i = 0; i < static_cast<int>(parameters_.size()); ++i) {
+      absl::StatusOr<bool> types_equal = dpf_internal::ValueTypesAreEqual(
+          value_type, parameters_[i].value_type());
+      if (!types_equal.ok()) {
+        return types_equal.status();
+      }
+      if (!*types_equal) {
+        return absl::InvalidArgumentError(
+            "`beta` does not match the value type passed at construction");
+      }
+    }
+    // Check validity of alpha.
+    int last_level_log_domain_size = parameters_.back().log_domain_size();
+    if (last_level_log_domain_size < 128 &&
+        alpha >= (absl::uint128{1} << last_level_log_domain_size)) {
+      return absl::InvalidArgumentError(
+          "`alpha` must be smaller than the output domain size");
+    }
+    return GenerateKeysImpl(
+        alpha,
+        [this, beta](int hierarchy_level,
+                     absl::Span<const absl::uint128> seeds,
+                     absl::uint128 alpha_prefix,
+                     bool invert) -> absl::StatusOr<std::vector<Value>> {
+          return ComputeValueCorrectionTyped<T>(hierarchy_level, seeds,
+                                                alpha_prefix,
+                                                beta[hierarchy_level], invert);
+        });
+  }
+
+  // Generates key pairs for many DPFs at once. Equivalent to calling
+  // `GenerateKeysIncremental(alphas[j], ...)` for each j, but all keys are
+  // generated in lockstep, one tree level at a time: the left, right, and
+  // value PRG evaluations of the whole batch are issued as single
+  // `Aes128FixedKeyHash` calls, keeping the AES pipelines full instead of
+  // hashing two seeds at a time.
+  //
+  // `betas` must contain `parameters_.size()` values per element of `alphas`,
+  // laid out key-major: the betas for `alphas[j]` are
+  // `betas[j * parameters_.size()]` to `betas[(j + 1) * parameters_.size() -
+  // 1]`. For non-incremental DPFs this is simply one beta per alpha.
+  //
+  // Returns INVALID_ARGUMENT if the sizes of `alphas` and `betas` don't
+  // match, if any element of `alphas` is outside of the domain specified at
+  // construction, or if any element of `betas` does not match the element
+  // type passed at construction.
+  absl::StatusOr<std::vector<std::pair<DpfKey, DpfKey>>> GenerateKeysBatch(
+      absl::Span<const absl::uint128> alphas, absl::Span<const Value> betas);
+
   // Returns an `EvaluationContext` for incrementally evaluating the given
   // DpfKey.
   //
@@ -259,6 +683,11 @@ class DistributedPointFunction {
   // construction.
   absl::StatusOr<EvaluationContext> CreateEvaluationContext(DpfKey key) const;
 
+  // As above, but takes a key validated with `ValidateKey`, skipping the
+  // validation walk over the key's correction words.
+  absl::StatusOr<EvaluationContext> CreateEvaluationContext(
+      ValidatedDpfKey key) const;
+
   // Evaluates the given `hierarchy_level` of the DPF under all `prefixes`
   // passed to this function. If `prefixes` is empty, evaluation starts from the
   // seed of `ctx.key`. Otherwise, each element of `prefixes` must fit in the
@@ -303,6 +732,32 @@ class DistributedPointFunction {
       int hierarchy_level, absl::Span<const absl::uint128> prefixes,
       EvaluationContext& ctx) const;
 
+  // As the vector-returning `EvaluateUntil` above, but writes the corrected
+  // values directly into the caller-provided `output`, which must have exactly
+  // `GetOutputSize(hierarchy_level, prefixes.size(), ctx)` elements. When
+  // `prefixes` is empty, `output` also serves as the correction scratch
+  // buffer, so no intermediate output allocation is performed at all. Callers
+  // evaluating many contexts of the same shape can thus reuse a single
+  // (ideally aligned) buffer across calls.
+  //
+  // Returns INVALID_ARGUMENT if `output.size()` doesn't match the expected
+  // number of outputs, in addition to the errors documented above.
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             absl::Span<const absl::uint128> prefixes,
+                             EvaluationContext& ctx, absl::Span<T> output) const;
+
+  // Returns the number of values that an `EvaluateUntil` call for
+  // `hierarchy_level` with `num_prefixes` prefixes on `ctx` will produce.
+  // Useful for sizing the `output` buffer of the span-based `EvaluateUntil`
+  // overload.
+  //
+  // Returns INVALID_ARGUMENT if `hierarchy_level` is out of range for `ctx`,
+  // or if the output size would exceed 2**62.
+  absl::StatusOr<int64_t> GetOutputSize(int hierarchy_level,
+                                        int64_t num_prefixes,
+                                        const EvaluationContext& ctx) const;
+
   template <typename T>
   absl::StatusOr<std::vector<T>> EvaluateNext(
       absl::Span<const absl::uint128> prefixes, EvaluationContext& ctx) const {
@@ -314,6 +769,116 @@ class DistributedPointFunction {
     }
   }
 
+  // Returns an `EvaluationState` for incrementally evaluating the given
+  // DpfKey. Behaves like `CreateEvaluationContext`, but keeps partial
+  // evaluations in native arrays instead of proto messages, which avoids the
+  // proto round-trip between hierarchy levels. Use `SerializeEvaluationState`
+  // to checkpoint the state as an `EvaluationContext`.
+  //
+  // Returns INVALID_ARGUMENT if `key` doesn't match the parameters given at
+  // construction.
+  absl::StatusOr<EvaluationState> CreateEvaluationState(DpfKey key) const;
+
+  // Restores an `EvaluationState` from a (possibly partially evaluated)
+  // `EvaluationContext`, e.g. one produced by `SerializeEvaluationState`.
+  //
+  // Returns INVALID_ARGUMENT if `ctx` is invalid for this DPF.
+  absl::StatusOr<EvaluationState> CreateEvaluationState(
+      const EvaluationContext& ctx) const;
+
+  // Converts `state` to an `EvaluationContext` proto for checkpointing.
+  // Passing the result to `CreateEvaluationState` restores an equivalent
+  // state.
+  absl::StatusOr<EvaluationContext> SerializeEvaluationState(
+      const EvaluationState& state) const;
+
+  // As `EvaluateUntil` on an `EvaluationContext`, but operates on a native
+  // `EvaluationState`. Partial evaluations are kept as aligned seed arrays
+  // with a sorted prefix index between calls, so no proto messages are built
+  // or parsed on the hot path.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateUntil(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      EvaluationState& state) const;
+
+  // As above, but writes the corrected values into the caller-provided
+  // `output`, which must have exactly `GetOutputSize(hierarchy_level,
+  // prefixes.size(), state)` elements.
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             absl::Span<const absl::uint128> prefixes,
+                             EvaluationState& state,
+                             absl::Span<T> output) const;
+
+  // As `GetOutputSize` for an `EvaluationContext`, but for an
+  // `EvaluationState`.
+  absl::StatusOr<int64_t> GetOutputSize(int hierarchy_level,
+                                        int64_t num_prefixes,
+                                        const EvaluationState& state) const;
+
+  // As the span-based `EvaluateUntil` overloads above, but carves all
+  // intermediate seed and hash buffers from `scratch` and recycles them there
+  // afterwards. Together with a reused `output` buffer, this removes all
+  // hot-path allocations when evaluating the same shapes repeatedly.
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             absl::Span<const absl::uint128> prefixes,
+                             EvaluationContext& ctx, absl::Span<T> output,
+                             EvaluationScratch& scratch) const;
+
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             absl::Span<const absl::uint128> prefixes,
+                             EvaluationState& state, absl::Span<T> output,
+                             EvaluationScratch& scratch) const;
+
+  // As `EvaluateUntil` on an `EvaluationContext`, but expands the seeds on
+  // `num_threads` threads for this call, independently of
+  // `SetNumEvaluationThreads`. Threads claim contiguous chunks of the
+  // expansion frontier dynamically, so they stay busy even if some finish
+  // their chunks earlier than others. Since this doesn't mutate the
+  // `DistributedPointFunction`, it allows concurrent callers sharing a single
+  // const instance (e.g. one per heavy-hitters query) to pick their own
+  // degree of parallelism.
+  //
+  // Returns INVALID_ARGUMENT if `num_threads < 1`, in addition to the errors
+  // documented at `EvaluateUntil`.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateUntilParallel(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      EvaluationContext& ctx, int num_threads) const;
+
+  // As the span-based `EvaluateUntil` above, but *adds* the corrected values
+  // into `accumulator` instead of overwriting it, fusing the value correction
+  // with the aggregation. Aggregators that only ever sum DPF outputs into a
+  // running total (e.g. over many client keys) thus touch each output element
+  // once, instead of materializing a result vector and adding it in a second
+  // pass. `accumulator` must have exactly `GetOutputSize(hierarchy_level,
+  // prefixes.size(), ctx)` elements.
+  //
+  // Returns INVALID_ARGUMENT if `accumulator.size()` doesn't match the
+  // expected number of outputs, in addition to the errors documented at
+  // `EvaluateUntil`.
+  template <typename T>
+  absl::Status EvaluateUntilAccumulate(int hierarchy_level,
+                                       absl::Span<const absl::uint128> prefixes,
+                                       EvaluationContext& ctx,
+                                       absl::Span<T> accumulator) const;
+
+  // As `EvaluateUntil` on an `EvaluationContext`, but defers the value
+  // hashing and correction: the seeds are expanded now, and a handle is
+  // returned from which outputs are materialized on demand for selected
+  // indices. Callers that immediately discard most outputs (e.g.
+  // heavy-hitters protocols that prune most prefixes by a threshold) thus
+  // only pay the value-hashing AES calls for the blocks they actually read.
+  // `ctx` is advanced to `hierarchy_level` as with `EvaluateUntil`. The
+  // returned handle refers to this `DistributedPointFunction`, which must
+  // outlive it.
+  template <typename T>
+  absl::StatusOr<LazyEvaluation<T>> EvaluateUntilLazy(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      EvaluationContext& ctx) const;
+
   // Evaluates a single key at one or multiple points, up to the given
   // `hierarchy_level`. Each element of `evaluation_points` must be within the
   // domain of this DPF at `hierarchy_level`.
@@ -335,6 +900,165 @@ class DistributedPointFunction {
     return EvaluateAtImpl<T>(key, hierarchy_level, evaluation_points, nullptr);
   }
 
+  // Validates `key` against the parameters of this DPF once and wraps it in a
+  // move-only `ValidatedDpfKey`, so that subsequent `EvaluateAt` and
+  // `CreateEvaluationContext` calls don't re-walk all correction words.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed.
+  absl::StatusOr<ValidatedDpfKey> ValidateKey(DpfKey key) const;
+
+  // As `EvaluateAt` above, but takes a key validated with `ValidateKey`,
+  // skipping the per-call key validation.
+  //
+  // Returns INVALID_ARGUMENT if `hierarchy_level` or any element of
+  // `evaluation_points` is out of range.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const ValidatedDpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points) const {
+    return EvaluateAtImpl<T>(key.key(), hierarchy_level, evaluation_points,
+                             nullptr, nullptr, nullptr,
+                             /*key_is_validated=*/true);
+  }
+
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const ValidatedDpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points,
+      EvaluationScratch& scratch) const {
+    return EvaluateAtImpl<T>(key.key(), hierarchy_level, evaluation_points,
+                             nullptr, nullptr, &scratch,
+                             /*key_is_validated=*/true);
+  }
+
+  // Parses `key` into a flat, aligned layout for repeated evaluation. Use this
+  // when evaluating the same key at many point batches: the per-call proto
+  // validation and correction-word parsing of `EvaluateAt` are then paid only
+  // once, at compile time.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed.
+  absl::StatusOr<CompiledDpfKey> CompileDpfKey(const DpfKey& key) const;
+
+  // As `EvaluateAt` above, but takes a key compiled with `CompileDpfKey`,
+  // skipping the per-call key validation and correction-word parsing.
+  //
+  // Returns INVALID_ARGUMENT if `hierarchy_level` or any element of
+  // `evaluation_points` is out of range.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const CompiledDpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points) const {
+    return EvaluateAtImpl<T>(key.key(), hierarchy_level, evaluation_points,
+                             nullptr, &key);
+  }
+
+  // As the `EvaluateAt` overloads above, but carves the intermediate seed and
+  // hash buffers from `scratch` and recycles them there afterwards, avoiding
+  // per-call allocations of those buffers.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const DpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points,
+      EvaluationScratch& scratch) const {
+    return EvaluateAtImpl<T>(key, hierarchy_level, evaluation_points, nullptr,
+                             nullptr, &scratch);
+  }
+
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const CompiledDpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points,
+      EvaluationScratch& scratch) const {
+    return EvaluateAtImpl<T>(key.key(), hierarchy_level, evaluation_points,
+                             nullptr, &key, &scratch);
+  }
+
+  // As `EvaluateAt`, but *adds* the corrected value for each evaluation point
+  // into the corresponding element of `accumulator`, fusing the value
+  // correction with the aggregation; see `EvaluateUntilAccumulate`.
+  // `accumulator` must have one element per evaluation point.
+  //
+  // Returns INVALID_ARGUMENT if `accumulator.size() !=
+  // evaluation_points.size()`, in addition to the errors documented at
+  // `EvaluateAt`.
+  template <typename T>
+  absl::Status EvaluateAtAccumulate(
+      const DpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points,
+      absl::Span<T> accumulator) const {
+    if (accumulator.size() != evaluation_points.size()) {
+      return absl::InvalidArgumentError(
+          "`accumulator` must have the same size as `evaluation_points`");
+    }
+    return EvaluateAtImpl<T>(key, hierarchy_level, evaluation_points, nullptr,
+                             nullptr, nullptr,
+                             /*key_is_validated=*/false, accumulator)
+        .status();
+  }
+
+  // Validates `evaluation_points` against the domain at `hierarchy_level` and
+  // translates them into the tree and block indices used during evaluation.
+  // Use this when evaluating the same points under many keys: the per-call
+  // point validation, index translation, and aligned tree-index allocation of
+  // `EvaluateAt` are then paid only once.
+  //
+  // Returns INVALID_ARGUMENT if `hierarchy_level` or any element of
+  // `evaluation_points` is out of range.
+  absl::StatusOr<PrecomputedEvaluationPoints> PrecomputeEvaluationPoints(
+      absl::Span<const absl::uint128> evaluation_points,
+      int hierarchy_level) const;
+
+  // As `EvaluateAt` above, but takes points precomputed with
+  // `PrecomputeEvaluationPoints`, skipping the per-call point validation and
+  // index translation.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const DpfKey& key,
+      const PrecomputedEvaluationPoints& evaluation_points) const {
+    return EvaluateAtImpl<T>(key, evaluation_points.hierarchy_level_,
+                             evaluation_points.evaluation_points_, nullptr,
+                             nullptr, nullptr,
+                             /*key_is_validated=*/false,
+                             /*accumulator=*/absl::Span<T>(),
+                             &evaluation_points);
+  }
+
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const CompiledDpfKey& key,
+      const PrecomputedEvaluationPoints& evaluation_points) const {
+    return EvaluateAtImpl<T>(key.key(), evaluation_points.hierarchy_level_,
+                             evaluation_points.evaluation_points_, nullptr,
+                             &key, nullptr,
+                             /*key_is_validated=*/false,
+                             /*accumulator=*/absl::Span<T>(),
+                             &evaluation_points);
+  }
+
+  // Serializes `key` into a compact fixed-layout binary format. Unlike the
+  // proto wire format, all fields live at fixed offsets determined by the
+  // `DpfParameters` of this DPF, with no varint coding or per-message framing,
+  // so all keys for the same parameters serialize to the same number of bytes.
+  // The control bits of all levels are packed into a single bitfield, and
+  // integer value corrections take only `bitsize` / 8 bytes, so this is the
+  // preferred format when keys are sent over size-constrained links. The
+  // format is only guaranteed to be parseable by a `DistributedPointFunction`
+  // created with equal parameters.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed.
+  absl::StatusOr<std::string> SerializeKeyCompact(const DpfKey& key) const;
+
+  // Parses a key serialized with `SerializeKeyCompact`, reading directly from
+  // `serialized` without intermediate copies, and validates the result once.
+  // Round-trips with `SerializeKeyCompact`, i.e.,
+  // `ParseKeyCompact(SerializeKeyCompact(key))` returns a key equal to `key`.
+  //
+  // Returns INVALID_ARGUMENT if `serialized` is not a valid compact key for
+  // this DPF's parameters.
+  absl::StatusOr<DpfKey> ParseKeyCompact(absl::string_view serialized) const;
+
   // Evaluates a single key at one or multiple points, up to the given
   // `hierarchy_level`. Each element of `evaluation_points` must be within the
   // domain of this DPF at `hierarchy_level`.
@@ -359,11 +1083,107 @@ class DistributedPointFunction {
                              &ctx);
   }
 
+  // Evaluates multiple keys at the same set of `evaluation_points`, up to the
+  // given `hierarchy_level`. Equivalent to calling `EvaluateAt` once per key,
+  // but amortizes the evaluation point translation and buffer allocations
+  // across keys, and hashes the seed evaluations of all keys in a single
+  // batch. Returns the evaluations in key-major order, i.e., element
+  // `i * evaluation_points.size() + j` is the evaluation of `*keys[i]` at
+  // `evaluation_points[j]`.
+  //
+  // Returns INVALID_ARGUMENT if any key is malformed, or if `hierarchy_level`
+  // or any element of `evaluation_points` is out of range.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAtBatch(
+      absl::Span<const DpfKey* const> keys, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points) const {
+    return EvaluateAtBatchImpl<T>(keys, hierarchy_level, evaluation_points,
+                                  nullptr);
+  }
+
+  // As `EvaluateAtBatch` above, but takes points precomputed with
+  // `PrecomputeEvaluationPoints`, skipping the per-call point validation and
+  // index translation.
+  //
+  // Returns INVALID_ARGUMENT if any key is malformed.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAtBatch(
+      absl::Span<const DpfKey* const> keys,
+      const PrecomputedEvaluationPoints& evaluation_points) const {
+    return EvaluateAtBatchImpl<T>(keys, evaluation_points.hierarchy_level_,
+                                  evaluation_points.evaluation_points_,
+                                  &evaluation_points);
+  }
+
+  // Evaluates `key` on the entire domain at `hierarchy_level` with bounded
+  // memory, without materializing the full output. The domain is split into
+  // chunks of 2**`log_chunk_size` consecutive indices, each chunk's subtree is
+  // expanded and corrected into an internal buffer that is reused across
+  // chunks, and `callback` is invoked once per chunk with the corrected
+  // values and the domain index of the first value. Chunks are produced in
+  // increasing domain order. If `callback` returns a non-OK status, evaluation
+  // stops and that status is returned.
+  //
+  // Peak memory is proportional to 2**log_chunk_size instead of the domain
+  // size, so this is the preferred way to aggregate domains too large for
+  // `EvaluateUntil`.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed, `hierarchy_level` is out
+  // of range, `log_chunk_size` is negative or larger than 62, or the number
+  // of chunks would exceed 2**62.
+  template <typename T>
+  absl::Status EvaluateFullDomainStreaming(
+      const DpfKey& key, int hierarchy_level, int log_chunk_size,
+      absl::FunctionRef<absl::Status(absl::Span<const T>, absl::uint128)>
+          callback) const;
+
+  // Evaluates `key` on all domain indices in [`start`, `end`) at
+  // `hierarchy_level`, returning the outputs in domain order. The range is
+  // decomposed into maximal aligned subtrees, each of which is expanded with
+  // the full-subtree expansion machinery, so evaluating a 1/N slice of the
+  // domain costs roughly 1/N of a full expansion. Useful for sharding a large
+  // expansion across machines.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed, `hierarchy_level` is out
+  // of range, `start >= end`, `end` exceeds the domain size, or the range
+  // contains more than 2**62 indices.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateRange(const DpfKey& key,
+                                               int hierarchy_level,
+                                               absl::uint128 start,
+                                               absl::uint128 end) const;
+
   // Returns the DpfParameters of this DPF.
   inline absl::Span<const DpfParameters> parameters() const {
     return parameters_;
   }
 
+  // Sets the number of threads used for seed expansion in `EvaluateUntil` and
+  // `EvaluateNext`. The expansion frontier is split into `num_threads`
+  // independent subtree ranges once it is large enough, and each range is
+  // expanded on its own thread with its own AES contexts. Small expansions
+  // always run single-threaded, so setting this is safe for mixed workloads.
+  //
+  // Returns INVALID_ARGUMENT if `num_threads < 1`.
+  absl::Status SetNumEvaluationThreads(int num_threads);
+
+  // Returns true if the library was built with evaluation-stats collection
+  // (`DPF_ENABLE_EVALUATION_STATS`). See `EvaluationStats`.
+  static bool EvaluationStatsEnabled();
+
+  // Registers `sink` as the `EvaluationStats` sink for the calling thread.
+  // While a sink is registered, evaluation calls on this thread accumulate
+  // their counters into it. Pass nullptr to stop collecting. A no-op if stats
+  // collection is compiled out.
+  static void SetEvaluationStatsSink(EvaluationStats* sink);
+
+  // Returns the sink registered for the calling thread, or nullptr.
+  static EvaluationStats* GetEvaluationStatsSink();
+
+  // Returns the SIMD target selected by Highway, e.g. "AVX2". Useful for
+  // interpreting collected stats across heterogeneous hardware.
+  static absl::string_view GetHwyModeAsString();
+
  private:
   // BitVector is a vector of bools. Allows for faster access times than
   // std::vector<bool>, as well as inlining if the size is small.
@@ -372,11 +1192,16 @@ class DistributedPointFunction {
                           std::max<size_t>(1, sizeof(bool*) / sizeof(bool))>;
 
   // Seeds and control bits resulting from a DPF expansion. This type is
-  // returned by `ExpandSeeds` and `ExpandAndUpdateContext`.
+  // returned by `ExpandSeeds` and `ExpandAndUpdateContext`. Control bits are
+  // stored packed into 64-bit words, which keeps their memory footprint 8x
+  // smaller than a bool-per-bit layout at large expansion frontiers.
   struct DpfExpansion {
     // Ensures that seeds are aligned correctly for SIMD operations.
     hwy::AlignedFreeUniquePtr<absl::uint128[]> seeds;
-    BitVector control_bits;
+    // Capacity of `seeds` if it was acquired from an `EvaluationScratch`, used
+    // to recycle the buffer after use. 0 if `seeds` was allocated directly.
+    int64_t seeds_capacity = 0;
+    dpf_internal::PackedControlBits control_bits;
   };
 
   // A function for computing value corrections. Used as return type in
@@ -393,6 +1218,17 @@ class DistributedPointFunction {
       absl::flat_hash_map<std::string, ValueCorrectionFunction>
           value_correction_functions);
 
+  // Signature of the value correction computation invoked during key
+  // generation whenever a hierarchy level is reached. `alpha_prefix` is
+  // `alpha` truncated to the domain of `hierarchy_level`. The callback returns
+  // the value correction words for that level, or a Status in case of an
+  // error. Used to dispatch between the string-keyed function map (for `Value`
+  // betas) and compile-time typed computation (for native betas).
+  using ValueCorrectionCallback =
+      absl::FunctionRef<absl::StatusOr<std::vector<Value>>(
+          int hierarchy_level, absl::Span<const absl::uint128> seeds,
+          absl::uint128 alpha_prefix, bool invert)>;
+
   // Computes the value correction for the given `hierarchy_level`, `seeds`,
   // index `alpha` and value `beta`. If `invert` is true, the individual values
   // in the returned block are multiplied element-wise by -1. Expands `seeds`
@@ -409,16 +1245,58 @@ class DistributedPointFunction {
       int hierarchy_level, absl::Span<const absl::uint128> seeds,
       absl::uint128 alpha, const Value& beta, bool invert) const;
 
+  // As `ComputeValueCorrection`, but with `beta` passed as a native element of
+  // type T, and the value correction computed by a compile-time instantiation
+  // of `dpf_internal::ComputeValueCorrectionForTyped<T>` instead of going
+  // through the string-keyed function map.
+  //
+  // Returns INTERNAL in case the PRG expansion fails.
+  template <typename T>
+  absl::StatusOr<std::vector<Value>> ComputeValueCorrectionTyped(
+      int hierarchy_level, absl::Span<const absl::uint128> seeds,
+      absl::uint128 alpha, const T& beta, bool invert) const;
+
+  // Generates a key pair for index `alpha`, computing value corrections with
+  // `compute_value_correction`. Implements `GenerateKeysIncremental` and the
+  // typed `GenerateKeys` fast path, which differ only in how value corrections
+  // are computed. Does not validate betas; callers are responsible for
+  // checking them against `parameters_`.
+  absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeysImpl(
+      absl::uint128 alpha, ValueCorrectionCallback compute_value_correction);
+
   // Expands the PRG seeds at the next `tree_level` for an incremental DPF with
-  // index `alpha` and values `beta`, updates `seeds` and `control_bits`, and
-  // writes the next correction word to `keys`. Called from
-  // `GenerateKeysIncremental`.
+  // index `alpha`, updates `seeds` and `control_bits`, and writes the next
+  // correction word to `keys`. If a hierarchy level is reached, its value
+  // correction is computed with `compute_value_correction`. Called from
+  // `GenerateKeysImpl`.
   absl::Status GenerateNext(int tree_level, absl::uint128 alpha,
-                            absl::Span<const Value> beta,
+                            ValueCorrectionCallback compute_value_correction,
                             absl::Span<absl::uint128> seeds,
                             absl::Span<bool> control_bits,
                             absl::Span<DpfKey> keys) const;
 
+  // As `ComputeValueCorrection`, but for a whole batch of keys, with a single
+  // PRG call for all seeds. `seeds` and `control_bits` hold two elements per
+  // key, `betas` holds `parameters_.size()` values per key (key-major), and
+  // the value correction for key j is computed from `betas[j *
+  // parameters_.size() + hierarchy_level]`, inverted if `control_bits[2 * j +
+  // 1]` is set. Called from `GenerateKeysBatch`.
+  absl::StatusOr<std::vector<std::vector<Value>>> ComputeValueCorrectionBatch(
+      int hierarchy_level, absl::Span<const absl::uint128> seeds,
+      absl::Span<const absl::uint128> alphas, absl::Span<const Value> betas,
+      absl::Span<const bool> control_bits) const;
+
+  // As `GenerateNext`, but advances all keys of a batch by one tree level,
+  // batching the left/right/value PRG evaluations of the whole batch into
+  // single `Aes128FixedKeyHash` calls. `seeds` and `control_bits` hold two
+  // elements per key, and `betas` is laid out as in
+  // `ComputeValueCorrectionBatch`. Called from `GenerateKeysBatch`.
+  absl::Status GenerateNextBatch(
+      int tree_level, absl::Span<const absl::uint128> alphas,
+      absl::Span<const Value> betas, absl::Span<absl::uint128> seeds,
+      absl::Span<bool> control_bits,
+      absl::Span<std::pair<DpfKey, DpfKey>> keys) const;
+
   // Computes the tree index (representing a path in the FSS tree) from the
   // given `domain_index` and `hierarchy_level`. Does NOT check whether the
   // given domain index fits in the domain at `hierarchy_level`.
@@ -453,6 +1331,26 @@ class DistributedPointFunction {
       absl::Span<absl::uint128> seeds_out,
       absl::Span<bool> control_bits_out) const;
 
+  // As `EvaluateSeeds` above, but with control bits packed into 64-bit words.
+  // `control_bits` and `control_bits_out` may refer to the same object.
+  absl::Status EvaluateSeeds(
+      absl::Span<const absl::uint128> seeds,
+      const dpf_internal::PackedControlBits& control_bits,
+      absl::Span<const absl::uint128> paths,
+      absl::Span<const CorrectionWord* const> correction_words,
+      absl::Span<absl::uint128> seeds_out,
+      dpf_internal::PackedControlBits& control_bits_out) const;
+
+  // As above, but reads `num_levels` correction words starting at tree level
+  // `start_level` from `compiled_key`'s flat arrays, avoiding the per-call
+  // correction-word parsing of the other overloads.
+  absl::Status EvaluateSeeds(
+      absl::Span<const absl::uint128> seeds,
+      const dpf_internal::PackedControlBits& control_bits,
+      absl::Span<const absl::uint128> paths, const CompiledDpfKey& compiled_key,
+      int start_level, int num_levels, absl::Span<absl::uint128> seeds_out,
+      dpf_internal::PackedControlBits& control_bits_out) const;
+
   // Performs DPF expansion of the given `partial_evaluations` using
   // prg_ctx_left_ and prg_ctx_right_, and the given `correction_words`. In
   // more detail, each of the partial evaluations is subjected to a full
@@ -462,9 +1360,34 @@ class DistributedPointFunction {
   // in a single `DpfExpansion`.
   //
   // Returns INTERNAL in case of OpenSSL errors.
+  // If `scratch != nullptr`, the expansion buffers are acquired from it, and
+  // intermediate buffers are recycled into it.
   absl::StatusOr<DpfExpansion> ExpandSeeds(
       const DpfExpansion& partial_evaluations,
-      absl::Span<const CorrectionWord* const> correction_words) const;
+      absl::Span<const CorrectionWord* const> correction_words,
+      EvaluationScratch* scratch = nullptr) const;
+
+  // As `ExpandSeeds`, but splits the expansion across `num_threads` threads
+  // (or `num_evaluation_threads_` if `num_threads <= 0`) if the output is
+  // large enough to amortize thread startup. First expands sequentially until
+  // the frontier contains at least one subtree per thread, then splits the
+  // frontier into contiguous ranges which the threads claim dynamically from
+  // a shared counter and expand into disjoint slices of the output. Falls
+  // back to `ExpandSeeds` for small expansions or if a single thread is used.
+  //
+  // On machines with more than one NUMA node, the frontier is additionally
+  // sharded per node: worker threads are pinned to their shard's node and the
+  // output pages are first-touched by the node that expands into them, so
+  // seed traffic stays socket-local until the final merge. Threads steal
+  // tasks from remote shards only once their own shard is drained. See
+  // `dpf_internal::NumNumaNodes`; on unsupported platforms this degrades to
+  // the plain dynamic schedule.
+  //
+  // Returns INTERNAL in case of OpenSSL errors.
+  absl::StatusOr<DpfExpansion> ExpandSeedsParallel(
+      const DpfExpansion& partial_evaluations,
+      absl::Span<const CorrectionWord* const> correction_words,
+      EvaluationScratch* scratch = nullptr, int num_threads = 0) const;
 
   // Computes partial evaluations of the paths to `prefixes` up to
   // `hierarchy_level`, to be used as the starting point of the expansion of
@@ -478,7 +1401,8 @@ class DistributedPointFunction {
   // duplicate prefixes with inconsistent seeds or control bits.
   absl::StatusOr<DpfExpansion> ComputePartialEvaluations(
       absl::Span<const absl::uint128> prefixes, int hierarchy_level,
-      bool update_ctx, EvaluationContext& ctx) const;
+      bool update_ctx, EvaluationContext& ctx,
+      EvaluationScratch* scratch = nullptr) const;
 
   // Extracts the seeds for the given `prefixes` from `ctx` and expands them as
   // far as needed for the next hierarchy level. Returns the result as a
@@ -494,16 +1418,148 @@ class DistributedPointFunction {
   // INTERNAL in case of OpenSSL errors.
   absl::StatusOr<DpfExpansion> ExpandAndUpdateContext(
       int hierarchy_level, absl::Span<const absl::uint128> prefixes,
-      EvaluationContext& ctx) const;
+      EvaluationContext& ctx, EvaluationScratch* scratch = nullptr,
+      int num_threads = 0) const;
+
+  // As the `EvaluationContext` overload above, but reads previous partial
+  // evaluations from the sorted native arrays in `state` and, if `update_state
+  // == true`, writes them back without building proto messages.
+  //
+  // Returns INVALID_ARGUMENT if any element of `prefixes` is not found in the
+  // partial evaluations of `state`.
+  absl::StatusOr<DpfExpansion> ComputePartialEvaluations(
+      absl::Span<const absl::uint128> prefixes, int hierarchy_level,
+      bool update_state, EvaluationState& state,
+      EvaluationScratch* scratch = nullptr) const;
+
+  // As the `EvaluationContext` overload of `ExpandAndUpdateContext`, but
+  // operates on a native `EvaluationState`.
+  //
+  // Returns INVALID_ARGUMENT if any element of `prefixes` is not found in the
+  // partial evaluations of `state`. Returns INTERNAL in case of OpenSSL
+  // errors.
+  absl::StatusOr<DpfExpansion> ExpandAndUpdateState(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      EvaluationState& state, EvaluationScratch* scratch = nullptr,
+      int num_threads = 0) const;
+
+  // Validates the arguments shared by `EvaluateUntilImpl` and
+  // `EvaluateUntilLazyImpl`: `hierarchy_level` must be in range and greater
+  // than `previous_hierarchy_level`, `prefixes` must be empty if and only if
+  // this is the first evaluation, each prefix must be in the domain of the
+  // previous hierarchy level, and the output size must not exceed 2**62.
+  //
+  // Returns INVALID_ARGUMENT if any of these conditions is violated.
+  absl::Status ValidateEvaluateUntilParams(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      int previous_hierarchy_level) const;
+
+  // The `prefixes` passed to `EvaluateUntil` refer to the domain of the
+  // previous hierarchy level. However, because we batch multiple elements of
+  // type T in a single uint128 block, multiple prefixes can actually refer to
+  // the same block in the FSS evaluation tree. This function splits up each
+  // element of `prefixes` into a tree index, pointing to a block in the FSS
+  // tree, and a block index, pointing to an element of type T in that block.
+  // `tree_indices` is filled with the deduplicated tree indices, to be passed
+  // to `ExpandAndUpdateContext`, and `prefix_map` maps each i <
+  // prefixes.size() to the position of its tree index in `tree_indices` and
+  // its block index, so expanded values can be returned in the same order as
+  // `prefixes`.
+  void ComputeTreeIndices(absl::Span<const absl::uint128> prefixes,
+                          int previous_hierarchy_level,
+                          std::vector<absl::uint128>& tree_indices,
+                          std::vector<std::pair<int64_t, int>>& prefix_map)
+      const;
+
+  // Shared implementation of the `EvaluationContext` and `EvaluationState`
+  // overloads of `EvaluateUntil`. `key` and `previous_hierarchy_level` are
+  // read from the context or state, and `expand` wraps the corresponding
+  // `ExpandAndUpdateContext`/`ExpandAndUpdateState` call for the deduplicated
+  // tree indices. If `kAccumulate` is true, the corrected values are added
+  // into `output` instead of overwriting it; see `EvaluateUntilAccumulate`.
+  template <typename T, bool kAccumulate = false>
+  absl::Status EvaluateUntilImpl(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      const DpfKey& key, int previous_hierarchy_level,
+      absl::FunctionRef<absl::StatusOr<DpfExpansion>(
+          absl::Span<const absl::uint128>)>
+          expand,
+      absl::Span<T> output, EvaluationScratch* scratch = nullptr) const;
+
+  // Implementation of `EvaluateUntilLazy`. Performs the same validation,
+  // prefix deduplication and seed expansion as `EvaluateUntilImpl`, but stops
+  // before the value hashing and wraps the raw expansion in a
+  // `LazyEvaluation` handle instead.
+  template <typename T>
+  absl::StatusOr<LazyEvaluation<T>> EvaluateUntilLazyImpl(
+      int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+      const DpfKey& key, int previous_hierarchy_level,
+      absl::FunctionRef<absl::StatusOr<DpfExpansion>(
+          absl::Span<const absl::uint128>)>
+          expand) const;
+
+  // Acquires an aligned buffer of `size` seeds from `scratch`, or allocates a
+  // fresh one if `scratch == nullptr`.
+  //
+  // Returns RESOURCE_EXHAUSTED if allocation fails.
+  static absl::StatusOr<EvaluationScratch::Buffer> AcquireBuffer(
+      int64_t size, EvaluationScratch* scratch);
+
+  // Returns a buffer acquired with `AcquireBuffer` to `scratch` for reuse.
+  // Frees the buffer if `scratch == nullptr` or `capacity == 0` (i.e., the
+  // buffer was not acquired from a scratch).
+  static void RecycleBuffer(hwy::AlignedFreeUniquePtr<absl::uint128[]> data,
+                            int64_t capacity, EvaluationScratch* scratch);
 
   // Compute output PRG value of expanded seeds using prg_ctx_value_.
   // Returns blocks_needed_[hierarchy_level] * expansion.seeds.size() blocks,
   // where every blocks_needed_[hierarchy_level] correspond to the hash of an
-  // input seed.
+  // input seed. The returned buffer is acquired with `AcquireBuffer`, so
+  // callers with a `scratch` can recycle it after use.
+  //
+  // Returns INTERNAL in case of OpenSSL errors.
+  absl::StatusOr<EvaluationScratch::Buffer> HashExpandedSeeds(
+      int hierarchy_level, absl::Span<const absl::uint128> expansion,
+      EvaluationScratch* scratch = nullptr) const;
+
+  // As `HashExpandedSeeds`, but writes the hashes into the caller-provided
+  // `hashed_expansion`, which must have space for `expansion.size() *
+  // blocks_needed_[hierarchy_level]` blocks. Safe to call concurrently from
+  // multiple threads, as long as the output buffers are disjoint.
   //
   // Returns INTERNAL in case of OpenSSL errors.
-  absl::StatusOr<hwy::AlignedFreeUniquePtr<absl::uint128[]>> HashExpandedSeeds(
-      int hierarchy_level, absl::Span<const absl::uint128> expansion) const;
+  absl::Status HashExpandedSeedsInto(int hierarchy_level,
+                                     absl::Span<const absl::uint128> expansion,
+                                     absl::uint128* hashed_expansion) const;
+
+  // Processes the blocks `[0, num_blocks)` in chunks of `chunk_blocks`,
+  // calling `hash_chunk` for chunk k+1 on a helper thread while
+  // `correct_chunk` runs for chunk k on the calling thread. Uses two hash
+  // buffers of `buffer_size` blocks each, so the hashed data of a chunk stays
+  // cache-resident between hashing and correction instead of sweeping a
+  // full-expansion buffer twice. Called by `EvaluateUntilImpl` for large
+  // expansions.
+  //
+  // Returns RESOURCE_EXHAUSTED if allocating the chunk buffers fails, and
+  // any error returned by `hash_chunk`.
+  static absl::Status PipelineHashAndCorrect(
+      int64_t num_blocks, int64_t chunk_blocks, int64_t buffer_size,
+      absl::FunctionRef<absl::Status(int64_t begin, int64_t end,
+                                     absl::uint128* hashed)>
+          hash_chunk,
+      absl::FunctionRef<void(int64_t begin, int64_t end,
+                             const absl::uint128* hashed)>
+          correct_chunk);
+
+  // Number of hashed blocks per chunk in `PipelineHashAndCorrect`, i.e., 512
+  // KiB of hashed data per buffer. Chosen so that a chunk fits comfortably in
+  // the L2 cache. For value types that need multiple hash blocks per seed,
+  // `EvaluateUntilImpl` divides this by `blocks_needed` when computing the
+  // number of seeds per chunk, so that the chunk size in bytes stays the same.
+  // Must be a multiple of `dpf_internal::PackedControlBits::kBitsPerWord`, so
+  // that the vectorized value correction can read control bits at word
+  // granularity per chunk.
+  static constexpr int64_t kPipelineChunkBlocks = int64_t{1} << 15;
 
   // Deterministically serializes the given value_type.
   //
@@ -526,15 +1582,39 @@ class DistributedPointFunction {
       absl::flat_hash_map<std::string, ValueCorrectionFunction>&
           value_correction_functions);
 
-  // Joint implementation of the two variants of `EvaluateAt<T>`. If `ctx !=
+  // Joint implementation of the variants of `EvaluateAt<T>`. If `ctx !=
   // NULL`, `key` must point to `ctx->key()`, and `*ctx` will be updated with
-  // the partial evaluations at this `hierarchy_level`.
+  // the partial evaluations at this `hierarchy_level`. If `compiled_key !=
+  // NULL`, `key` must point to `compiled_key->key()`; validation is then
+  // skipped (it already happened in `CompileDpfKey`) and correction words are
+  // read from the compiled key's flat arrays. If `scratch != NULL`,
+  // intermediate buffers are acquired from and recycled into it. If
+  // `key_is_validated` is true, `key` was validated before (e.g., by
+  // `ValidateKey`) and the per-call validation is skipped. If `accumulator`
+  // is non-empty, it must have one element per evaluation point; the
+  // corrected values are then added into it and the returned vector is empty.
+  // If `precomputed != NULL`, it must have been created from
+  // `evaluation_points` and `hierarchy_level`; the per-call point validation
+  // and index translation are then skipped.
   //
   template <typename T>
   absl::StatusOr<std::vector<T>> EvaluateAtImpl(
       const DpfKey& key, int hierarchy_level,
+      absl::Span<const absl::uint128> evaluation_points, EvaluationContext* ctx,
+      const CompiledDpfKey* compiled_key = nullptr,
+      EvaluationScratch* scratch = nullptr, bool key_is_validated = false,
+      absl::Span<T> accumulator = {},
+      const PrecomputedEvaluationPoints* precomputed = nullptr) const;
+
+  // Joint implementation of the `EvaluateAtBatch<T>` overloads. If
+  // `precomputed != NULL`, it must have been created from `evaluation_points`
+  // and `hierarchy_level`, and the per-call point validation and index
+  // translation are skipped.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateAtBatchImpl(
+      absl::Span<const DpfKey* const> keys, int hierarchy_level,
       absl::Span<const absl::uint128> evaluation_points,
-      EvaluationContext* ctx) const;
+      const PrecomputedEvaluationPoints* precomputed) const;
 
   // Used to validate DpfParameters, DpfKey and EvaluationContext protos.
   const std::unique_ptr<dpf_internal::ProtoValidator> proto_validator_;
@@ -582,6 +1662,88 @@ class DistributedPointFunction {
   // correct values for it anyway.
   absl::flat_hash_map<std::string, ValueCorrectionFunction>
       value_correction_functions_;
+
+  // Number of threads used by `ExpandSeedsParallel`. Set via
+  // `SetNumEvaluationThreads`. Defaults to 1, i.e., sequential expansion.
+  int num_evaluation_threads_ = 1;
+
+  // `LazyEvaluation` hashes selected expansion blocks via
+  // `HashExpandedSeedsInto`.
+  template <typename U>
+  friend class LazyEvaluation;
+};
+
+// A handle over an expanded but not yet hashed DPF evaluation, returned by
+// `DistributedPointFunction::EvaluateUntilLazy`. Holds the raw expansion
+// frontier; the value-hashing PRG and the output correction only run when
+// outputs are materialized, and only for the blocks containing the requested
+// indices, so outputs that are never read cost no AES work beyond the seed
+// expansion. The `DistributedPointFunction` that created the handle must
+// outlive it.
+template <typename T>
+class LazyEvaluation {
+ public:
+  // LazyEvaluation is movable but not copyable.
+  LazyEvaluation(LazyEvaluation&&) = default;
+  LazyEvaluation& operator=(LazyEvaluation&&) = default;
+  LazyEvaluation(const LazyEvaluation&) = delete;
+  LazyEvaluation& operator=(const LazyEvaluation&) = delete;
+
+  // Returns the number of outputs of the evaluation, i.e., the exclusive
+  // upper bound on the indices accepted by `Materialize`.
+  int64_t size() const { return num_outputs_; }
+
+  // Hashes and corrects the outputs at `indices`, returned in the same order.
+  // Each index must be in `[0, size())`; indices may repeat. Each expansion
+  // block is hashed at most once per call, but no hashes are cached across
+  // calls, so callers should batch the indices they need.
+  //
+  // Returns INVALID_ARGUMENT if an index is out of range, RESOURCE_EXHAUSTED
+  // if allocating the hash buffer fails, and INTERNAL in case of OpenSSL
+  // errors.
+  absl::StatusOr<std::vector<T>> Materialize(
+      absl::Span<const int64_t> indices) const;
+
+ private:
+  friend class DistributedPointFunction;
+
+  LazyEvaluation() = default;
+
+  // The DPF this evaluation was created by. Not owned.
+  const DistributedPointFunction* dpf_ = nullptr;
+
+  // The hierarchy level the expansion corresponds to.
+  int hierarchy_level_ = 0;
+
+  // The unhashed expansion frontier.
+  DistributedPointFunction::DpfExpansion expansion_;
+
+  // Output value correction from the key, split into elements of type T.
+  std::array<T, dpf_internal::ElementsPerBlock<T>()> correction_ints_;
+
+  // Whether corrected values are negated (i.e., the key belongs to party 1).
+  bool negate_ = false;
+
+  // Number of outputs per expansion block at `hierarchy_level_`.
+  int corrected_elements_per_block_ = 1;
+
+  // Number of hash blocks per seed at `hierarchy_level_`.
+  int blocks_needed_ = 1;
+
+  // Number of outputs per prefix passed to `EvaluateUntilLazy`.
+  int64_t outputs_per_prefix_ = 0;
+
+  // Number of expansion blocks per unique tree prefix. 0 if the evaluation
+  // was created without prefixes.
+  int64_t blocks_per_tree_prefix_ = 0;
+
+  // Maps each prefix to the position of its tree index and its block index;
+  // see `DistributedPointFunction::ComputeTreeIndices`. Empty if the
+  // evaluation was created without prefixes.
+  std::vector<std::pair<int64_t, int>> prefix_map_;
+
+  // Total number of outputs.
+  int64_t num_outputs_ = 0;
 };
 
 //========================//
@@ -603,12 +1765,43 @@ absl::Status DistributedPointFunction::RegisterValueTypeImpl(
   return absl::OkStatus();
 }
 
-template <typename T0, typename... Tn, typename /*= absl::enable_if_t<...>*/>
-absl::StatusOr<std::pair<DpfKey, DpfKey>>
-DistributedPointFunction::GenerateKeysIncremental(absl::uint128 alpha,
-                                                  T0&& beta_0, Tn&&... beta_n) {
-  // Convert the first element of beta. We need to treat it separately to be
-  // able to check its type in the enable_if above.
+template <typename T>
+absl::StatusOr<std::vector<Value>>
+DistributedPointFunction::ComputeValueCorrectionTyped(
+    int hierarchy_level, absl::Span<const absl::uint128> seeds,
+    absl::uint128 alpha, const T& beta, bool invert) const {
+  // Expand the seeds with `prg_value_` as in `ComputeValueCorrection`.
+  int blocks_needed = blocks_needed_[hierarchy_level];
+  std::vector<absl::uint128> expanded_seeds(2 * blocks_needed);
+  absl::Span<absl::uint128> expanded_seed_a(&expanded_seeds[0], blocks_needed);
+  absl::Span<absl::uint128> expanded_seed_b(&expanded_seeds[blocks_needed],
+                                            blocks_needed);
+  DCHECK(seeds.size() == 2);
+  std::iota(expanded_seed_a.begin(), expanded_seed_a.end(), seeds[0]);
+  std::iota(expanded_seed_b.begin(), expanded_seed_b.end(), seeds[1]);
+  absl::Status status =
+      prg_value_.Evaluate(expanded_seeds, absl::MakeSpan(expanded_seeds));
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Compute index in block for alpha at the current hierarchy level, and
+  // dispatch to the typed value correction at compile time.
+  int index_in_block = DomainToBlockIndex(alpha, hierarchy_level);
+  return dpf_internal::ComputeValueCorrectionForTyped<T>(
+      absl::string_view(reinterpret_cast<const char*>(expanded_seed_a.data()),
+                        blocks_needed * sizeof(absl::uint128)),
+      absl::string_view(reinterpret_cast<const char*>(expanded_seed_b.data()),
+                        blocks_needed * sizeof(absl::uint128)),
+      index_in_block, beta, invert);
+}
+
+template <typename T0, typename... Tn, typename /*= absl::enable_if_t<...>*/>
+absl::StatusOr<std::pair<DpfKey, DpfKey>>
+DistributedPointFunction::GenerateKeysIncremental(absl::uint128 alpha,
+                                                  T0&& beta_0, Tn&&... beta_n) {
+  // Convert the first element of beta. We need to treat it separately to be
+  // able to check its type in the enable_if above.
   absl::StatusOr<Value> value = ToValue(beta_0);
   if (!value.ok()) {
     return value.status();
@@ -642,15 +1835,182 @@ template <typename T>
 absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
     int hierarchy_level, absl::Span<const absl::uint128> prefixes,
     EvaluationContext& ctx) const {
+  absl::StatusOr<int64_t> output_size =
+      GetOutputSize(hierarchy_level, static_cast<int64_t>(prefixes.size()), ctx);
+  if (!output_size.ok()) {
+    return output_size.status();
+  }
+  std::vector<T> result(*output_size);
+  absl::Status status =
+      EvaluateUntil<T>(hierarchy_level, prefixes, ctx, absl::MakeSpan(result));
+  if (!status.ok()) {
+    return status;
+  }
+  return result;
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationContext& ctx, absl::Span<T> output) const {
   absl::Status status = proto_validator_->ValidateEvaluationContext(ctx);
   if (!status.ok()) {
     return status;
   }
-  if (hierarchy_level < 0 ||
-      hierarchy_level >= static_cast<int>(parameters_.size())) {
-    return absl::InvalidArgumentError(
-        "`hierarchy_level` must be non-negative and less than "
-        "parameters_.size()");
+  return EvaluateUntilImpl<T>(
+      hierarchy_level, prefixes, ctx.key(), ctx.previous_hierarchy_level(),
+      [this, hierarchy_level,
+       &ctx](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx);
+      },
+      output);
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationState& state) const {
+  absl::StatusOr<int64_t> output_size = GetOutputSize(
+      hierarchy_level, static_cast<int64_t>(prefixes.size()), state);
+  if (!output_size.ok()) {
+    return output_size.status();
+  }
+  std::vector<T> result(*output_size);
+  absl::Status status = EvaluateUntil<T>(hierarchy_level, prefixes, state,
+                                         absl::MakeSpan(result));
+  if (!status.ok()) {
+    return status;
+  }
+  return result;
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationState& state, absl::Span<T> output) const {
+  // `state.key_` was validated when the state was created, so no per-call
+  // validation is needed here.
+  return EvaluateUntilImpl<T>(
+      hierarchy_level, prefixes, state.key(),
+      state.previous_hierarchy_level(),
+      [this, hierarchy_level,
+       &state](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateState(hierarchy_level, tree_indices, state);
+      },
+      output);
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationContext& ctx, absl::Span<T> output,
+    EvaluationScratch& scratch) const {
+  absl::Status status = proto_validator_->ValidateEvaluationContext(ctx);
+  if (!status.ok()) {
+    return status;
+  }
+  return EvaluateUntilImpl<T>(
+      hierarchy_level, prefixes, ctx.key(), ctx.previous_hierarchy_level(),
+      [this, hierarchy_level, &ctx,
+       &scratch](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx,
+                                      &scratch);
+      },
+      output, &scratch);
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationState& state, absl::Span<T> output,
+    EvaluationScratch& scratch) const {
+  return EvaluateUntilImpl<T>(
+      hierarchy_level, prefixes, state.key(),
+      state.previous_hierarchy_level(),
+      [this, hierarchy_level, &state,
+       &scratch](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateState(hierarchy_level, tree_indices, state,
+                                    &scratch);
+      },
+      output, &scratch);
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntilParallel(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationContext& ctx, int num_threads) const {
+  if (num_threads < 1) {
+    return absl::InvalidArgumentError("`num_threads` must be positive");
+  }
+  absl::Status status = proto_validator_->ValidateEvaluationContext(ctx);
+  if (!status.ok()) {
+    return status;
+  }
+  absl::StatusOr<int64_t> output_size =
+      GetOutputSize(hierarchy_level, static_cast<int64_t>(prefixes.size()), ctx);
+  if (!output_size.ok()) {
+    return output_size.status();
+  }
+  std::vector<T> result(*output_size);
+  status = EvaluateUntilImpl<T>(
+      hierarchy_level, prefixes, ctx.key(), ctx.previous_hierarchy_level(),
+      [this, hierarchy_level, &ctx,
+       num_threads](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx,
+                                      /*scratch=*/nullptr, num_threads);
+      },
+      absl::MakeSpan(result));
+  if (!status.ok()) {
+    return status;
+  }
+  return result;
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateUntilAccumulate(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationContext& ctx, absl::Span<T> accumulator) const {
+  absl::Status status = proto_validator_->ValidateEvaluationContext(ctx);
+  if (!status.ok()) {
+    return status;
+  }
+  return EvaluateUntilImpl<T, /*kAccumulate=*/true>(
+      hierarchy_level, prefixes, ctx.key(), ctx.previous_hierarchy_level(),
+      [this, hierarchy_level,
+       &ctx](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx);
+      },
+      accumulator);
+}
+
+template <typename T>
+absl::StatusOr<LazyEvaluation<T>> DistributedPointFunction::EvaluateUntilLazy(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    EvaluationContext& ctx) const {
+  absl::Status status = proto_validator_->ValidateEvaluationContext(ctx);
+  if (!status.ok()) {
+    return status;
+  }
+  return EvaluateUntilLazyImpl<T>(
+      hierarchy_level, prefixes, ctx.key(), ctx.previous_hierarchy_level(),
+      [this, hierarchy_level,
+       &ctx](absl::Span<const absl::uint128> tree_indices) {
+        return ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx);
+      });
+}
+
+template <typename T>
+absl::StatusOr<LazyEvaluation<T>>
+DistributedPointFunction::EvaluateUntilLazyImpl(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    const DpfKey& key, int previous_hierarchy_level,
+    absl::FunctionRef<
+        absl::StatusOr<DpfExpansion>(absl::Span<const absl::uint128>)>
+        expand) const {
+  absl::Status validation_status = ValidateEvaluateUntilParams(
+      hierarchy_level, prefixes, previous_hierarchy_level);
+  if (!validation_status.ok()) {
+    return validation_status;
   }
   absl::StatusOr<bool> types_are_equal = dpf_internal::ValueTypesAreEqual(
       ToValueType<T>(), parameters_[hierarchy_level].value_type());
@@ -660,90 +2020,191 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
     return absl::InvalidArgumentError(
         "Value type T doesn't match parameters at `hierarchy_level`");
   }
-  if (hierarchy_level <= ctx.previous_hierarchy_level()) {
-    return absl::InvalidArgumentError(
-        "`hierarchy_level` must be greater than "
-        "`ctx.previous_hierarchy_level`");
+
+  std::vector<absl::uint128> tree_indices;
+  std::vector<std::pair<int64_t, int>> prefix_map;
+  ComputeTreeIndices(prefixes, previous_hierarchy_level, tree_indices,
+                     prefix_map);
+
+  // Perform expansion of unique `tree_indices`, but stop before hashing: the
+  // handle below hashes blocks on demand in `Materialize`.
+  absl::StatusOr<DpfExpansion> expansion = expand(tree_indices);
+  if (!expansion.ok()) {
+    return expansion.status();
   }
-  if ((ctx.previous_hierarchy_level() < 0) != (prefixes.empty())) {
-    return absl::InvalidArgumentError(
-        "`prefixes` must be empty if and only if this is the first call with "
-        "`ctx`.");
+
+  // Get output correction word from `key`.
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  const ::google::protobuf::RepeatedPtrField<Value>* value_correction = nullptr;
+  if (hierarchy_level < static_cast<int>(parameters_.size()) - 1) {
+    value_correction =
+        &(key.correction_words(hierarchy_to_tree_[hierarchy_level])
+              .value_correction());
+  } else {
+    // Last level value correction is stored in an extra proto field, since we
+    // have one less correction word than tree levels.
+    value_correction = &(key.last_level_value_correction());
+  }
+  absl::StatusOr<std::array<T, elements_per_block>> correction_ints =
+      dpf_internal::ValuesToArray<T>(*value_correction);
+  if (!correction_ints.ok()) {
+    return correction_ints.status();
   }
 
   int previous_log_domain_size = 0;
-  int previous_hierarchy_level = ctx.previous_hierarchy_level();
   if (!prefixes.empty()) {
-    DCHECK(ctx.previous_hierarchy_level() >= 0);
     previous_log_domain_size =
         parameters_[previous_hierarchy_level].log_domain_size();
-    for (absl::uint128 prefix : prefixes) {
-      if (previous_log_domain_size < 128 &&
-          prefix >= (absl::uint128{1} << previous_log_domain_size)) {
-        return absl::InvalidArgumentError(
-            absl::StrFormat("Index %d out of range for hierarchy level %d",
-                            prefix, previous_hierarchy_level));
-      }
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+
+  LazyEvaluation<T> result;
+  result.dpf_ = this;
+  result.hierarchy_level_ = hierarchy_level;
+  result.correction_ints_ = *correction_ints;
+  result.negate_ = key.party() == 1;
+  result.corrected_elements_per_block_ =
+      1 << (log_domain_size - hierarchy_to_tree_[hierarchy_level]);
+  result.blocks_needed_ = blocks_needed_[hierarchy_level];
+  result.outputs_per_prefix_ = int64_t{1}
+                               << (log_domain_size - previous_log_domain_size);
+  result.blocks_per_tree_prefix_ =
+      prefixes.empty() ? 0
+                       : static_cast<int64_t>(expansion->control_bits.size()) /
+                             static_cast<int64_t>(tree_indices.size());
+  result.prefix_map_ = std::move(prefix_map);
+  result.num_outputs_ =
+      (prefixes.empty() ? int64_t{1} : static_cast<int64_t>(prefixes.size())) *
+      result.outputs_per_prefix_;
+  result.expansion_ = *std::move(expansion);
+  return result;
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> LazyEvaluation<T>::Materialize(
+    absl::Span<const int64_t> indices) const {
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  const auto num_indices = static_cast<int64_t>(indices.size());
+
+  // Map each requested output to its block in the expansion and its element
+  // within that block, deduplicating blocks so each one is hashed at most
+  // once. Use a btree_map because we expect callers to pass sorted indices.
+  std::vector<int64_t> blocks;
+  blocks.reserve(num_indices);
+  absl::btree_map<int64_t, int64_t> block_positions;
+  // Maps each requested index to the position of its block in `blocks` and
+  // its element within the block.
+  std::vector<std::pair<int64_t, int>> index_map;
+  index_map.reserve(num_indices);
+  for (int64_t i = 0; i < num_indices; ++i) {
+    if (indices[i] < 0 || indices[i] >= num_outputs_) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Index %d out of range for this evaluation", indices[i]));
+    }
+    int64_t corrected_index;
+    if (prefix_map_.empty()) {
+      corrected_index = indices[i];
+    } else {
+      const int64_t prefix = indices[i] / outputs_per_prefix_;
+      const int64_t offset = indices[i] % outputs_per_prefix_;
+      corrected_index = prefix_map_[prefix].first * blocks_per_tree_prefix_ *
+                            corrected_elements_per_block_ +
+                        prefix_map_[prefix].second * outputs_per_prefix_ +
+                        offset;
+    }
+    const int64_t block = corrected_index / corrected_elements_per_block_;
+    const int element =
+        static_cast<int>(corrected_index % corrected_elements_per_block_);
+    size_t previous_size = block_positions.size();
+    auto it = block_positions.try_emplace(block_positions.end(), block,
+                                          static_cast<int64_t>(blocks.size()));
+    if (block_positions.size() > previous_size) {
+      blocks.push_back(block);
     }
+    index_map.push_back(std::make_pair(it->second, element));
   }
-  int64_t prefixes_size = static_cast<int64_t>(prefixes.size());
 
-  int log_domain_size = parameters_[hierarchy_level].log_domain_size();
-  if (log_domain_size - previous_log_domain_size > 62) {
+  // Hash only the selected blocks, in a single batch.
+  const auto num_blocks = static_cast<int64_t>(blocks.size());
+  std::vector<absl::uint128> selected_seeds(num_blocks);
+  for (int64_t i = 0; i < num_blocks; ++i) {
+    selected_seeds[i] = expansion_.seeds[blocks[i]];
+  }
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> hashed =
+      hwy::AllocateAligned<absl::uint128>(
+          std::max<int64_t>(num_blocks * blocks_needed_, 1));
+  if (hashed == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  absl::Status status = dpf_->HashExpandedSeedsInto(
+      hierarchy_level_, selected_seeds, hashed.get());
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Correct the requested elements and emit them in input order.
+  std::vector<T> result(num_indices);
+  for (int64_t i = 0; i < num_indices; ++i) {
+    const int64_t position = index_map[i].first;
+    const int element = index_map[i].second;
+    std::array<T, elements_per_block> current_elements =
+        dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+            reinterpret_cast<const char*>(hashed.get() +
+                                          position * blocks_needed_),
+            blocks_needed_ * sizeof(absl::uint128)));
+    T value = current_elements[element];
+    if (expansion_.control_bits[blocks[position]]) {
+      value += correction_ints_[element];
+    }
+    if (negate_) {
+      value = -value;
+    }
+    result[i] = value;
+  }
+  return result;
+}
+
+template <typename T, bool kAccumulate>
+absl::Status DistributedPointFunction::EvaluateUntilImpl(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    const DpfKey& key, int previous_hierarchy_level,
+    absl::FunctionRef<
+        absl::StatusOr<DpfExpansion>(absl::Span<const absl::uint128>)>
+        expand,
+    absl::Span<T> output, EvaluationScratch* scratch) const {
+  absl::Status validation_status = ValidateEvaluateUntilParams(
+      hierarchy_level, prefixes, previous_hierarchy_level);
+  if (!validation_status.ok()) {
+    return validation_status;
+  }
+  absl::StatusOr<bool> types_are_equal = dpf_internal::ValueTypesAreEqual(
+      ToValueType<T>(), parameters_[hierarchy_level].value_type());
+  if (!types_are_equal.ok()) {
+    return types_are_equal.status();
+  } else if (!*types_are_equal) {
     return absl::InvalidArgumentError(
-        "Output size would be larger than 2**62. Please evaluate fewer "
-        "hierarchy levels at once.");
+        "Value type T doesn't match parameters at `hierarchy_level`");
   }
 
-  // The `prefixes` passed in by the caller refer to the domain of the previous
-  // hierarchy level. However, because we batch multiple elements of type T in a
-  // single uint128 block, multiple prefixes can actually refer to the same
-  // block in the FSS evaluation tree. On a high level, our approach is as
-  // follows:
-  //
-  // 1. Split up each element of `prefixes` into a tree index, pointing to a
-  //    block in the FSS tree, and a block index, pointing to an element of type
-  //    T in that block.
-  //
-  // 2. Compute a list of unique `tree_indices`, and for each original prefix,
-  //    remember the position of the corresponding tree index in `tree_indices`.
-  //
-  // 3. After expanding the unique `tree_indices`, use the positions saved in
-  //    Step (2) together with the corresponding block index to retrieve the
-  //    expanded values for each prefix, and return them in the same order as
-  //    `prefixes`.
-  //
-  // `tree_indices` holds the unique tree indices from `prefixes`, to be passed
-  // to `ExpandAndUpdateContext`.
+  int previous_log_domain_size = 0;
+  if (!prefixes.empty()) {
+    DCHECK(previous_hierarchy_level >= 0);
+    previous_log_domain_size =
+        parameters_[previous_hierarchy_level].log_domain_size();
+  }
+  int64_t prefixes_size = static_cast<int64_t>(prefixes.size());
+  int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+
+  // Split `prefixes` into deduplicated `tree_indices` and a `prefix_map` used
+  // to select the outputs for each prefix after the expansion; see
+  // `ComputeTreeIndices`.
   std::vector<absl::uint128> tree_indices;
-  tree_indices.reserve(prefixes_size);
-  // `tree_indices_inverse` is the inverse of `tree_indices`, used for
-  // deduplicating and constructing `prefix_map`. Use a btree_map because we
-  // expect `prefixes` (and thus `tree_indices`) to be sorted.
-  absl::btree_map<absl::uint128, int64_t> tree_indices_inverse;
-  // `prefix_map` maps each i < prefixes.size() to an element of `tree_indices`
-  // and a block index. Used to select which elements to return after the
-  // expansion, to ensure the result is ordered the same way as `prefixes`.
   std::vector<std::pair<int64_t, int>> prefix_map;
-  prefix_map.reserve(prefixes_size);
-  for (int64_t i = 0; i < prefixes_size; ++i) {
-    absl::uint128 tree_index =
-        DomainToTreeIndex(prefixes[i], previous_hierarchy_level);
-    int block_index = DomainToBlockIndex(prefixes[i], previous_hierarchy_level);
-
-    // Check if `tree_index` already exists in `tree_indices`.
-    size_t previous_size = tree_indices_inverse.size();
-    auto it = tree_indices_inverse.try_emplace(tree_indices_inverse.end(),
-                                               tree_index, tree_indices.size());
-    if (tree_indices_inverse.size() > previous_size) {
-      tree_indices.push_back(tree_index);
-    }
-    prefix_map.push_back(std::make_pair(it->second, block_index));
-  }
+  ComputeTreeIndices(prefixes, previous_hierarchy_level, tree_indices,
+                     prefix_map);
 
   // Perform expansion of unique `tree_indices`.
-  absl::StatusOr<DpfExpansion> expansion =
-      ExpandAndUpdateContext(hierarchy_level, tree_indices, ctx);
+  absl::StatusOr<DpfExpansion> expansion = expand(tree_indices);
   if (!expansion.ok()) {
     return expansion.status();
   }
@@ -751,25 +2212,17 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
       static_cast<int64_t>(expansion->control_bits.size());
   auto seeds = absl::MakeConstSpan(expansion->seeds.get(), expansion_size);
 
-  // Hash the expanded seeds.
-  absl::StatusOr<hwy::AlignedFreeUniquePtr<absl::uint128[]>> hashed_expansion =
-      HashExpandedSeeds(hierarchy_level, seeds);
-  if (!hashed_expansion.ok()) {
-    return hashed_expansion.status();
-  }
-
-  // Get output correction word from `ctx`.
+  // Get output correction word from `key`.
   constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
   const ::google::protobuf::RepeatedPtrField<Value>* value_correction = nullptr;
   if (hierarchy_level < static_cast<int>(parameters_.size()) - 1) {
     value_correction =
-        &(ctx.key()
-              .correction_words(hierarchy_to_tree_[hierarchy_level])
+        &(key.correction_words(hierarchy_to_tree_[hierarchy_level])
               .value_correction());
   } else {
     // Last level value correction is stored in an extra proto field, since we
     // have one less correction word than tree levels.
-    value_correction = &(ctx.key().last_level_value_correction());
+    value_correction = &(key.last_level_value_correction());
   }
 
   // Split output correction into elements of type T.
@@ -779,74 +2232,245 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
     return correction_ints.status();
   }
 
+  // Compute the number of outputs we will have. For each prefix, we will have
+  // a full expansion from the previous hierarchy level to the current
+  // hierarchy level.
+  DCHECK(log_domain_size - previous_log_domain_size < 63);
+  int64_t outputs_per_prefix = int64_t{1}
+                               << (log_domain_size - previous_log_domain_size);
+  const int64_t expected_output_size =
+      (prefixes.empty() ? int64_t{1} : prefixes_size) * outputs_per_prefix;
+  if (static_cast<int64_t>(output.size()) != expected_output_size) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`output` must have ", expected_output_size, " elements, but has ",
+        output.size()));
+  }
+
   // Compute value corrections for each block in `expanded_seeds`. We have to
   // account for the fact that blocks might not be full (i.e., have less than
-  // elements_per_block elements).
+  // elements_per_block elements). If `prefixes` is empty, the caller's
+  // `output` holds the full expansion and serves directly as the correction
+  // target, otherwise we correct into a scratch buffer first and select the
+  // requested ranges below.
   const int corrected_elements_per_block =
       1 << (parameters_[hierarchy_level].log_domain_size() -
             hierarchy_to_tree_[hierarchy_level]);
   const int blocks_needed = blocks_needed_[hierarchy_level];
   DCHECK(corrected_elements_per_block <= elements_per_block);
-  std::vector<T> corrected_expansion(expansion_size *
-                                     corrected_elements_per_block);
-  for (int64_t i = 0; i < expansion_size; ++i) {
-    std::array<T, elements_per_block> current_elements =
-        dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
-            reinterpret_cast<const char*>(hashed_expansion->get() +
-                                          i * blocks_needed),
-            blocks_needed * sizeof(absl::uint128)));
-    for (int j = 0; j < corrected_elements_per_block; ++j) {
-      if (expansion->control_bits[i]) {
-        current_elements[j] += (*correction_ints)[j];
+  std::vector<T> corrected_expansion_scratch;
+  absl::Span<T> corrected_expansion;
+  if (prefixes.empty()) {
+    DCHECK(expansion_size * corrected_elements_per_block ==
+           expected_output_size);
+    corrected_expansion = output;
+  } else {
+    corrected_expansion_scratch.resize(expansion_size *
+                                       corrected_elements_per_block);
+    corrected_expansion = absl::MakeSpan(corrected_expansion_scratch);
+  }
+  // When accumulating and correcting directly into the caller's buffer, the
+  // final stores below become `+=` instead of `=`. With prefixes, the
+  // correction still overwrites the scratch buffer, and the accumulation
+  // happens in the prefix selection loop at the end.
+  const bool accumulate_in_place = kAccumulate && prefixes.empty();
+  // Corrects the blocks `[begin, end)`, whose hashes start at `hashed`.
+  // `begin` must be a multiple of `PackedControlBits::kBitsPerWord`, so the
+  // vectorized kernel can read the control bits of the chunk at word
+  // granularity.
+  auto correct_chunk = [this, &expansion, &correction_ints, &key,
+                        &corrected_expansion, corrected_elements_per_block,
+                        blocks_needed,
+                        accumulate_in_place](int64_t begin, int64_t end,
+                                             const absl::uint128* hashed) {
+    bool corrected = false;
+    if (dpf_internal::is_xor_wrapper_v<T> &&
+        corrected_elements_per_block == elements_per_block &&
+        blocks_needed == 1) {
+      // XOR-sharing fast path: negation is the identity under XOR, so the
+      // correction for both parties reduces to XORing whole 128-bit blocks,
+      // independently of the element width. Unlike the arithmetic kernel
+      // below, this also fuses XOR-accumulation into the caller's buffer.
+      corrected = dpf_internal::ApplyXorValueCorrection(
+          end - begin, hashed,
+          expansion->control_bits.words() +
+              begin / dpf_internal::PackedControlBits::kBitsPerWord,
+          reinterpret_cast<const uint64_t*>(correction_ints->data()),
+          /*accumulate=*/accumulate_in_place,
+          reinterpret_cast<uint64_t*>(corrected_expansion.data() +
+                                      begin * elements_per_block));
+    }
+    if (!corrected && !accumulate_in_place &&
+        dpf_internal::has_vectorized_value_correction_v<T> &&
+        corrected_elements_per_block == elements_per_block &&
+        blocks_needed == 1) {
+      // Fast path: for unsigned integer outputs with full blocks, the
+      // correction is a pure streaming pass and is applied with vector
+      // loads/stores across whole blocks.
+      corrected = dpf_internal::TryApplyValueCorrection(
+          end - begin, hashed,
+          expansion->control_bits.words() +
+              begin / dpf_internal::PackedControlBits::kBitsPerWord,
+          correction_ints->data(),
+          /*negate=*/key.party() == 1,
+          corrected_expansion.data() + begin * elements_per_block);
+    }
+    if (!corrected && corrected_elements_per_block == elements_per_block &&
+        blocks_needed == 1) {
+      // All blocks are full and fit in a single 128-bit block, so all loop
+      // bounds and offsets below are compile-time constants. This lets the
+      // compiler fully unroll the inner loop, which also covers types the
+      // vectorized kernel above doesn't support (e.g. tuples and 128-bit
+      // integers).
+      for (int64_t i = begin; i < end; ++i) {
+        std::array<T, elements_per_block> current_elements =
+            dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+                reinterpret_cast<const char*>(hashed + (i - begin)),
+                sizeof(absl::uint128)));
+        for (int j = 0; j < elements_per_block; ++j) {
+          if (expansion->control_bits[i]) {
+            current_elements[j] += (*correction_ints)[j];
+          }
+          if (key.party() == 1) {
+            current_elements[j] = -current_elements[j];
+          }
+          if (accumulate_in_place) {
+            corrected_expansion[i * elements_per_block + j] +=
+                current_elements[j];
+          } else {
+            corrected_expansion[i * elements_per_block + j] =
+                current_elements[j];
+          }
+        }
       }
-      if (ctx.key().party() == 1) {
-        current_elements[j] = -current_elements[j];
+      corrected = true;
+    }
+    if (!corrected) {
+      for (int64_t i = begin; i < end; ++i) {
+        std::array<T, elements_per_block> current_elements =
+            dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+                reinterpret_cast<const char*>(hashed +
+                                              (i - begin) * blocks_needed),
+                blocks_needed * sizeof(absl::uint128)));
+        for (int j = 0; j < corrected_elements_per_block; ++j) {
+          if (expansion->control_bits[i]) {
+            current_elements[j] += (*correction_ints)[j];
+          }
+          if (key.party() == 1) {
+            current_elements[j] = -current_elements[j];
+          }
+          if (accumulate_in_place) {
+            corrected_expansion[i * corrected_elements_per_block + j] +=
+                current_elements[j];
+          } else {
+            corrected_expansion[i * corrected_elements_per_block + j] =
+                current_elements[j];
+          }
+        }
       }
-      corrected_expansion[i * corrected_elements_per_block + j] =
-          current_elements[j];
     }
-  }
-
-  // Compute the number of outputs we will have. For each prefix, we will have a
-  // full expansion from the previous heirarchy level to the current heirarchy
-  // level.
-  DCHECK(log_domain_size - previous_log_domain_size < 63);
-  int64_t outputs_per_prefix = int64_t{1}
-                               << (log_domain_size - previous_log_domain_size);
+  };
 
-  if (prefixes.empty()) {
-    // If prefixes is empty (i.e., this is the first evaluation of `ctx`), just
-    // return the expansion.
-    DCHECK(static_cast<int>(corrected_expansion.size()) == outputs_per_prefix);
-    return corrected_expansion;
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  EvaluationStats* stats = GetEvaluationStatsSink();
+  const int64_t stats_start_nanos =
+      stats != nullptr ? dpf_internal::EvaluationStatsNowNanos() : 0;
+#endif
+  // Number of seeds per pipeline chunk. For multi-block value types, this is
+  // scaled down so a chunk's hashed blocks stay L2-sized independently of
+  // `blocks_needed`, rounded down to a multiple of
+  // `PackedControlBits::kBitsPerWord` to keep the chunk starts word-aligned.
+  const int64_t chunk_seeds =
+      std::max(int64_t{dpf_internal::PackedControlBits::kBitsPerWord},
+               kPipelineChunkBlocks / blocks_needed /
+                   dpf_internal::PackedControlBits::kBitsPerWord *
+                   dpf_internal::PackedControlBits::kBitsPerWord);
+  if (expansion_size >= 2 * chunk_seeds) {
+    // Pipelined path for large expansions: instead of hashing the whole
+    // expansion and then sweeping the full hashed buffer again for the
+    // correction, hash and correct in chunks that fit in cache, with a helper
+    // thread hashing chunk k+1 while this thread corrects chunk k. This
+    // overlaps the AES evaluations with the correction arithmetic and avoids
+    // materializing the full hashed expansion.
+    absl::Status status = PipelineHashAndCorrect(
+        expansion_size, chunk_seeds, chunk_seeds * blocks_needed,
+        [this, hierarchy_level, seeds](int64_t begin, int64_t end,
+                                       absl::uint128* hashed) {
+          return HashExpandedSeedsInto(
+              hierarchy_level, seeds.subspan(begin, end - begin), hashed);
+        },
+        correct_chunk);
+    if (!status.ok()) {
+      return status;
+    }
   } else {
-    // Otherwise, only return elements under `prefixes`.
+    // Hash the expanded seeds, then correct them in a single pass.
+    absl::StatusOr<EvaluationScratch::Buffer> hashed_expansion =
+        HashExpandedSeeds(hierarchy_level, seeds, scratch);
+    if (!hashed_expansion.ok()) {
+      return hashed_expansion.status();
+    }
+    correct_chunk(0, expansion_size, hashed_expansion->data.get());
+    RecycleBuffer(std::move(hashed_expansion->data),
+                  hashed_expansion->capacity, scratch);
+  }
+#ifdef DPF_ENABLE_EVALUATION_STATS
+  if (stats != nullptr) {
+    // In the pipelined branch this covers the fused hash-and-correct stage;
+    // `hash_nanos` then only accounts for the chunks hashed on this thread.
+    stats->correct_nanos +=
+        dpf_internal::EvaluationStatsNowNanos() - stats_start_nanos;
+  }
+#endif
+
+  if (!prefixes.empty()) {
+    // Only return elements under `prefixes`. If `prefixes` is empty (i.e.,
+    // this is the first evaluation of `ctx`), the expansion was already
+    // corrected directly into `output` above.
     int blocks_per_tree_prefix =
         expansion->control_bits.size() / tree_indices.size();
-    std::vector<T> result(prefixes_size * outputs_per_prefix);
     for (int64_t i = 0; i < prefixes_size; ++i) {
       int64_t prefix_expansion_start =
           prefix_map[i].first * blocks_per_tree_prefix *
               corrected_elements_per_block +
           prefix_map[i].second * outputs_per_prefix;
-      std::copy_n(&corrected_expansion[prefix_expansion_start],
-                  outputs_per_prefix, &result[i * outputs_per_prefix]);
+      if (kAccumulate) {
+        for (int64_t j = 0; j < outputs_per_prefix; ++j) {
+          output[i * outputs_per_prefix + j] +=
+              corrected_expansion[prefix_expansion_start + j];
+        }
+      } else {
+        std::copy_n(&corrected_expansion[prefix_expansion_start],
+                    outputs_per_prefix, &output[i * outputs_per_prefix]);
+      }
     }
-    return result;
   }
+
+  // Recycle the large intermediate buffer for the next call.
+  RecycleBuffer(std::move(expansion->seeds), expansion->seeds_capacity,
+                scratch);
+  return absl::OkStatus();
 }
 
 template <typename T>
 absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
     const DpfKey& key, int hierarchy_level,
-    absl::Span<const absl::uint128> evaluation_points,
-    EvaluationContext* ctx) const {
+    absl::Span<const absl::uint128> evaluation_points, EvaluationContext* ctx,
+    const CompiledDpfKey* compiled_key, EvaluationScratch* scratch,
+    bool key_is_validated, absl::Span<T> accumulator,
+    const PrecomputedEvaluationPoints* precomputed) const {
+  const bool accumulate = !accumulator.empty();
+  DCHECK(!accumulate || accumulator.size() == evaluation_points.size());
+  DCHECK(precomputed == nullptr ||
+         (precomputed->hierarchy_level_ == hierarchy_level &&
+          precomputed->size() ==
+              static_cast<int64_t>(evaluation_points.size())));
   if (ctx != nullptr) {
     if (&key != &ctx->key()) {
       return absl::InvalidArgumentError(
           "`key` and `ctx->key()` must refer to the same object");
     }
   }
+  DCHECK(compiled_key == nullptr || &key == &compiled_key->key());
   if (hierarchy_level < 0) {
     return absl::InvalidArgumentError("`hierarchy_level` must be non-negative");
   }
@@ -863,18 +2487,26 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
     max_evaluation_point = (absl::uint128{1} << log_domain_size) - 1;
   }
   // Check if `evaluation_points` are inside the domain. This has minimal (~ 1%)
-  // performance impact.
-  for (int64_t i = 0; i < num_evaluation_points; ++i) {
-    if (evaluation_points[i] > max_evaluation_point) {
-      return absl::InvalidArgumentError(
-          absl::StrCat("`evaluation_points[", i,
-                       "]` larger than the domain size at hierarchy level ",
-                       hierarchy_level));
+  // performance impact. Precomputed points were already checked in
+  // `PrecomputeEvaluationPoints`.
+  if (precomputed == nullptr) {
+    for (int64_t i = 0; i < num_evaluation_points; ++i) {
+      if (evaluation_points[i] > max_evaluation_point) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("`evaluation_points[", i,
+                         "]` larger than the domain size at hierarchy level ",
+                         hierarchy_level));
+      }
     }
   }
-  absl::Status status = proto_validator_->ValidateDpfKey(key);
-  if (!status.ok()) {
-    return status;
+  absl::Status status = absl::OkStatus();
+  if (compiled_key == nullptr && !key_is_validated) {
+    // Compiled keys were already validated by `CompileDpfKey`, and validated
+    // keys by `ValidateKey`.
+    status = proto_validator_->ValidateDpfKey(key);
+    if (!status.ok()) {
+      return status;
+    }
   }
   if (num_evaluation_points == 0) {
     return std::vector<T>{};  // Nothing to do.
@@ -906,15 +2538,25 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   // `evaluation_points`.
   hwy::AlignedFreeUniquePtr<absl::uint128[]> maybe_recomputed_tree_indices;
   absl::Span<const absl::uint128> tree_indices;
-  if (elements_per_block > 1) {
+  if (precomputed != nullptr) {
+    // Indices were translated once in `PrecomputeEvaluationPoints`.
+    tree_indices = absl::MakeConstSpan(precomputed->tree_indices_.get(),
+                                       num_evaluation_points);
+  } else if (elements_per_block > 1) {
     maybe_recomputed_tree_indices =
         hwy::AllocateAligned<absl::uint128>(num_evaluation_points);
     if (maybe_recomputed_tree_indices == nullptr) {
       return absl::ResourceExhaustedError("Memory allocation error");
     }
-    for (int64_t i = 0; i < num_evaluation_points; ++i) {
-      maybe_recomputed_tree_indices[i] =
-          DomainToTreeIndex(evaluation_points[i], hierarchy_level);
+    if (!dpf_internal::DomainToTreeAndBlockIndices(
+            num_evaluation_points, evaluation_points.data(),
+            parameters_[hierarchy_level].log_domain_size() -
+                hierarchy_to_tree_[hierarchy_level],
+            maybe_recomputed_tree_indices.get(), /*block_indices=*/nullptr)) {
+      for (int64_t i = 0; i < num_evaluation_points; ++i) {
+        maybe_recomputed_tree_indices[i] =
+            DomainToTreeIndex(evaluation_points[i], hierarchy_level);
+      }
     }
     tree_indices = absl::MakeConstSpan(maybe_recomputed_tree_indices.get(),
                                        num_evaluation_points);
@@ -931,17 +2573,26 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   int start_level = 0;
   if (!ctx) {
     // No context or context was never evaluated -> start from the beginning.
-    absl::uint128 seed = absl::MakeUint128(key.seed().high(), key.seed().low());
-    bool party = key.party();
-    selected_partial_evaluations->seeds =
-        hwy::AllocateAligned<absl::uint128>(num_evaluation_points);
-    if (selected_partial_evaluations->seeds == nullptr) {
-      return absl::ResourceExhaustedError("Memory allocation error");
+    absl::uint128 seed;
+    bool party;
+    if (compiled_key != nullptr) {
+      seed = compiled_key->seed_;
+      party = compiled_key->party_;
+    } else {
+      seed = absl::MakeUint128(key.seed().high(), key.seed().low());
+      party = key.party();
     }
+    absl::StatusOr<EvaluationScratch::Buffer> buffer =
+        AcquireBuffer(num_evaluation_points, scratch);
+    if (!buffer.ok()) {
+      return buffer.status();
+    }
+    selected_partial_evaluations->seeds = std::move(buffer->data);
+    selected_partial_evaluations->seeds_capacity = buffer->capacity;
     auto seeds = absl::MakeSpan(selected_partial_evaluations->seeds.get(),
                                 num_evaluation_points);
     std::fill(seeds.begin(), seeds.end(), seed);
-    selected_partial_evaluations->control_bits.resize(num_evaluation_points,
+    selected_partial_evaluations->control_bits.Resize(num_evaluation_points,
                                                       party);
   } else {
     // We have a context -> Use it to compute partial evaluations. Always update
@@ -949,7 +2600,7 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
     // will always be `tree_indices.size()` and should therefore be negligible.
     selected_partial_evaluations =
         ComputePartialEvaluations(tree_indices, hierarchy_level,
-                                  /*update_ctx=*/true, *ctx);
+                                  /*update_ctx=*/true, *ctx, scratch);
     if (!selected_partial_evaluations.ok()) {
       return selected_partial_evaluations.status();
     }
@@ -961,44 +2612,99 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   absl::Span<absl::uint128> seeds(
       selected_partial_evaluations->seeds.get(),
       selected_partial_evaluations->control_bits.size());
-  auto correction_words = absl::MakeConstSpan(key.correction_words())
-                              .subspan(start_level, stop_level - start_level);
-  status =
-      EvaluateSeeds(seeds, selected_partial_evaluations->control_bits,
-                    tree_indices, correction_words, seeds,
-                    absl::MakeSpan(selected_partial_evaluations->control_bits));
+  if (compiled_key != nullptr) {
+    // Read correction words from the compiled key's flat arrays.
+    status = EvaluateSeeds(seeds, selected_partial_evaluations->control_bits,
+                           tree_indices, *compiled_key, start_level,
+                           stop_level - start_level, seeds,
+                           selected_partial_evaluations->control_bits);
+  } else {
+    auto correction_words = absl::MakeConstSpan(key.correction_words())
+                                .subspan(start_level, stop_level - start_level);
+    status = EvaluateSeeds(seeds, selected_partial_evaluations->control_bits,
+                           tree_indices, correction_words, seeds,
+                           selected_partial_evaluations->control_bits);
+  }
   if (!status.ok()) {
     return status;
   }
   DCHECK(static_cast<int64_t>(seeds.size()) == num_evaluation_points);
 
   // Hash DPF evaluations.
-  absl::StatusOr<hwy::AlignedFreeUniquePtr<absl::uint128[]>> hashed_expansion =
-      HashExpandedSeeds(hierarchy_level, seeds);
+  absl::StatusOr<EvaluationScratch::Buffer> hashed_expansion =
+      HashExpandedSeeds(hierarchy_level, seeds, scratch);
   if (!hashed_expansion.ok()) {
     return hashed_expansion.status();
   }
 
   // Perform value correction.
   std::vector<T> result;
-  result.reserve(num_evaluation_points);
   const int blocks_needed = blocks_needed_[hierarchy_level];
-  for (int64_t i = 0; i < num_evaluation_points; ++i) {
-    std::array<T, elements_per_block> current_elements =
-        dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
-            reinterpret_cast<const char*>(hashed_expansion->get() +
-                                          i * blocks_needed),
-            blocks_needed * sizeof(absl::uint128)));
-    int block_index = 0;
-    if (elements_per_block > 1) {
-      block_index = DomainToBlockIndex(evaluation_points[i], hierarchy_level);
+  bool corrected = false;
+  if (!accumulate && dpf_internal::has_vectorized_value_correction_v<T> &&
+      blocks_needed == 1) {
+    // Fast path: for unsigned integer outputs, read each selected element
+    // directly from its hashed block instead of materializing all elements
+    // of the block.
+    const int* block_indices;
+    std::vector<int> recomputed_block_indices;
+    if (precomputed != nullptr) {
+      block_indices = precomputed->block_indices_.data();
+    } else {
+      recomputed_block_indices.assign(num_evaluation_points, 0);
+      if (elements_per_block > 1 &&
+          !dpf_internal::DomainToTreeAndBlockIndices(
+              num_evaluation_points, evaluation_points.data(),
+              parameters_[hierarchy_level].log_domain_size() -
+                  hierarchy_to_tree_[hierarchy_level],
+              /*tree_indices=*/nullptr, recomputed_block_indices.data())) {
+        for (int64_t i = 0; i < num_evaluation_points; ++i) {
+          recomputed_block_indices[i] =
+              DomainToBlockIndex(evaluation_points[i], hierarchy_level);
+        }
+      }
+      block_indices = recomputed_block_indices.data();
     }
-    result.push_back(current_elements[block_index]);
-    if (selected_partial_evaluations->control_bits[i]) {
-      result[i] += (*correction_ints)[block_index];
+    result.resize(num_evaluation_points);
+    corrected = dpf_internal::TryApplyValueCorrectionSelected(
+        num_evaluation_points, hashed_expansion->data.get(),
+        selected_partial_evaluations->control_bits.words(), block_indices,
+        correction_ints->data(),
+        /*negate=*/key.party() == 1, result.data());
+    if (!corrected) {
+      result.clear();
     }
-    if (key.party() == 1) {
-      result[i] = -result[i];
+  }
+  if (!corrected) {
+    if (!accumulate) {
+      result.reserve(num_evaluation_points);
+    }
+    for (int64_t i = 0; i < num_evaluation_points; ++i) {
+      std::array<T, elements_per_block> current_elements =
+          dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+              reinterpret_cast<const char*>(hashed_expansion->data.get() +
+                                            i * blocks_needed),
+              blocks_needed * sizeof(absl::uint128)));
+      int block_index = 0;
+      if (precomputed != nullptr) {
+        block_index = precomputed->block_indices_[i];
+      } else if (elements_per_block > 1) {
+        block_index = DomainToBlockIndex(evaluation_points[i], hierarchy_level);
+      }
+      T value = current_elements[block_index];
+      if (selected_partial_evaluations->control_bits[i]) {
+        value += (*correction_ints)[block_index];
+      }
+      if (key.party() == 1) {
+        value = -value;
+      }
+      if (accumulate) {
+        // Fuse the correction with the aggregation into the caller's
+        // accumulator, instead of materializing a result vector.
+        accumulator[i] += value;
+      } else {
+        result.push_back(value);
+      }
     }
   }
 
@@ -1006,6 +2712,461 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
     ctx->set_previous_hierarchy_level(hierarchy_level);
   }
 
+  // Recycle the intermediate buffers for the next call.
+  RecycleBuffer(std::move(selected_partial_evaluations->seeds),
+                selected_partial_evaluations->seeds_capacity, scratch);
+  RecycleBuffer(std::move(hashed_expansion->data), hashed_expansion->capacity,
+                scratch);
+  return result;
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtBatchImpl(
+    absl::Span<const DpfKey* const> keys, int hierarchy_level,
+    absl::Span<const absl::uint128> evaluation_points,
+    const PrecomputedEvaluationPoints* precomputed) const {
+  DCHECK(precomputed == nullptr ||
+         (precomputed->hierarchy_level_ == hierarchy_level &&
+          precomputed->size() ==
+              static_cast<int64_t>(evaluation_points.size())));
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  const auto num_keys = static_cast<int64_t>(keys.size());
+  const auto num_evaluation_points =
+      static_cast<int64_t>(evaluation_points.size());
+  if (precomputed == nullptr) {
+    // Precomputed points were already checked in
+    // `PrecomputeEvaluationPoints`.
+    const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+    absl::uint128 max_evaluation_point = absl::Uint128Max();
+    if (log_domain_size < 128) {
+      max_evaluation_point = (absl::uint128{1} << log_domain_size) - 1;
+    }
+    for (int64_t i = 0; i < num_evaluation_points; ++i) {
+      if (evaluation_points[i] > max_evaluation_point) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("`evaluation_points[", i,
+                         "]` larger than the domain size at hierarchy level ",
+                         hierarchy_level));
+      }
+    }
+  }
+  for (int64_t i = 0; i < num_keys; ++i) {
+    if (keys[i] == nullptr) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("`keys[", i, "]` must not be NULL"));
+    }
+    absl::Status status = proto_validator_->ValidateDpfKey(*keys[i]);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (num_keys == 0 || num_evaluation_points == 0) {
+    return std::vector<T>{};  // Nothing to do.
+  }
+
+  // Translate `evaluation_points` to tree and block indices once, shared
+  // across all keys.
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> maybe_recomputed_tree_indices;
+  absl::Span<const absl::uint128> tree_indices;
+  const int* block_indices = nullptr;
+  std::vector<int> recomputed_block_indices;
+  if (precomputed != nullptr) {
+    // Indices were translated once in `PrecomputeEvaluationPoints`.
+    tree_indices = absl::MakeConstSpan(precomputed->tree_indices_.get(),
+                                       num_evaluation_points);
+    block_indices = precomputed->block_indices_.data();
+  } else if (elements_per_block > 1) {
+    maybe_recomputed_tree_indices =
+        hwy::AllocateAligned<absl::uint128>(num_evaluation_points);
+    if (maybe_recomputed_tree_indices == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    recomputed_block_indices.resize(num_evaluation_points);
+    if (!dpf_internal::DomainToTreeAndBlockIndices(
+            num_evaluation_points, evaluation_points.data(),
+            parameters_[hierarchy_level].log_domain_size() -
+                hierarchy_to_tree_[hierarchy_level],
+            maybe_recomputed_tree_indices.get(),
+            recomputed_block_indices.data())) {
+      for (int64_t i = 0; i < num_evaluation_points; ++i) {
+        maybe_recomputed_tree_indices[i] =
+            DomainToTreeIndex(evaluation_points[i], hierarchy_level);
+        recomputed_block_indices[i] =
+            DomainToBlockIndex(evaluation_points[i], hierarchy_level);
+      }
+    }
+    tree_indices = absl::MakeConstSpan(maybe_recomputed_tree_indices.get(),
+                                       num_evaluation_points);
+    block_indices = recomputed_block_indices.data();
+  } else {
+    tree_indices = evaluation_points;
+  }
+
+  // Evaluate each key's seeds into its slice of one shared aligned buffer.
+  // The correction words differ per key, so `EvaluateSeeds` runs once per
+  // key, but each call already operates on all evaluation points.
+  const int stop_level = hierarchy_to_tree_[hierarchy_level];
+  const int64_t num_seeds = num_keys * num_evaluation_points;
+  auto seed_buffer = hwy::AllocateAligned<absl::uint128>(num_seeds);
+  if (seed_buffer == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  BitVector control_bits(num_seeds);
+  for (int64_t i = 0; i < num_keys; ++i) {
+    const DpfKey& key = *keys[i];
+    absl::Span<absl::uint128> seeds(
+        seed_buffer.get() + i * num_evaluation_points, num_evaluation_points);
+    std::fill(seeds.begin(), seeds.end(),
+              absl::MakeUint128(key.seed().high(), key.seed().low()));
+    absl::Span<bool> key_control_bits(
+        control_bits.data() + i * num_evaluation_points, num_evaluation_points);
+    std::fill(key_control_bits.begin(), key_control_bits.end(),
+              static_cast<bool>(key.party()));
+    absl::Status status = EvaluateSeeds(
+        seeds, key_control_bits, tree_indices,
+        absl::MakeConstSpan(key.correction_words()).subspan(0, stop_level),
+        seeds, key_control_bits);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  // Hash the seed evaluations of all keys in a single batch.
+  absl::StatusOr<EvaluationScratch::Buffer> hashed_expansion =
+      HashExpandedSeeds(hierarchy_level,
+                        absl::MakeConstSpan(seed_buffer.get(), num_seeds));
+  if (!hashed_expansion.ok()) {
+    return hashed_expansion.status();
+  }
+
+  // Perform value correction with each key's correction word.
+  std::vector<T> result;
+  result.reserve(num_seeds);
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+  for (int64_t i = 0; i < num_keys; ++i) {
+    const DpfKey& key = *keys[i];
+    const ::google::protobuf::RepeatedPtrField<Value>* value_correction =
+        nullptr;
+    if (hierarchy_level < static_cast<int>(parameters_.size()) - 1) {
+      value_correction =
+          &(key.correction_words(hierarchy_to_tree_[hierarchy_level])
+                .value_correction());
+    } else {
+      value_correction = &(key.last_level_value_correction());
+    }
+    absl::StatusOr<std::array<T, elements_per_block>> correction_ints =
+        dpf_internal::ValuesToArray<T>(*value_correction);
+    if (!correction_ints.ok()) {
+      return correction_ints.status();
+    }
+    for (int64_t j = 0; j < num_evaluation_points; ++j) {
+      const int64_t seed_index = i * num_evaluation_points + j;
+      std::array<T, elements_per_block> current_elements =
+          dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+              reinterpret_cast<const char*>(hashed_expansion->data.get() +
+                                            seed_index * blocks_needed),
+              blocks_needed * sizeof(absl::uint128)));
+      int block_index = 0;
+      if (block_indices != nullptr) {
+        block_index = block_indices[j];
+      }
+      T current_element = current_elements[block_index];
+      if (control_bits[seed_index]) {
+        current_element += (*correction_ints)[block_index];
+      }
+      if (key.party() == 1) {
+        current_element = -current_element;
+      }
+      result.push_back(current_element);
+    }
+  }
+  return result;
+}
+
+template <typename T>
+absl::Status DistributedPointFunction::EvaluateFullDomainStreaming(
+    const DpfKey& key, int hierarchy_level, int log_chunk_size,
+    absl::FunctionRef<absl::Status(absl::Span<const T>, absl::uint128)>
+        callback) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  if (log_chunk_size < 0 || log_chunk_size > 62) {
+    return absl::InvalidArgumentError(
+        "`log_chunk_size` must be between 0 and 62");
+  }
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  absl::StatusOr<bool> types_are_equal = dpf_internal::ValueTypesAreEqual(
+      ToValueType<T>(), parameters_[hierarchy_level].value_type());
+  if (!types_are_equal.ok()) {
+    return types_are_equal.status();
+  } else if (!*types_are_equal) {
+    return absl::InvalidArgumentError(
+        "Value type T doesn't match parameters at `hierarchy_level`");
+  }
+
+  // Each tree leaf at `hierarchy_level` holds 2**block_index_bits packed
+  // outputs, so chunks cannot be smaller than a single block. The roots of
+  // the chunk subtrees live `chunk_tree_levels` levels above the leaves.
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  const int stop_level = hierarchy_to_tree_[hierarchy_level];
+  const int block_index_bits = log_domain_size - stop_level;
+  const int effective_log_chunk_size =
+      std::min(std::max(log_chunk_size, block_index_bits), log_domain_size);
+  const int chunk_tree_levels = effective_log_chunk_size - block_index_bits;
+  const int chunk_root_level = stop_level - chunk_tree_levels;
+  if (chunk_root_level > 62) {
+    return absl::InvalidArgumentError(
+        "The number of chunks would be larger than 2**62. Please increase "
+        "`log_chunk_size`.");
+  }
+  const int64_t num_chunks = int64_t{1} << chunk_root_level;
+  const int64_t chunk_size = int64_t{1} << effective_log_chunk_size;
+
+  // Parse the output correction from `key` once.
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  const ::google::protobuf::RepeatedPtrField<Value>* value_correction = nullptr;
+  if (hierarchy_level < static_cast<int>(parameters_.size()) - 1) {
+    value_correction =
+        &(key.correction_words(hierarchy_to_tree_[hierarchy_level])
+              .value_correction());
+  } else {
+    value_correction = &(key.last_level_value_correction());
+  }
+  absl::StatusOr<std::array<T, elements_per_block>> correction_ints =
+      dpf_internal::ValuesToArray<T>(*value_correction);
+  if (!correction_ints.ok()) {
+    return correction_ints.status();
+  }
+  const int corrected_elements_per_block = 1 << block_index_bits;
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+  DCHECK(corrected_elements_per_block <= elements_per_block);
+
+  // Process chunk roots in batches, so the descent to the roots also runs on
+  // full AES batches. For each root, the chunk's subtree is then expanded,
+  // hashed, and corrected into `chunk_buffer`, which is reused across chunks.
+  constexpr int64_t kRootBatchSize = Aes128FixedKeyHash::kBatchSize;
+  auto root_seeds = hwy::AllocateAligned<absl::uint128>(kRootBatchSize);
+  auto root_paths = hwy::AllocateAligned<absl::uint128>(kRootBatchSize);
+  if (root_seeds == nullptr || root_paths == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  BitVector root_control_bits(kRootBatchSize);
+  const absl::uint128 key_seed =
+      absl::MakeUint128(key.seed().high(), key.seed().low());
+  const bool party = key.party();
+  auto root_correction_words = absl::MakeConstSpan(key.correction_words())
+                                   .subspan(0, chunk_root_level);
+  auto chunk_correction_words =
+      absl::MakeConstSpan(key.correction_words())
+          .subspan(chunk_root_level, chunk_tree_levels);
+  std::vector<T> chunk_buffer(chunk_size);
+  for (int64_t batch_start = 0; batch_start < num_chunks;
+       batch_start += kRootBatchSize) {
+    const int64_t batch_size =
+        std::min<int64_t>(num_chunks - batch_start, kRootBatchSize);
+    absl::Span<absl::uint128> seeds(root_seeds.get(), batch_size);
+    absl::Span<bool> control_bits(root_control_bits.data(), batch_size);
+    std::fill(seeds.begin(), seeds.end(), key_seed);
+    std::fill(control_bits.begin(), control_bits.end(), party);
+    for (int64_t i = 0; i < batch_size; ++i) {
+      root_paths[i] = static_cast<uint64_t>(batch_start + i);
+    }
+    DPF_RETURN_IF_ERROR(EvaluateSeeds(
+        seeds, control_bits, absl::MakeConstSpan(root_paths.get(), batch_size),
+        root_correction_words, seeds, control_bits));
+
+    for (int64_t i = 0; i < batch_size; ++i) {
+      DpfExpansion chunk_root;
+      chunk_root.seeds = hwy::AllocateAligned<absl::uint128>(1);
+      if (chunk_root.seeds == nullptr) {
+        return absl::ResourceExhaustedError("Memory allocation error");
+      }
+      chunk_root.seeds[0] = seeds[i];
+      chunk_root.control_bits.PushBack(control_bits[i]);
+      DPF_ASSIGN_OR_RETURN(DpfExpansion expansion,
+                           ExpandSeeds(chunk_root, chunk_correction_words));
+      const auto expansion_size =
+          static_cast<int64_t>(expansion.control_bits.size());
+      absl::StatusOr<EvaluationScratch::Buffer> hashed_expansion =
+          HashExpandedSeeds(
+              hierarchy_level,
+              absl::MakeConstSpan(expansion.seeds.get(), expansion_size));
+      if (!hashed_expansion.ok()) {
+        return hashed_expansion.status();
+      }
+      for (int64_t j = 0; j < expansion_size; ++j) {
+        std::array<T, elements_per_block> current_elements =
+            dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+                reinterpret_cast<const char*>(hashed_expansion->data.get() +
+                                              j * blocks_needed),
+                blocks_needed * sizeof(absl::uint128)));
+        for (int k = 0; k < corrected_elements_per_block; ++k) {
+          if (expansion.control_bits[j]) {
+            current_elements[k] += (*correction_ints)[k];
+          }
+          if (party) {
+            current_elements[k] = -current_elements[k];
+          }
+          chunk_buffer[j * corrected_elements_per_block + k] =
+              current_elements[k];
+        }
+      }
+      const absl::uint128 chunk_start =
+          absl::uint128{static_cast<uint64_t>(batch_start + i)}
+          << effective_log_chunk_size;
+      DPF_RETURN_IF_ERROR(callback(absl::MakeConstSpan(chunk_buffer),
+                                   chunk_start));
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateRange(
+    const DpfKey& key, int hierarchy_level, absl::uint128 start,
+    absl::uint128 end) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  if (start >= end) {
+    return absl::InvalidArgumentError("`start` must be less than `end`");
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  if (log_domain_size < 128 && end > (absl::uint128{1} << log_domain_size)) {
+    return absl::InvalidArgumentError(
+        "`end` larger than the domain size at `hierarchy_level`");
+  }
+  if (end - start > (absl::uint128{1} << 62)) {
+    return absl::InvalidArgumentError(
+        "The range must not contain more than 2**62 indices");
+  }
+  DPF_RETURN_IF_ERROR(proto_validator_->ValidateDpfKey(key));
+  absl::StatusOr<bool> types_are_equal = dpf_internal::ValueTypesAreEqual(
+      ToValueType<T>(), parameters_[hierarchy_level].value_type());
+  if (!types_are_equal.ok()) {
+    return types_are_equal.status();
+  } else if (!*types_are_equal) {
+    return absl::InvalidArgumentError(
+        "Value type T doesn't match parameters at `hierarchy_level`");
+  }
+
+  // Parse the output correction from `key` once.
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  const ::google::protobuf::RepeatedPtrField<Value>* value_correction = nullptr;
+  if (hierarchy_level < static_cast<int>(parameters_.size()) - 1) {
+    value_correction =
+        &(key.correction_words(hierarchy_to_tree_[hierarchy_level])
+              .value_correction());
+  } else {
+    value_correction = &(key.last_level_value_correction());
+  }
+  absl::StatusOr<std::array<T, elements_per_block>> correction_ints =
+      dpf_internal::ValuesToArray<T>(*value_correction);
+  if (!correction_ints.ok()) {
+    return correction_ints.status();
+  }
+
+  const int stop_level = hierarchy_to_tree_[hierarchy_level];
+  const int block_index_bits = log_domain_size - stop_level;
+  const int corrected_elements_per_block = 1 << block_index_bits;
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+  const absl::uint128 key_seed =
+      absl::MakeUint128(key.seed().high(), key.seed().low());
+  const bool party = key.party();
+  std::vector<T> result(static_cast<int64_t>(end - start));
+
+  // Decompose the tree leaves covering [start, end) into maximal aligned
+  // subtrees. Each iteration handles the largest subtree that starts at
+  // `current_leaf` and stays within the range; there are at most
+  // 2 * stop_level such subtrees.
+  const absl::uint128 first_leaf = start >> block_index_bits;
+  const absl::uint128 last_leaf = (end - 1) >> block_index_bits;
+  absl::uint128 current_leaf = first_leaf;
+  while (true) {
+    int subtree_levels = 0;
+    while (subtree_levels < stop_level &&
+           (current_leaf & ((absl::uint128{1} << (subtree_levels + 1)) - 1)) ==
+               0 &&
+           current_leaf + (absl::uint128{1} << (subtree_levels + 1)) - 1 <=
+               last_leaf) {
+      ++subtree_levels;
+    }
+
+    // Descend from the key seed to the subtree root.
+    HWY_ALIGN_MAX absl::uint128 seed = key_seed;
+    HWY_ALIGN_MAX absl::uint128 path = current_leaf >> subtree_levels;
+    bool control_bit = party;
+    DPF_RETURN_IF_ERROR(EvaluateSeeds(
+        absl::MakeConstSpan(&seed, 1), absl::MakeConstSpan(&control_bit, 1),
+        absl::MakeConstSpan(&path, 1),
+        absl::MakeConstSpan(key.correction_words())
+            .subspan(0, stop_level - subtree_levels),
+        absl::MakeSpan(&seed, 1), absl::MakeSpan(&control_bit, 1)));
+
+    // Expand the subtree, hash, and correct into `result`.
+    DpfExpansion subtree_root;
+    subtree_root.seeds = hwy::AllocateAligned<absl::uint128>(1);
+    if (subtree_root.seeds == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+    subtree_root.seeds[0] = seed;
+    subtree_root.control_bits.PushBack(control_bit);
+    DPF_ASSIGN_OR_RETURN(
+        DpfExpansion expansion,
+        ExpandSeeds(subtree_root,
+                    absl::MakeConstSpan(key.correction_words())
+                        .subspan(stop_level - subtree_levels, subtree_levels)));
+    const auto expansion_size =
+        static_cast<int64_t>(expansion.control_bits.size());
+    absl::StatusOr<EvaluationScratch::Buffer> hashed_expansion =
+        HashExpandedSeeds(
+            hierarchy_level,
+            absl::MakeConstSpan(expansion.seeds.get(), expansion_size));
+    if (!hashed_expansion.ok()) {
+      return hashed_expansion.status();
+    }
+    for (int64_t j = 0; j < expansion_size; ++j) {
+      std::array<T, elements_per_block> current_elements =
+          dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+              reinterpret_cast<const char*>(hashed_expansion->data.get() +
+                                            j * blocks_needed),
+              blocks_needed * sizeof(absl::uint128)));
+      const absl::uint128 leaf_domain_start = (current_leaf + j)
+                                              << block_index_bits;
+      for (int k = 0; k < corrected_elements_per_block; ++k) {
+        const absl::uint128 domain_index = leaf_domain_start + k;
+        if (domain_index < start || domain_index >= end) {
+          continue;  // Edge leaves may cover indices outside the range.
+        }
+        T current_element = current_elements[k];
+        if (expansion.control_bits[j]) {
+          current_element += (*correction_ints)[k];
+        }
+        if (party) {
+          current_element = -current_element;
+        }
+        result[static_cast<int64_t>(domain_index - start)] = current_element;
+      }
+    }
+
+    if (current_leaf + (absl::uint128{1} << subtree_levels) - 1 >= last_leaf) {
+      break;
+    }
+    current_leaf += absl::uint128{1} << subtree_levels;
+  }
   return result;
 }
 
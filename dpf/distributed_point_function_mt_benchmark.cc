@@ -0,0 +1,182 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Multi-threaded scaling benchmarks for `DistributedPointFunction`. Each
+// benchmark comes in two flavors: all threads sharing a single
+// `DistributedPointFunction` instance, and one instance per thread. Comparing
+// the two quantifies contention on shared state (e.g., the AES contexts used
+// for seed expansion and hashing) as the thread count grows.
+
+#include <glog/logging.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "dpf/distributed_point_function.h"
+
+namespace distributed_point_functions {
+namespace {
+
+// Number of points evaluated per `EvaluateAt` call.
+constexpr int kNumEvaluationPoints = 1000;
+// Log domain size for the `EvaluateAt` benchmarks. Chosen large so that
+// evaluation walks a deep tree per point.
+constexpr int kEvaluateAtLogDomainSize = 56;
+// Log domain size for the full-expansion `EvaluateUntil` benchmarks.
+constexpr int kEvaluateUntilLogDomainSize = 18;
+
+// A DPF together with a key and evaluation points, set up once and shared by
+// all benchmark threads.
+template <typename T>
+struct DpfFixture {
+  std::unique_ptr<DistributedPointFunction> dpf;
+  DpfKey key;
+  std::vector<absl::uint128> evaluation_points;
+  EvaluationContext ctx_0;
+};
+
+template <typename T>
+DpfFixture<T> CreateFixture(int log_domain_size) {
+  DpfFixture<T> fixture;
+  DpfParameters parameters;
+  parameters.set_log_domain_size(log_domain_size);
+  *(parameters.mutable_value_type()) = ToValueType<T>();
+  fixture.dpf = DistributedPointFunction::Create(parameters).value();
+  CHECK(fixture.dpf->template RegisterValueType<T>().ok());
+
+  absl::uint128 domain_mask = absl::Uint128Max();
+  if (log_domain_size < 128) {
+    domain_mask = (absl::uint128{1} << log_domain_size) - 1;
+  }
+  absl::BitGen rng;
+  absl::uint128 alpha = absl::MakeUint128(absl::Uniform<uint64_t>(rng),
+                                          absl::Uniform<uint64_t>(rng)) &
+                        domain_mask;
+  T beta{};
+  fixture.key = fixture.dpf->GenerateKeys(alpha, beta).value().first;
+  fixture.ctx_0 = fixture.dpf->CreateEvaluationContext(fixture.key).value();
+
+  fixture.evaluation_points.resize(kNumEvaluationPoints);
+  for (int i = 0; i < kNumEvaluationPoints; ++i) {
+    fixture.evaluation_points[i] = absl::MakeUint128(
+                                       absl::Uniform<uint64_t>(rng),
+                                       absl::Uniform<uint64_t>(rng)) &
+                                   domain_mask;
+  }
+  return fixture;
+}
+
+// Returns a fixture shared by all threads of a benchmark. Initialization is
+// thread-safe and happens on the first call; the fixture is leaked so that no
+// thread can outlive it.
+template <typename T, int kLogDomainSize>
+const DpfFixture<T>& GetSharedFixture() {
+  static const DpfFixture<T>* fixture =
+      new DpfFixture<T>(CreateFixture<T>(kLogDomainSize));
+  return *fixture;
+}
+
+// Benchmarks `EvaluateAt` with all threads sharing one
+// `DistributedPointFunction` instance and key.
+template <typename T>
+void BM_EvaluateAtSharedInstance(benchmark::State& state) {
+  const DpfFixture<T>& fixture =
+      GetSharedFixture<T, kEvaluateAtLogDomainSize>();
+  for (auto s : state) {
+    std::vector<T> result =
+        fixture.dpf
+            ->template EvaluateAt<T>(fixture.key, 0, fixture.evaluation_points)
+            .value();
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEvaluationPoints);
+  state.SetBytesProcessed(state.iterations() * kNumEvaluationPoints *
+                          sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_EvaluateAtSharedInstance, uint64_t)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_EvaluateAtSharedInstance, XorWrapper<absl::uint128>)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+// As above, but each thread creates its own instance and key. The benchmark
+// function is invoked once per thread, so everything set up before the state
+// loop is thread-local.
+template <typename T>
+void BM_EvaluateAtPerThreadInstance(benchmark::State& state) {
+  DpfFixture<T> fixture = CreateFixture<T>(kEvaluateAtLogDomainSize);
+  for (auto s : state) {
+    std::vector<T> result =
+        fixture.dpf
+            ->template EvaluateAt<T>(fixture.key, 0, fixture.evaluation_points)
+            .value();
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEvaluationPoints);
+  state.SetBytesProcessed(state.iterations() * kNumEvaluationPoints *
+                          sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_EvaluateAtPerThreadInstance, uint64_t)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_EvaluateAtPerThreadInstance, XorWrapper<absl::uint128>)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+// Benchmarks a full-domain `EvaluateUntil` expansion with all threads sharing
+// one `DistributedPointFunction` instance. Each thread copies the initial
+// evaluation context per iteration, as in the single-threaded benchmarks.
+template <typename T>
+void BM_EvaluateUntilSharedInstance(benchmark::State& state) {
+  const DpfFixture<T>& fixture =
+      GetSharedFixture<T, kEvaluateUntilLogDomainSize>();
+  const int64_t num_outputs = int64_t{1} << kEvaluateUntilLogDomainSize;
+  for (auto s : state) {
+    EvaluationContext ctx = fixture.ctx_0;
+    std::vector<T> result = fixture.dpf->template EvaluateUntil<T>(0, {}, ctx)
+                                .value();
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * num_outputs);
+  state.SetBytesProcessed(state.iterations() * num_outputs * sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_EvaluateUntilSharedInstance, uint64_t)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+// As above, but with one instance per thread.
+template <typename T>
+void BM_EvaluateUntilPerThreadInstance(benchmark::State& state) {
+  DpfFixture<T> fixture = CreateFixture<T>(kEvaluateUntilLogDomainSize);
+  const int64_t num_outputs = int64_t{1} << kEvaluateUntilLogDomainSize;
+  for (auto s : state) {
+    EvaluationContext ctx = fixture.ctx_0;
+    std::vector<T> result = fixture.dpf->template EvaluateUntil<T>(0, {}, ctx)
+                                .value();
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * num_outputs);
+  state.SetBytesProcessed(state.iterations() * num_outputs * sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_EvaluateUntilPerThreadInstance, uint64_t)
+    ->ThreadRange(1, 128)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace distributed_point_functions
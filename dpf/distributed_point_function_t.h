@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_DISTRIBUTED_POINT_FUNCTION_T_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_DISTRIBUTED_POINT_FUNCTION_T_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+
+namespace distributed_point_functions {
+
+// A compile-time specialized front-end to `DistributedPointFunction` for
+// non-incremental DPFs whose value type and domain size are fixed at compile
+// time. Deployments that only use a handful of DPF shapes can instantiate one
+// `DistributedPointFunctionT` per shape and share it across threads, instead
+// of assembling `DpfParameters` at runtime for every instance.
+//
+// All methods forward to a shared `DistributedPointFunction` created from the
+// template parameters, pinning the value type so that no per-call type
+// dispatch on `T` is needed, and using the typed `GenerateKeys` fast path that
+// never materializes `Value` protos. Functionality not covered here (e.g.,
+// incremental evaluation contexts) is available through `dpf()`.
+//
+// Example usage:
+//
+//   DPF_ASSIGN_OR_RETURN(auto dpf,
+//                        (DistributedPointFunctionT<uint32_t, 20>::Create()));
+//   DPF_ASSIGN_OR_RETURN(auto keys, dpf->GenerateKeys(alpha, beta));
+//   DPF_ASSIGN_OR_RETURN(std::vector<uint32_t> evaluations,
+//                        dpf->EvaluateAt(keys.first, evaluation_points));
+template <typename T, int kLogDomainSize>
+class DistributedPointFunctionT {
+ public:
+  static_assert(is_supported_type_v<T>,
+                "The type T passed to DistributedPointFunctionT is not "
+                "supported");
+  static_assert(kLogDomainSize >= 0 && kLogDomainSize <= 128,
+                "kLogDomainSize must be in [0, 128]");
+
+  using OutputType = T;
+  static constexpr int kLogDomainSizeValue = kLogDomainSize;
+
+  // Creates a new `DistributedPointFunctionT` over the domain
+  // `[0, 2^kLogDomainSize)` with output type T.
+  //
+  // Returns INVALID_ARGUMENT if the resulting parameters are invalid.
+  static absl::StatusOr<std::unique_ptr<DistributedPointFunctionT>> Create() {
+    DpfParameters parameters;
+    parameters.set_log_domain_size(kLogDomainSize);
+    *(parameters.mutable_value_type()) = ToValueType<T>();
+    absl::StatusOr<std::unique_ptr<DistributedPointFunction>> dpf =
+        DistributedPointFunction::Create(parameters);
+    if (!dpf.ok()) {
+      return dpf.status();
+    }
+    return absl::WrapUnique(new DistributedPointFunctionT(std::move(*dpf)));
+  }
+
+  // DistributedPointFunctionT is neither copyable nor movable.
+  DistributedPointFunctionT(const DistributedPointFunctionT&) = delete;
+  DistributedPointFunctionT& operator=(const DistributedPointFunctionT&) =
+      delete;
+
+  // Generates a pair of keys for a DPF that evaluates to `beta` when evaluated
+  // at `alpha`. Uses the typed key generation fast path, dispatching the value
+  // correction computation at compile time.
+  //
+  // Returns INVALID_ARGUMENT if `alpha` is outside of the domain.
+  absl::StatusOr<std::pair<DpfKey, DpfKey>> GenerateKeys(absl::uint128 alpha,
+                                                         const T& beta) {
+    return dpf_->GenerateKeysTyped<T>(alpha, beta);
+  }
+
+  // Evaluates `key` at each element of `evaluation_points`.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed, or if any element of
+  // `evaluation_points` is outside of the domain.
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const DpfKey& key,
+      absl::Span<const absl::uint128> evaluation_points) const {
+    return dpf_->EvaluateAt<T>(key, 0, evaluation_points);
+  }
+
+  // As above, but takes a key validated with `dpf().ValidateKey`, skipping the
+  // per-call key validation.
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const ValidatedDpfKey& key,
+      absl::Span<const absl::uint128> evaluation_points) const {
+    return dpf_->EvaluateAt<T>(key, 0, evaluation_points);
+  }
+
+  // Evaluates `key` on the entire domain, returning `2^kLogDomainSize`
+  // elements. Only available for `kLogDomainSize <= 62`.
+  //
+  // Returns INVALID_ARGUMENT if `key` is malformed.
+  absl::StatusOr<std::vector<T>> EvaluateAll(const DpfKey& key) const {
+    static_assert(kLogDomainSize <= 62,
+                  "EvaluateAll is only supported for kLogDomainSize <= 62");
+    absl::StatusOr<EvaluationContext> ctx = dpf_->CreateEvaluationContext(key);
+    if (!ctx.ok()) {
+      return ctx.status();
+    }
+    return dpf_->EvaluateNext<T>({}, *ctx);
+  }
+
+  // Returns the underlying `DistributedPointFunction` for functionality not
+  // exposed by this wrapper.
+  DistributedPointFunction& dpf() { return *dpf_; }
+  const DistributedPointFunction& dpf() const { return *dpf_; }
+
+ private:
+  explicit DistributedPointFunctionT(
+      std::unique_ptr<DistributedPointFunction> dpf)
+      : dpf_(std::move(dpf)) {}
+
+  std::unique_ptr<DistributedPointFunction> dpf_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_DISTRIBUTED_POINT_FUNCTION_T_H_
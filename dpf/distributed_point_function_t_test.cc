@@ -0,0 +1,130 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/distributed_point_function_t.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "absl/numeric/int128.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/tuple.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+
+TEST(DistributedPointFunctionT, EvaluateAtProducesCorrectOutputs) {
+  constexpr int kLogDomainSize = 10;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, (DistributedPointFunctionT<uint32_t, kLogDomainSize>::Create()));
+
+  const absl::uint128 alpha = 23;
+  const uint32_t beta = 42;
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(alpha, beta));
+
+  std::vector<absl::uint128> evaluation_points = {0, 1, 23, 42, 512, 1023};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> output_1,
+                           dpf->EvaluateAt(keys.first, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> output_2,
+                           dpf->EvaluateAt(keys.second, evaluation_points));
+
+  for (int i = 0; i < static_cast<int>(evaluation_points.size()); ++i) {
+    uint32_t sum = output_1[i] + output_2[i];
+    if (evaluation_points[i] == alpha) {
+      EXPECT_EQ(sum, beta);
+    } else {
+      EXPECT_EQ(sum, 0);
+    }
+  }
+}
+
+TEST(DistributedPointFunctionT, EvaluateAllProducesCorrectOutputs) {
+  constexpr int kLogDomainSize = 8;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, (DistributedPointFunctionT<uint64_t, kLogDomainSize>::Create()));
+
+  const absl::uint128 alpha = 123;
+  const uint64_t beta = 456;
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(alpha, beta));
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> output_1,
+                           dpf->EvaluateAll(keys.first));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> output_2,
+                           dpf->EvaluateAll(keys.second));
+
+  ASSERT_EQ(output_1.size(), 1 << kLogDomainSize);
+  ASSERT_EQ(output_2.size(), 1 << kLogDomainSize);
+  for (int i = 0; i < (1 << kLogDomainSize); ++i) {
+    uint64_t sum = output_1[i] + output_2[i];
+    if (i == alpha) {
+      EXPECT_EQ(sum, beta);
+    } else {
+      EXPECT_EQ(sum, 0);
+    }
+  }
+}
+
+TEST(DistributedPointFunctionT, WorksForTupleTypes) {
+  using MyTuple = Tuple<uint32_t, uint64_t>;
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           (DistributedPointFunctionT<MyTuple, 5>::Create()));
+
+  const absl::uint128 alpha = 17;
+  const MyTuple beta{12, 34};
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(alpha, beta));
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<MyTuple> output_1,
+                           dpf->EvaluateAll(keys.first));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<MyTuple> output_2,
+                           dpf->EvaluateAll(keys.second));
+
+  for (int i = 0; i < 32; ++i) {
+    MyTuple sum = output_1[i] + output_2[i];
+    if (i == alpha) {
+      EXPECT_EQ(sum, beta);
+    } else {
+      EXPECT_EQ(sum, MyTuple{});
+    }
+  }
+}
+
+TEST(DistributedPointFunctionT, EvaluateAtAcceptsValidatedKeys) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           (DistributedPointFunctionT<uint32_t, 10>::Create()));
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(23, 42u));
+  DPF_ASSERT_OK_AND_ASSIGN(ValidatedDpfKey validated_key,
+                           dpf->dpf().ValidateKey(keys.first));
+
+  std::vector<absl::uint128> evaluation_points = {23, 42};
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint32_t> validated_output,
+      dpf->EvaluateAt(validated_key, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> proto_output,
+                           dpf->EvaluateAt(keys.first, evaluation_points));
+  EXPECT_EQ(validated_output, proto_output);
+}
+
+TEST(DistributedPointFunctionT, GenerateKeysFailsIfAlphaTooLarge) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           (DistributedPointFunctionT<uint32_t, 4>::Create()));
+
+  EXPECT_THAT(dpf->GenerateKeys(16, 1u),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`alpha` must be smaller than the output domain size"));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
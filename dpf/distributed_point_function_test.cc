@@ -17,6 +17,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <numeric>
+
 #include "absl/numeric/int128.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_format.h"
@@ -112,6 +114,63 @@ TEST(DistributedPointFunction, TestGenerateKeysIncrementalTemplate) {
   EXPECT_THAT(keys, IsOk());
 }
 
+TEST(DistributedPointFunction, TestGenerateKeysIncrementalTyped) {
+  std::vector<DpfParameters> parameters(2);
+  parameters[0].set_log_domain_size(5);
+  parameters[1].set_log_domain_size(10);
+  *(parameters[0].mutable_value_type()) = ToValueType<uint64_t>();
+  *(parameters[1].mutable_value_type()) = ToValueType<uint64_t>();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<DistributedPointFunction> dpf,
+      DistributedPointFunction::CreateIncremental(parameters));
+
+  const absl::uint128 alpha = 123;
+  const std::vector<uint64_t> beta = {42, 23};
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(key_a, key_b),
+      dpf->GenerateKeysIncrementalTyped<uint64_t>(alpha, beta));
+
+  // Evaluate both hierarchy levels and check the point function.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_b,
+                           dpf->CreateEvaluationContext(key_b));
+  std::vector<uint64_t> result_a, result_b;
+  DPF_ASSERT_OK_AND_ASSIGN(result_a,
+                           dpf->EvaluateUntil<uint64_t>(0, {}, ctx_a));
+  DPF_ASSERT_OK_AND_ASSIGN(result_b,
+                           dpf->EvaluateUntil<uint64_t>(0, {}, ctx_b));
+  ASSERT_EQ(result_a.size(), 1 << 5);
+  for (int i = 0; i < (1 << 5); ++i) {
+    EXPECT_EQ(result_a[i] + result_b[i],
+              i == static_cast<int>(alpha >> 5) ? beta[0] : 0)
+        << "i=" << i;
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result_a, dpf->EvaluateUntil<uint64_t>(1, {alpha >> 5}, ctx_a));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result_b, dpf->EvaluateUntil<uint64_t>(1, {alpha >> 5}, ctx_b));
+  ASSERT_EQ(result_a.size(), 1 << 5);
+  for (int i = 0; i < (1 << 5); ++i) {
+    const absl::uint128 index = ((alpha >> 5) << 5) + i;
+    EXPECT_EQ(result_a[i] + result_b[i], index == alpha ? beta[1] : 0)
+        << "i=" << i;
+  }
+
+  // Mismatched sizes and value types are rejected.
+  EXPECT_THAT(dpf->GenerateKeysIncrementalTyped<uint64_t>(
+                  alpha, absl::MakeConstSpan(beta).subspan(0, 1)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`beta` has to have the same size as `parameters` "
+                       "passed at construction"));
+  const std::vector<uint32_t> wrong_type = {42, 23};
+  EXPECT_THAT(
+      dpf->GenerateKeysIncrementalTyped<uint32_t>(alpha, wrong_type),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`beta` does not match the value type passed at construction"));
+}
+
 TEST(DistributedPointFunction, KeyGenerationFailsIfValueTypeNotRegistered) {
   DpfParameters parameters;
   parameters.set_log_domain_size(10);
@@ -201,6 +260,484 @@ TEST(DistributedPointFunction, TestSinglePointPartialEvaluation) {
   }
 }
 
+TEST(DistributedPointFunction, TestParallelExpansionMatchesSequential) {
+  // Large enough domain so that `ExpandSeedsParallel` actually splits the
+  // frontier across threads.
+  DpfParameters parameters;
+  parameters.set_log_domain_size(18);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  absl::uint128 alpha = 12345;
+  uint64_t beta = 42;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_sequential,
+                           dpf->CreateEvaluationContext(key_a));
+  std::vector<uint64_t> result_sequential;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result_sequential, dpf->EvaluateUntil<uint64_t>(0, {}, ctx_sequential));
+
+  DPF_ASSERT_OK(dpf->SetNumEvaluationThreads(4));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_parallel,
+                           dpf->CreateEvaluationContext(key_a));
+  std::vector<uint64_t> result_parallel;
+  DPF_ASSERT_OK_AND_ASSIGN(result_parallel,
+                           dpf->EvaluateUntil<uint64_t>(0, {}, ctx_parallel));
+
+  EXPECT_EQ(result_sequential, result_parallel);
+  EXPECT_THAT(dpf->SetNumEvaluationThreads(0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(DistributedPointFunction, TestEvaluateUntilParallelMatchesSequential) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(18);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  absl::uint128 alpha = 23456;
+  uint64_t beta = 42;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  // `dpf` stays at its default single thread; `EvaluateUntilParallel` picks
+  // its thread count per call, without mutating `dpf`.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_sequential,
+                           dpf->CreateEvaluationContext(key_a));
+  std::vector<uint64_t> result_sequential;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result_sequential, dpf->EvaluateUntil<uint64_t>(0, {}, ctx_sequential));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_parallel,
+                           dpf->CreateEvaluationContext(key_a));
+  std::vector<uint64_t> result_parallel;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result_parallel,
+      dpf->EvaluateUntilParallel<uint64_t>(0, {}, ctx_parallel, 4));
+  EXPECT_EQ(result_sequential, result_parallel);
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_invalid,
+                           dpf->CreateEvaluationContext(key_a));
+  EXPECT_THAT(dpf->EvaluateUntilParallel<uint64_t>(0, {}, ctx_invalid, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`num_threads` must be positive"));
+}
+
+TEST(DistributedPointFunction, TestEvaluateUntilAccumulate) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  absl::uint128 alpha = 23;
+  uint64_t beta = 42;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  // Accumulating both keys' outputs should reconstruct the point function.
+  std::vector<uint64_t> accumulator(1 << 10, 0);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_b,
+                           dpf->CreateEvaluationContext(key_b));
+  DPF_EXPECT_OK(dpf->EvaluateUntilAccumulate<uint64_t>(
+      0, {}, ctx_a, absl::MakeSpan(accumulator)));
+  DPF_EXPECT_OK(dpf->EvaluateUntilAccumulate<uint64_t>(
+      0, {}, ctx_b, absl::MakeSpan(accumulator)));
+
+  for (int i = 0; i < (1 << 10); ++i) {
+    if (i == alpha) {
+      EXPECT_EQ(accumulator[i], beta);
+    } else {
+      ASSERT_EQ(accumulator[i], 0) << "i=" << i;
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestEvaluateAtAccumulate) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  absl::uint128 alpha = 23;
+  uint64_t beta = 42;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42};
+  std::vector<uint64_t> accumulator(evaluation_points.size(), 0);
+  DPF_EXPECT_OK(dpf->EvaluateAtAccumulate<uint64_t>(
+      key_a, 0, evaluation_points, absl::MakeSpan(accumulator)));
+  DPF_EXPECT_OK(dpf->EvaluateAtAccumulate<uint64_t>(
+      key_b, 0, evaluation_points, absl::MakeSpan(accumulator)));
+  EXPECT_EQ(accumulator[0], 0);
+  EXPECT_EQ(accumulator[1], beta);
+  EXPECT_EQ(accumulator[2], 0);
+
+  std::vector<uint64_t> wrong_size(2);
+  EXPECT_THAT(
+      dpf->EvaluateAtAccumulate<uint64_t>(key_a, 0, evaluation_points,
+                                          absl::MakeSpan(wrong_size)),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`accumulator` must have the same size as `evaluation_points`"));
+}
+
+TEST(DistributedPointFunction, TestEvaluationStatsCollection) {
+  EXPECT_FALSE(DistributedPointFunction::GetHwyModeAsString().empty());
+
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b), dpf->GenerateKeys(23, 42));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                           dpf->CreateEvaluationContext(key_a));
+
+  EvaluationStats stats;
+  DistributedPointFunction::SetEvaluationStatsSink(&stats);
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint64_t>(0, {}, ctx).status());
+  DistributedPointFunction::SetEvaluationStatsSink(nullptr);
+
+  if (DistributedPointFunction::EvaluationStatsEnabled()) {
+    // One expanded level per tree level: 2 uint64 elements per block, so the
+    // tree has 10 - 1 = 9 levels.
+    EXPECT_EQ(stats.seeds_expanded_per_level.size(), 9);
+    EXPECT_GT(stats.prg_left_blocks, 0);
+    EXPECT_GT(stats.prg_right_blocks, 0);
+    EXPECT_GT(stats.prg_value_blocks, 0);
+    EXPECT_GT(stats.allocated_bytes, 0);
+    EXPECT_GT(stats.expand_nanos, 0);
+  } else {
+    // Instrumentation is compiled out; the sink must stay untouched.
+    EXPECT_TRUE(stats.seeds_expanded_per_level.empty());
+    EXPECT_EQ(stats.prg_left_blocks, 0);
+  }
+}
+
+TEST(DistributedPointFunction, TestPipelinedEvaluationProducesCorrectOutputs) {
+  // Domain large enough that `EvaluateUntilImpl` takes the pipelined
+  // hash-and-correct path instead of hashing the full expansion up front.
+  DpfParameters parameters;
+  parameters.set_log_domain_size(18);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  absl::uint128 alpha = 111111;
+  uint64_t beta = 42;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_b,
+                           dpf->CreateEvaluationContext(key_b));
+  std::vector<uint64_t> output_a, output_b;
+  DPF_ASSERT_OK_AND_ASSIGN(output_a, dpf->EvaluateUntil<uint64_t>(0, {}, ctx_a));
+  DPF_ASSERT_OK_AND_ASSIGN(output_b, dpf->EvaluateUntil<uint64_t>(0, {}, ctx_b));
+
+  ASSERT_EQ(output_a.size(), int64_t{1} << 18);
+  for (int64_t i = 0; i < static_cast<int64_t>(output_a.size()); ++i) {
+    uint64_t sum = output_a[i] + output_b[i];
+    if (i == alpha) {
+      EXPECT_EQ(sum, beta);
+    } else {
+      ASSERT_EQ(sum, 0) << "i=" << i;
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestXorWrapperEvaluateUntilAndAccumulate) {
+  using T = XorWrapper<absl::uint128>;
+  // Domain large enough to exercise both the whole-block XOR correction
+  // kernel and the pipelined hash-and-correct path.
+  constexpr int kLogDomainSize = 16;
+  DpfParameters parameters;
+  parameters.set_log_domain_size(kLogDomainSize);
+  *(parameters.mutable_value_type()) = ToValueType<T>();
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DPF_ASSERT_OK(dpf->RegisterValueType<T>());
+  absl::uint128 alpha = 12345;
+  T beta(absl::MakeUint128(0x0123456789abcdef, 0xfedcba9876543210));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  // Evaluate both keys fully; XORing the shares reconstructs the point
+  // function.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_b,
+                           dpf->CreateEvaluationContext(key_b));
+  std::vector<T> output_a, output_b;
+  DPF_ASSERT_OK_AND_ASSIGN(output_a, dpf->EvaluateUntil<T>(0, {}, ctx_a));
+  DPF_ASSERT_OK_AND_ASSIGN(output_b, dpf->EvaluateUntil<T>(0, {}, ctx_b));
+
+  // The fused XOR-accumulate of both keys into a single buffer must match.
+  std::vector<T> accumulator(int64_t{1} << kLogDomainSize);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_acc_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_acc_b,
+                           dpf->CreateEvaluationContext(key_b));
+  DPF_EXPECT_OK(dpf->EvaluateUntilAccumulate<T>(0, {}, ctx_acc_a,
+                                                absl::MakeSpan(accumulator)));
+  DPF_EXPECT_OK(dpf->EvaluateUntilAccumulate<T>(0, {}, ctx_acc_b,
+                                                absl::MakeSpan(accumulator)));
+
+  ASSERT_EQ(output_a.size(), accumulator.size());
+  for (int64_t i = 0; i < static_cast<int64_t>(accumulator.size()); ++i) {
+    T sum = output_a[i] + output_b[i];
+    ASSERT_EQ(sum.value(), accumulator[i].value()) << "i=" << i;
+    if (i == alpha) {
+      EXPECT_EQ(sum.value(), beta.value());
+    } else {
+      ASSERT_EQ(sum.value(), absl::uint128{0}) << "i=" << i;
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestMultiBlockTuplePipelinedEvaluation) {
+  // A 192-bit tuple needs two hash blocks per seed, so the pipelined path
+  // scales its chunk size down to keep each chunk's hashed blocks L2-sized.
+  // Domain chosen large enough to trigger pipelining with the scaled chunks.
+  using T = Tuple<uint64_t, uint64_t, uint64_t>;
+  constexpr int kLogDomainSize = 16;
+  DpfParameters parameters;
+  parameters.set_log_domain_size(kLogDomainSize);
+  *(parameters.mutable_value_type()) = ToValueType<T>();
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DPF_ASSERT_OK(dpf->RegisterValueType<T>());
+  absl::uint128 alpha = 54321;
+  T beta(1, 2, 3);
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(alpha, beta));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_a,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_b,
+                           dpf->CreateEvaluationContext(key_b));
+  std::vector<T> output_a, output_b;
+  DPF_ASSERT_OK_AND_ASSIGN(output_a, dpf->EvaluateUntil<T>(0, {}, ctx_a));
+  DPF_ASSERT_OK_AND_ASSIGN(output_b, dpf->EvaluateUntil<T>(0, {}, ctx_b));
+
+  ASSERT_EQ(output_a.size(), int64_t{1} << kLogDomainSize);
+  for (int64_t i = 0; i < static_cast<int64_t>(output_a.size()); ++i) {
+    T sum = output_a[i] + output_b[i];
+    if (i == alpha) {
+      EXPECT_EQ(sum, beta);
+    } else {
+      ASSERT_EQ(sum, T(0, 0, 0)) << "i=" << i;
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestEvaluateUntilLazyMatchesEagerEvaluation) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b), dpf->GenerateKeys(23, 42));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_eager,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> expected,
+                           dpf->EvaluateUntil<uint64_t>(0, {}, ctx_eager));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_lazy,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(LazyEvaluation<uint64_t> lazy,
+                           dpf->EvaluateUntilLazy<uint64_t>(0, {}, ctx_lazy));
+  EXPECT_EQ(lazy.size(), 1 << 10);
+
+  // Materialize a subset of indices, including duplicates and indices sharing
+  // a block, and compare with the eager evaluation.
+  std::vector<int64_t> indices = {0, 1, 23, 22, 23, 511, 1023};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> materialized,
+                           lazy.Materialize(indices));
+  ASSERT_EQ(materialized.size(), indices.size());
+  for (int i = 0; i < static_cast<int>(indices.size()); ++i) {
+    EXPECT_EQ(materialized[i], expected[indices[i]]) << "i=" << i;
+  }
+
+  // Out-of-range indices are rejected.
+  EXPECT_THAT(lazy.Materialize({int64_t{1} << 10}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("Index")));
+}
+
+TEST(DistributedPointFunction, TestEvaluateUntilLazyWithPrefixes) {
+  std::vector<DpfParameters> parameters(2);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(64);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(23, {42, 42}));
+
+  // Eager evaluation of the second hierarchy level under two prefixes.
+  std::vector<absl::uint128> prefixes = {0, 23 >> 5};
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_eager,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint64_t>(0, {}, ctx_eager).status());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> expected,
+      dpf->EvaluateUntil<uint64_t>(1, prefixes, ctx_eager));
+
+  // Lazy evaluation with the same prefixes must materialize the same values.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_lazy,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint64_t>(0, {}, ctx_lazy).status());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      LazyEvaluation<uint64_t> lazy,
+      dpf->EvaluateUntilLazy<uint64_t>(1, prefixes, ctx_lazy));
+  ASSERT_EQ(lazy.size(), static_cast<int64_t>(expected.size()));
+
+  std::vector<int64_t> indices(lazy.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> materialized,
+                           lazy.Materialize(indices));
+  EXPECT_EQ(materialized, expected);
+}
+
+TEST(DistributedPointFunction, TestEvaluateUntilIntoCallerProvidedBuffer) {
+  std::vector<DpfParameters> parameters(2);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(64);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(23, {42, 42}));
+
+  // Evaluate with the vector API for reference.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_vector,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> expected_0,
+                           dpf->EvaluateUntil<uint64_t>(0, {}, ctx_vector));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> expected_1,
+      dpf->EvaluateUntil<uint64_t>(1, {0, 23 >> 5}, ctx_vector));
+
+  // Now evaluate into caller-provided buffers.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_span,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(int64_t output_size_0,
+                           dpf->GetOutputSize(0, 0, ctx_span));
+  std::vector<uint64_t> output_0(output_size_0);
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint64_t>(0, {}, ctx_span,
+                                             absl::MakeSpan(output_0)));
+  EXPECT_EQ(output_0, expected_0);
+  DPF_ASSERT_OK_AND_ASSIGN(int64_t output_size_1,
+                           dpf->GetOutputSize(1, 2, ctx_span));
+  std::vector<uint64_t> output_1(output_size_1);
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint64_t>(1, {0, 23 >> 5}, ctx_span,
+                                             absl::MakeSpan(output_1)));
+  EXPECT_EQ(output_1, expected_1);
+
+  // A wrongly sized buffer should be rejected.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_invalid,
+                           dpf->CreateEvaluationContext(key_b));
+  std::vector<uint64_t> too_small(output_size_0 - 1);
+  EXPECT_THAT(dpf->EvaluateUntil<uint64_t>(0, {}, ctx_invalid,
+                                           absl::MakeSpan(too_small)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(DistributedPointFunction, TestStreamingFullDomainEvaluation) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b), dpf->GenerateKeys(23, 42));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> expected,
+                           dpf->EvaluateUntil<uint32_t>(0, {}, ctx));
+
+  // Stream the same evaluation in chunks of 2**6 values and check that the
+  // concatenation of all chunks matches the full expansion.
+  std::vector<uint32_t> streamed;
+  absl::uint128 expected_chunk_start = 0;
+  DPF_ASSERT_OK(dpf->EvaluateFullDomainStreaming<uint32_t>(
+      key_a, 0, 6,
+      [&streamed, &expected_chunk_start](absl::Span<const uint32_t> chunk,
+                                         absl::uint128 start) -> absl::Status {
+        EXPECT_EQ(start, expected_chunk_start);
+        EXPECT_EQ(chunk.size(), 1 << 6);
+        streamed.insert(streamed.end(), chunk.begin(), chunk.end());
+        expected_chunk_start += chunk.size();
+        return absl::OkStatus();
+      }));
+  EXPECT_EQ(streamed, expected);
+
+  // Errors returned by the callback should abort the evaluation.
+  EXPECT_THAT(dpf->EvaluateFullDomainStreaming<uint32_t>(
+                  key_a, 0, 6,
+                  [](absl::Span<const uint32_t>, absl::uint128) {
+                    return absl::AbortedError("stop");
+                  }),
+              StatusIs(absl::StatusCode::kAborted));
+}
+
+TEST(DistributedPointFunction, TestEvaluateRangeMatchesFullExpansion) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b), dpf->GenerateKeys(723, 42));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> expected,
+                           dpf->EvaluateUntil<uint32_t>(0, {}, ctx));
+
+  // Check several ranges, including unaligned ones and the full domain.
+  struct Range {
+    int start;
+    int end;
+  };
+  for (Range range : std::vector<Range>{
+           {0, 1024}, {0, 512}, {512, 1024}, {3, 5}, {7, 723}, {700, 800}}) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint32_t> result,
+        dpf->EvaluateRange<uint32_t>(key_a, 0, range.start, range.end));
+    ASSERT_EQ(result.size(), range.end - range.start);
+    for (int i = range.start; i < range.end; ++i) {
+      EXPECT_EQ(result[i - range.start], expected[i])
+          << "i=" << i << ", start=" << range.start << ", end=" << range.end;
+    }
+  }
+
+  EXPECT_THAT(dpf->EvaluateRange<uint32_t>(key_a, 0, 5, 5),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(dpf->EvaluateRange<uint32_t>(key_a, 0, 0, 1025),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 class RegularDpfKeyGenerationTest
     : public testing::TestWithParam<std::tuple<int, int>> {
  public:
@@ -518,6 +1055,75 @@ TEST_P(IncrementalDpfTest, FailsIfDuplicatePrefixInCtx) {
                        "mismatching seed or control bit"));
 }
 
+TEST_P(IncrementalDpfTest, EvaluationWithUnsortedPrefixesMatchesSorted) {
+  if (parameters_.size() < 3 || parameters_[0].log_domain_size() < 2 ||
+      parameters_[0].value_type().integer().bitsize() != 128 ||
+      parameters_[1].value_type().integer().bitsize() != 128 ||
+      parameters_[2].value_type().integer().bitsize() != 128) {
+    return;
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_sorted,
+                           dpf_->CreateEvaluationContext(keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_unsorted,
+                           dpf_->CreateEvaluationContext(keys_.first));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<absl::uint128>(0, {}, ctx_sorted));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<absl::uint128>(0, {}, ctx_unsorted));
+
+  // Evaluate level 1 with sorted and unsorted prefixes. This also leaves the
+  // partial evaluations of `ctx_unsorted` stored in unsorted order.
+  std::vector<absl::uint128> prefixes_sorted = {0, 1, 2, 3};
+  std::vector<absl::uint128> prefixes_unsorted = {2, 0, 3, 1};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> output_sorted,
+                           dpf_->EvaluateUntil<absl::uint128>(
+                               1, prefixes_sorted, ctx_sorted));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> output_unsorted,
+                           dpf_->EvaluateUntil<absl::uint128>(
+                               1, prefixes_unsorted, ctx_unsorted));
+  int64_t outputs_per_prefix =
+      int64_t{1} << (parameters_[1].log_domain_size() -
+                     parameters_[0].log_domain_size());
+  for (int i = 0; i < static_cast<int>(prefixes_unsorted.size()); ++i) {
+    // `prefixes_sorted[p] == p`, so the matching slice of `output_sorted`
+    // starts at `prefixes_unsorted[i] * outputs_per_prefix`.
+    auto position = static_cast<int64_t>(
+        absl::Uint128Low64(prefixes_unsorted[i]));
+    for (int64_t j = 0; j < outputs_per_prefix; ++j) {
+      EXPECT_EQ(output_unsorted[i * outputs_per_prefix + j],
+                output_sorted[position * outputs_per_prefix + j])
+          << "i=" << i << ", j=" << j;
+    }
+  }
+
+  // Evaluate level 2 with unsorted extensions of the level-1 prefixes, so the
+  // lookup into the stored partial evaluations happens out of order as well.
+  int shift =
+      parameters_[1].log_domain_size() - parameters_[0].log_domain_size();
+  std::vector<absl::uint128> prefixes_sorted_2 = {
+      absl::uint128{0} << shift, absl::uint128{1} << shift,
+      absl::uint128{2} << shift, absl::uint128{3} << shift};
+  std::vector<absl::uint128> prefixes_unsorted_2 = {
+      absl::uint128{3} << shift, absl::uint128{1} << shift,
+      absl::uint128{0} << shift, absl::uint128{2} << shift};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> output_sorted_2,
+                           dpf_->EvaluateUntil<absl::uint128>(
+                               2, prefixes_sorted_2, ctx_sorted));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> output_unsorted_2,
+                           dpf_->EvaluateUntil<absl::uint128>(
+                               2, prefixes_unsorted_2, ctx_unsorted));
+  int64_t outputs_per_prefix_2 =
+      int64_t{1} << (parameters_[2].log_domain_size() -
+                     parameters_[1].log_domain_size());
+  for (int i = 0; i < static_cast<int>(prefixes_unsorted_2.size()); ++i) {
+    auto position = static_cast<int64_t>(
+        absl::Uint128Low64(prefixes_unsorted_2[i] >> shift));
+    for (int64_t j = 0; j < outputs_per_prefix_2; ++j) {
+      EXPECT_EQ(output_unsorted_2[i * outputs_per_prefix_2 + j],
+                output_sorted_2[position * outputs_per_prefix_2 + j])
+          << "i=" << i << ", j=" << j;
+    }
+  }
+}
+
 TEST_P(IncrementalDpfTest, EvaluationFailsOnEmptyContext) {
   if (parameters_[0].value_type().integer().bitsize() != 128) {
     return;
@@ -992,6 +1598,22 @@ TYPED_TEST(DpfEvaluationTest, TestRegularDpf) {
   }
 }
 
+TYPED_TEST(DpfEvaluationTest, TestTypedKeyGenerationFailsIfTypeDoesntMatch) {
+  // Create a DPF over plain 64-bit integers. None of the types in
+  // `DpfEvaluationTypes` matches it, so the typed `GenerateKeys` overload has
+  // to fail.
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DistributedPointFunction> dpf,
+                           DistributedPointFunction::Create(parameters));
+
+  EXPECT_THAT(
+      dpf->GenerateKeys(23, this->beta_),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`beta` does not match the value type passed at construction"));
+}
+
 TYPED_TEST(DpfEvaluationTest, TestBatchSinglePointEvaluation) {
   // Set Up with a large output domain, to make sure this works.
   for (int log_domain_size : {0, 1, 2, 32, 128}) {
@@ -1029,5 +1651,606 @@ TYPED_TEST(DpfEvaluationTest, TestBatchSinglePointEvaluation) {
   }
 }
 
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtBatchMatchesEvaluateAt) {
+  this->SetUp(10, 23);
+  // Generate a second key pair for a different point, so the batch contains
+  // keys with different correction words.
+  DPF_ASSERT_OK_AND_ASSIGN(std::pair<DpfKey, DpfKey> keys_2,
+                           this->dpf_->GenerateKeys(42, this->beta_));
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+  std::vector<const DpfKey*> keys = {&this->keys_.first, &this->keys_.second,
+                                     &keys_2.first, &keys_2.second};
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> batch_output,
+                           this->dpf_->template EvaluateAtBatch<TypeParam>(
+                               keys, 0, evaluation_points));
+  ASSERT_EQ(batch_output.size(), keys.size() * evaluation_points.size());
+
+  for (int i = 0; i < static_cast<int>(keys.size()); ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> single_output,
+                             this->dpf_->template EvaluateAt<TypeParam>(
+                                 *keys[i], 0, evaluation_points));
+    for (int j = 0; j < static_cast<int>(evaluation_points.size()); ++j) {
+      EXPECT_EQ(batch_output[i * evaluation_points.size() + j],
+                single_output[j])
+          << "i=" << i << ", j=" << j;
+    }
+  }
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtCompiledKeyMatchesEvaluateAt) {
+  this->SetUp(10, 23);
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+
+  DPF_ASSERT_OK_AND_ASSIGN(CompiledDpfKey compiled_key,
+                           this->dpf_->CompileDpfKey(this->keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> compiled_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               compiled_key, 0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> proto_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.first, 0, evaluation_points));
+
+  EXPECT_EQ(compiled_output, proto_output);
+
+  // A compiled key can be evaluated repeatedly.
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> second_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               compiled_key, 0, evaluation_points));
+  EXPECT_EQ(second_output, proto_output);
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtValidatedKeyMatchesEvaluateAt) {
+  this->SetUp(10, 23);
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+
+  DPF_ASSERT_OK_AND_ASSIGN(ValidatedDpfKey validated_key,
+                           this->dpf_->ValidateKey(this->keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> validated_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               validated_key, 0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> proto_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.first, 0, evaluation_points));
+
+  EXPECT_EQ(validated_output, proto_output);
+
+  // A validated key can be evaluated repeatedly.
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> second_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               validated_key, 0, evaluation_points));
+  EXPECT_EQ(second_output, proto_output);
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtPrecomputedPointsMatchesEvaluateAt) {
+  this->SetUp(10, 23);
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      PrecomputedEvaluationPoints precomputed,
+      this->dpf_->PrecomputeEvaluationPoints(evaluation_points, 0));
+  EXPECT_EQ(precomputed.hierarchy_level(), 0);
+  EXPECT_EQ(precomputed.size(), 5);
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> precomputed_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.first, precomputed));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> proto_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.first, 0, evaluation_points));
+  EXPECT_EQ(precomputed_output, proto_output);
+
+  // Precomputed points can be reused across keys, including compiled ones.
+  DPF_ASSERT_OK_AND_ASSIGN(CompiledDpfKey compiled_key,
+                           this->dpf_->CompileDpfKey(this->keys_.second));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> compiled_output,
+      this->dpf_->template EvaluateAt<TypeParam>(compiled_key, precomputed));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> second_proto_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.second, 0, evaluation_points));
+  EXPECT_EQ(compiled_output, second_proto_output);
+}
+
+TYPED_TEST(DpfEvaluationTest,
+           TestEvaluateAtBatchPrecomputedPointsMatchesEvaluateAtBatch) {
+  this->SetUp(10, 23);
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+  std::vector<const DpfKey*> keys = {&this->keys_.first, &this->keys_.second};
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      PrecomputedEvaluationPoints precomputed,
+      this->dpf_->PrecomputeEvaluationPoints(evaluation_points, 0));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> precomputed_output,
+      this->dpf_->template EvaluateAtBatch<TypeParam>(keys, precomputed));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> plain_output,
+      this->dpf_->template EvaluateAtBatch<TypeParam>(keys, 0,
+                                                      evaluation_points));
+  EXPECT_EQ(precomputed_output, plain_output);
+}
+
+TEST(DistributedPointFunction, TestPrecomputeEvaluationPointsValidatesInput) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DistributedPointFunction> dpf,
+                           DistributedPointFunction::Create(parameters));
+
+  EXPECT_THAT(dpf->PrecomputeEvaluationPoints({1, 23}, -1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("`hierarchy_level`")));
+  EXPECT_THAT(dpf->PrecomputeEvaluationPoints({1, 23}, 1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("`hierarchy_level`")));
+  EXPECT_THAT(dpf->PrecomputeEvaluationPoints({1, 1024}, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("`evaluation_points[1]`")));
+}
+
+TYPED_TEST(DpfEvaluationTest, TestCreateEvaluationContextFromValidatedKey) {
+  this->SetUp(10, 23);
+
+  DPF_ASSERT_OK_AND_ASSIGN(ValidatedDpfKey validated_key,
+                           this->dpf_->ValidateKey(this->keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      EvaluationContext validated_ctx,
+      this->dpf_->CreateEvaluationContext(std::move(validated_key)));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      EvaluationContext proto_ctx,
+      this->dpf_->CreateEvaluationContext(this->keys_.first));
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> validated_output,
+      this->dpf_->template EvaluateNext<TypeParam>({}, validated_ctx));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> proto_output,
+      this->dpf_->template EvaluateNext<TypeParam>({}, proto_ctx));
+
+  EXPECT_EQ(validated_output, proto_output);
+}
+
+TYPED_TEST(DpfEvaluationTest, TestValidateKeyFailsOnMalformedKey) {
+  this->SetUp(10, 23);
+
+  DpfKey malformed_key = this->keys_.first;
+  malformed_key.mutable_correction_words()->RemoveLast();
+
+  EXPECT_THAT(this->dpf_->ValidateKey(std::move(malformed_key)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TYPED_TEST(DpfEvaluationTest, TestCompactKeySerializationRoundTrip) {
+  this->SetUp(10, 23);
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 512, 1023};
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::string serialized_0,
+                           this->dpf_->SerializeKeyCompact(this->keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string serialized_1,
+                           this->dpf_->SerializeKeyCompact(this->keys_.second));
+  // Keys for the same parameters always serialize to the same size.
+  EXPECT_EQ(serialized_0.size(), serialized_1.size());
+  // The compact format packs control bits and stores value corrections at
+  // their declared bitsize, so it must beat the proto wire format.
+  EXPECT_LT(serialized_0.size(), this->keys_.first.ByteSizeLong());
+
+  DPF_ASSERT_OK_AND_ASSIGN(DpfKey parsed,
+                           this->dpf_->ParseKeyCompact(serialized_0));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string serialized_again,
+                           this->dpf_->SerializeKeyCompact(parsed));
+  EXPECT_EQ(serialized_again, serialized_0);
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> parsed_output,
+      this->dpf_->template EvaluateAt<TypeParam>(parsed, 0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> proto_output,
+                           this->dpf_->template EvaluateAt<TypeParam>(
+                               this->keys_.first, 0, evaluation_points));
+  EXPECT_EQ(parsed_output, proto_output);
+}
+
+TYPED_TEST(DpfEvaluationTest, TestParseKeyCompactFailsOnMalformedInput) {
+  this->SetUp(10, 23);
+  DPF_ASSERT_OK_AND_ASSIGN(std::string serialized,
+                           this->dpf_->SerializeKeyCompact(this->keys_.first));
+
+  EXPECT_THAT(this->dpf_->ParseKeyCompact(""),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  std::string wrong_version = serialized;
+  wrong_version[0] = 42;
+  EXPECT_THAT(this->dpf_->ParseKeyCompact(wrong_version),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Unsupported compact key version 42"));
+
+  std::string truncated = serialized.substr(0, serialized.size() - 1);
+  EXPECT_THAT(
+      this->dpf_->ParseKeyCompact(truncated),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`serialized` ended unexpectedly while parsing a compact key"));
+
+  std::string trailing = serialized + '\0';
+  EXPECT_THAT(this->dpf_->ParseKeyCompact(trailing),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Trailing bytes after parsing a compact key"));
+}
+
+TEST(DistributedPointFunction, TestEvaluationStateMatchesEvaluationContext) {
+  std::vector<DpfParameters> parameters(3);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[2].set_log_domain_size(15);
+  parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  absl::uint128 alpha = 12345;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(alpha, {1, 2, 3}));
+
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                           dpf->CreateEvaluationContext(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf->CreateEvaluationState(key_a));
+  EXPECT_EQ(state.previous_hierarchy_level(), -1);
+
+  // First level: full expansion.
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> ctx_output,
+                           dpf->EvaluateUntil<uint32_t>(0, {}, ctx));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> state_output,
+                           dpf->EvaluateUntil<uint32_t>(0, {}, state));
+  EXPECT_EQ(state_output, ctx_output);
+  EXPECT_EQ(state.previous_hierarchy_level(), 0);
+
+  // Second level, with deliberately unsorted prefixes to exercise the sorted
+  // index maintenance in the native state.
+  std::vector<absl::uint128> prefixes_1 = {alpha >> 10, 0};
+  DPF_ASSERT_OK_AND_ASSIGN(ctx_output,
+                           dpf->EvaluateUntil<uint32_t>(1, prefixes_1, ctx));
+  DPF_ASSERT_OK_AND_ASSIGN(state_output,
+                           dpf->EvaluateUntil<uint32_t>(1, prefixes_1, state));
+  EXPECT_EQ(state_output, ctx_output);
+
+  // Third level, extending the prefixes from the second.
+  std::vector<absl::uint128> prefixes_2 = {alpha >> 5, 1};
+  DPF_ASSERT_OK_AND_ASSIGN(ctx_output,
+                           dpf->EvaluateUntil<uint32_t>(2, prefixes_2, ctx));
+  DPF_ASSERT_OK_AND_ASSIGN(state_output,
+                           dpf->EvaluateUntil<uint32_t>(2, prefixes_2, state));
+  EXPECT_EQ(state_output, ctx_output);
+}
+
+TEST(DistributedPointFunction, TestEvaluationStateFailsOnMissingPrefix) {
+  std::vector<DpfParameters> parameters(3);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[2].set_log_domain_size(15);
+  parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(23, {1, 2, 3}));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf->CreateEvaluationState(key_a));
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(0, {}, state).status());
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(1, {0}, state).status());
+  // Only prefix 0 was evaluated at the second level. Its expansion covers the
+  // whole tree block of 4 packed uint32 elements, so a prefix extending 4 is
+  // the smallest one that cannot be evaluated at the third level.
+  EXPECT_THAT(dpf->EvaluateUntil<uint32_t>(2, {4 << 5}, state),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("Prefix not present")));
+}
+
+TEST(DistributedPointFunction, TestRetainExpansionMatchesRegularEvaluation) {
+  std::vector<DpfParameters> parameters(3);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[2].set_log_domain_size(15);
+  parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  absl::uint128 alpha = 12345;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(alpha, {1, 2, 3}));
+
+  // Evaluate level by level with retention on, pruning between levels as a
+  // heavy-hitters protocol would, and check against a regular state.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf->CreateEvaluationState(key_a));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState retained_state,
+                           dpf->CreateEvaluationState(key_a));
+  retained_state.set_retain_expansion(true);
+  EXPECT_TRUE(retained_state.retain_expansion());
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> expected,
+                           dpf->EvaluateUntil<uint32_t>(0, {}, state));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint32_t> retained_output,
+      dpf->EvaluateUntil<uint32_t>(0, {}, retained_state));
+  EXPECT_EQ(retained_output, expected);
+
+  std::vector<absl::uint128> prefixes_1 = {0, alpha >> 10, 31};
+  DPF_ASSERT_OK_AND_ASSIGN(expected,
+                           dpf->EvaluateUntil<uint32_t>(1, prefixes_1, state));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      retained_output,
+      dpf->EvaluateUntil<uint32_t>(1, prefixes_1, retained_state));
+  EXPECT_EQ(retained_output, expected);
+
+  std::vector<absl::uint128> prefixes_2 = {1, alpha >> 5, (31 << 5) + 7};
+  DPF_ASSERT_OK_AND_ASSIGN(expected,
+                           dpf->EvaluateUntil<uint32_t>(2, prefixes_2, state));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      retained_output,
+      dpf->EvaluateUntil<uint32_t>(2, prefixes_2, retained_state));
+  EXPECT_EQ(retained_output, expected);
+}
+
+TEST(DistributedPointFunction, TestRetainExpansionFailsOnMissingPrefix) {
+  std::vector<DpfParameters> parameters(3);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[2].set_log_domain_size(15);
+  parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(23, {1, 2, 3}));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf->CreateEvaluationState(key_a));
+  state.set_retain_expansion(true);
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(0, {}, state).status());
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(1, {0}, state).status());
+  // Only prefix 0 survived at the second level, and its expansion covers one
+  // tree block of 4 packed uint32 elements, so prefixes extending 4 cannot be
+  // selected from the retained expansion at the third level.
+  EXPECT_THAT(dpf->EvaluateUntil<uint32_t>(2, {4 << 5}, state),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("Prefix not present")));
+}
+
+TEST(DistributedPointFunction, TestEvaluationStateCheckpointRoundTrip) {
+  std::vector<DpfParameters> parameters(3);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[2].set_log_domain_size(15);
+  parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  absl::uint128 alpha = 12345;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(alpha, {1, 2, 3}));
+
+  // Evaluate the first two levels, then checkpoint to a proto and restore.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf->CreateEvaluationState(key_a));
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(0, {}, state).status());
+  std::vector<absl::uint128> prefixes_1 = {0, alpha >> 10};
+  DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(1, prefixes_1, state).status());
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext checkpoint,
+                           dpf->SerializeEvaluationState(state));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored,
+                           dpf->CreateEvaluationState(checkpoint));
+  EXPECT_EQ(restored.previous_hierarchy_level(),
+            state.previous_hierarchy_level());
+
+  // The restored state must evaluate identically to the original one.
+  std::vector<absl::uint128> prefixes_2 = {1, alpha >> 5};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint32_t> expected,
+                           dpf->EvaluateUntil<uint32_t>(2, prefixes_2, state));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint32_t> restored_output,
+      dpf->EvaluateUntil<uint32_t>(2, prefixes_2, restored));
+  EXPECT_EQ(restored_output, expected);
+}
+
+TEST(DistributedPointFunction, TestEarlyTerminationShortensKeysForSmallElements) {
+  // For element sizes below 128 bits, the last log2(128 / element_bitsize)
+  // tree levels are replaced by interpreting the final seed block as packed
+  // output elements, so a uint8 DPF over 2^20 needs only 16 tree levels.
+  DpfParameters parameters;
+  parameters.set_log_domain_size(20);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(8);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(12345, uint8_t{42}));
+  EXPECT_EQ(keys.first.correction_words_size(), 16 - 1);
+  EXPECT_EQ(keys.second.correction_words_size(), 16 - 1);
+
+  // The truncated tree must still evaluate correctly.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint8_t> output_0,
+      dpf->EvaluateAt<uint8_t>(keys.first, 0, {12345, 12346}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint8_t> output_1,
+      dpf->EvaluateAt<uint8_t>(keys.second, 0, {12345, 12346}));
+  EXPECT_EQ(uint8_t(output_0[0] + output_1[0]), 42);
+  EXPECT_EQ(uint8_t(output_0[1] + output_1[1]), 0);
+}
+
+TEST(DistributedPointFunction, TestGenerateKeysBatchProducesCorrectKeys) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+
+  std::vector<absl::uint128> alphas = {1, 23, 42, 1023};
+  std::vector<Value> betas(alphas.size());
+  for (int j = 0; j < static_cast<int>(alphas.size()); ++j) {
+    DPF_ASSERT_OK_AND_ASSIGN(betas[j], dpf->ToValue(uint64_t{100 + j}));
+  }
+
+  DPF_ASSERT_OK_AND_ASSIGN(auto key_pairs,
+                           dpf->GenerateKeysBatch(alphas, betas));
+  ASSERT_EQ(key_pairs.size(), alphas.size());
+
+  std::vector<absl::uint128> evaluation_points = {0, 1, 23, 42, 512, 1023};
+  for (int j = 0; j < static_cast<int>(alphas.size()); ++j) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> output_0,
+                             dpf->EvaluateAt<uint64_t>(key_pairs[j].first, 0,
+                                                       evaluation_points));
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<uint64_t> output_1,
+                             dpf->EvaluateAt<uint64_t>(key_pairs[j].second, 0,
+                                                       evaluation_points));
+    for (int i = 0; i < static_cast<int>(evaluation_points.size()); ++i) {
+      uint64_t sum = output_0[i] + output_1[i];
+      if (evaluation_points[i] == alphas[j]) {
+        EXPECT_EQ(sum, 100 + j) << "j=" << j << ", i=" << i;
+      } else {
+        EXPECT_EQ(sum, 0) << "j=" << j << ", i=" << i;
+      }
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestGenerateKeysBatchWorksForIncrementalDpfs) {
+  std::vector<DpfParameters> parameters(2);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(10);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+
+  // Two keys with two betas each, laid out key-major.
+  std::vector<absl::uint128> alphas = {42, 1000};
+  std::vector<Value> betas(4);
+  for (int i = 0; i < 4; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(betas[i], dpf->ToValue(uint32_t{10 + i}));
+  }
+
+  DPF_ASSERT_OK_AND_ASSIGN(auto key_pairs,
+                           dpf->GenerateKeysBatch(alphas, betas));
+  ASSERT_EQ(key_pairs.size(), alphas.size());
+
+  for (int j = 0; j < static_cast<int>(alphas.size()); ++j) {
+    for (int level = 0; level < 2; ++level) {
+      const absl::uint128 alpha_prefix =
+          level == 0 ? alphas[j] >> 5 : alphas[j];
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<uint32_t> output_0,
+          dpf->EvaluateAt<uint32_t>(key_pairs[j].first, level,
+                                    {alpha_prefix, 0}));
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<uint32_t> output_1,
+          dpf->EvaluateAt<uint32_t>(key_pairs[j].second, level,
+                                    {alpha_prefix, 0}));
+      EXPECT_EQ(uint32_t(output_0[0] + output_1[0]), 10 + 2 * j + level)
+          << "j=" << j << ", level=" << level;
+    }
+  }
+}
+
+TEST(DistributedPointFunction, TestGenerateKeysBatchFailsOnInvalidArguments) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DPF_ASSERT_OK_AND_ASSIGN(Value beta, dpf->ToValue(uint64_t{42}));
+
+  EXPECT_THAT(
+      dpf->GenerateKeysBatch({1, 2}, {beta}),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`betas` must have `parameters_.size()` elements per element "
+               "of `alphas`"));
+  EXPECT_THAT(dpf->GenerateKeysBatch({1 << 10}, {beta}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "each element of `alphas` must be smaller than the "
+                       "output domain size"));
+}
+
+TEST(DistributedPointFunction, TestEvaluationScratchMatchesScratchFreeCalls) {
+  std::vector<DpfParameters> parameters(2);
+  parameters[0].set_log_domain_size(5);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  parameters[1].set_log_domain_size(15);
+  parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto dpf, DistributedPointFunction::CreateIncremental(parameters));
+  absl::uint128 alpha = 12345;
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeysIncremental(alpha, {1, 2}));
+
+  // Reuse a single scratch across several calls, so later calls recycle the
+  // buffers retained by earlier ones.
+  EvaluationScratch scratch;
+  for (int iteration = 0; iteration < 3; ++iteration) {
+    DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                             dpf->CreateEvaluationContext(key_a));
+    DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_scratch,
+                             dpf->CreateEvaluationContext(key_a));
+    std::vector<uint32_t> expected(1 << 5), output(1 << 5);
+    DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(0, {}, ctx,
+                                               absl::MakeSpan(expected)));
+    DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(0, {}, ctx_scratch,
+                                               absl::MakeSpan(output),
+                                               scratch));
+    EXPECT_EQ(output, expected) << "iteration=" << iteration;
+
+    std::vector<absl::uint128> prefixes = {0, alpha >> 10};
+    expected.resize(prefixes.size() << 10);
+    output.resize(prefixes.size() << 10);
+    DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(1, prefixes, ctx,
+                                               absl::MakeSpan(expected)));
+    DPF_ASSERT_OK(dpf->EvaluateUntil<uint32_t>(1, prefixes, ctx_scratch,
+                                               absl::MakeSpan(output),
+                                               scratch));
+    EXPECT_EQ(output, expected) << "iteration=" << iteration;
+  }
+}
+
+TEST(DistributedPointFunction, TestEvaluateAtWithScratchMatchesWithout) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(20);
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  DpfKey key_a, key_b;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a, key_b),
+                           dpf->GenerateKeys(/*alpha=*/23,
+                                             /*beta=*/uint64_t{42}));
+  std::vector<absl::uint128> evaluation_points = {1, 23, 42, 12345, 99999};
+
+  EvaluationScratch scratch;
+  for (int iteration = 0; iteration < 3; ++iteration) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> expected,
+        dpf->EvaluateAt<uint64_t>(key_a, 0, evaluation_points));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> output,
+        dpf->EvaluateAt<uint64_t>(key_a, 0, evaluation_points, scratch));
+    EXPECT_EQ(output, expected) << "iteration=" << iteration;
+  }
+  // Clearing the scratch must not affect subsequent calls.
+  scratch.Clear();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> expected,
+      dpf->EvaluateAt<uint64_t>(key_a, 0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> output,
+      dpf->EvaluateAt<uint64_t>(key_a, 0, evaluation_points, scratch));
+  EXPECT_EQ(output, expected);
+}
+
 }  // namespace
 }  // namespace distributed_point_functions
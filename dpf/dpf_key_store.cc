@@ -0,0 +1,161 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/dpf_key_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+absl::StatusOr<DpfKeyStore> DpfKeyStore::Create(const std::string& path,
+                                                int64_t record_size) {
+  if (record_size <= 0) {
+    return absl::InvalidArgumentError("`record_size` must be positive");
+  }
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::InternalError(
+        absl::StrCat("Failed to open `", path, "`: ", strerror(errno)));
+  }
+  struct stat file_info;
+  if (fstat(fd, &file_info) != 0) {
+    close(fd);
+    return absl::InternalError(
+        absl::StrCat("Failed to stat `", path, "`: ", strerror(errno)));
+  }
+  const int64_t file_size = file_info.st_size;
+  if (file_size % record_size != 0) {
+    close(fd);
+    return absl::InvalidArgumentError(absl::StrCat(
+        "File size (", file_size, ") is not a multiple of `record_size` (",
+        record_size, ")"));
+  }
+  const char* data = nullptr;
+  if (file_size > 0) {
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      return absl::InternalError(
+          absl::StrCat("Failed to mmap `", path, "`: ", strerror(errno)));
+    }
+    // Keys are usually consumed in order, so let the kernel read ahead
+    // aggressively. This is only a hint, so a failure is not an error.
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+  }
+  // The mapping stays valid after closing the file descriptor.
+  close(fd);
+  return DpfKeyStore(data, file_size, record_size, file_size / record_size);
+}
+
+absl::StatusOr<int64_t> DpfKeyStore::WriteKeys(
+    const DistributedPointFunction& dpf, absl::Span<const DpfKey> keys,
+    const std::string& path) {
+  std::string buffer;
+  int64_t record_size = 0;
+  for (const DpfKey& key : keys) {
+    DPF_ASSIGN_OR_RETURN(std::string serialized,
+                         dpf.SerializeKeyCompact(key));
+    if (record_size == 0) {
+      record_size = static_cast<int64_t>(serialized.size());
+    } else if (static_cast<int64_t>(serialized.size()) != record_size) {
+      return absl::InvalidArgumentError(
+          "All keys must serialize to the same size");
+    }
+    buffer.append(serialized);
+  }
+  if (record_size == 0) {
+    return absl::InvalidArgumentError("`keys` must not be empty");
+  }
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return absl::InternalError(
+        absl::StrCat("Failed to create `", path, "`: ", strerror(errno)));
+  }
+  size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t result =
+        write(fd, buffer.data() + written, buffer.size() - written);
+    if (result < 0) {
+      close(fd);
+      return absl::InternalError(
+          absl::StrCat("Failed to write `", path, "`: ", strerror(errno)));
+    }
+    written += result;
+  }
+  close(fd);
+  return record_size;
+}
+
+DpfKeyStore::DpfKeyStore(DpfKeyStore&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      mapped_size_(other.mapped_size_),
+      record_size_(other.record_size_),
+      num_records_(other.num_records_) {}
+
+DpfKeyStore& DpfKeyStore::operator=(DpfKeyStore&& other) noexcept {
+  if (this != &other) {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), mapped_size_);
+    }
+    data_ = std::exchange(other.data_, nullptr);
+    mapped_size_ = other.mapped_size_;
+    record_size_ = other.record_size_;
+    num_records_ = other.num_records_;
+  }
+  return *this;
+}
+
+DpfKeyStore::~DpfKeyStore() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), mapped_size_);
+  }
+}
+
+absl::StatusOr<absl::string_view> DpfKeyStore::GetSerializedKey(
+    int64_t index) const {
+  if (index < 0 || index >= num_records_) {
+    return absl::OutOfRangeError(absl::StrCat("`index` (", index,
+                                              ") must be in [0, ",
+                                              num_records_, ")"));
+  }
+  const char* record = data_ + index * record_size_;
+#if defined(__GNUC__) || defined(__clang__)
+  // Hide the latency of the next record behind parsing the current one when
+  // iterating in order.
+  if (index + 1 < num_records_) {
+    __builtin_prefetch(record + record_size_);
+  }
+#endif
+  return absl::string_view(record, record_size_);
+}
+
+absl::StatusOr<DpfKey> DpfKeyStore::GetKey(const DistributedPointFunction& dpf,
+                                           int64_t index) const {
+  DPF_ASSIGN_OR_RETURN(absl::string_view serialized, GetSerializedKey(index));
+  return dpf.ParseKeyCompact(serialized);
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,108 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_DPF_KEY_STORE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_DPF_KEY_STORE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+
+namespace distributed_point_functions {
+
+// A read-only store of DPF keys backed by a memory-mapped file of fixed-size
+// records. Each record is a key serialized with
+// `DistributedPointFunction::SerializeKeyCompact`, whose size is determined by
+// the DPF parameters, so records can be addressed by index without any
+// per-record framing. Keys are read directly from the mapping without copying,
+// which avoids per-key proto parsing and heap allocation when streaming large
+// numbers of keys from disk.
+//
+// The mapping is advised for sequential access, and reading a record prefetches
+// the following one, so iterating keys in order is I/O-bound rather than
+// CPU-bound.
+//
+// Thread-safe: all methods are const and the underlying mapping is read-only.
+class DpfKeyStore {
+ public:
+  // Memory-maps the file at `path`, containing records of `record_size` bytes
+  // each.
+  //
+  // Returns INVALID_ARGUMENT if `record_size` is not positive or the file size
+  // is not a multiple of `record_size`, and INTERNAL if opening or mapping the
+  // file fails.
+  static absl::StatusOr<DpfKeyStore> Create(const std::string& path,
+                                            int64_t record_size);
+
+  // Serializes `keys` with `dpf.SerializeKeyCompact` and writes them to a new
+  // file at `path`, replacing any existing file. On success, returns the
+  // record size to pass to `Create`.
+  //
+  // Returns INVALID_ARGUMENT if any key is invalid for `dpf` or the keys don't
+  // all serialize to the same size, and INTERNAL if writing fails.
+  static absl::StatusOr<int64_t> WriteKeys(
+      const DistributedPointFunction& dpf, absl::Span<const DpfKey> keys,
+      const std::string& path);
+
+  // DpfKeyStore is move-only. Moved-from stores may only be destroyed or
+  // assigned to.
+  DpfKeyStore(DpfKeyStore&& other) noexcept;
+  DpfKeyStore& operator=(DpfKeyStore&& other) noexcept;
+  DpfKeyStore(const DpfKeyStore&) = delete;
+  DpfKeyStore& operator=(const DpfKeyStore&) = delete;
+
+  ~DpfKeyStore();
+
+  // Returns the number of key records in the store.
+  int64_t size() const { return num_records_; }
+
+  // Returns a view of the serialized key at `index`, valid as long as this
+  // store is alive. Prefetches the next record.
+  //
+  // Returns OUT_OF_RANGE if `index` is not in `[0, size())`.
+  absl::StatusOr<absl::string_view> GetSerializedKey(int64_t index) const;
+
+  // Parses the key at `index` with `dpf.ParseKeyCompact`. `dpf` must have been
+  // created with the same parameters as the DPF that wrote the store.
+  //
+  // Returns OUT_OF_RANGE if `index` is not in `[0, size())`, and
+  // INVALID_ARGUMENT if the record is not a valid compact key for `dpf`.
+  absl::StatusOr<DpfKey> GetKey(const DistributedPointFunction& dpf,
+                                int64_t index) const;
+
+ private:
+  DpfKeyStore(const char* data, int64_t mapped_size, int64_t record_size,
+              int64_t num_records)
+      : data_(data),
+        mapped_size_(mapped_size),
+        record_size_(record_size),
+        num_records_(num_records) {}
+
+  // Start of the read-only mapping, or nullptr if moved-from. The store owns
+  // the mapping and unmaps it on destruction.
+  const char* data_;
+  int64_t mapped_size_;
+  int64_t record_size_;
+  int64_t num_records_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_DPF_KEY_STORE_H_
@@ -0,0 +1,124 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/dpf_key_store.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/status_matchers.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+
+class DpfKeyStoreTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    DpfParameters parameters;
+    parameters.set_log_domain_size(10);
+    parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+    DPF_ASSERT_OK_AND_ASSIGN(dpf_,
+                             DistributedPointFunction::Create(parameters));
+    for (int i = 0; i < 4; ++i) {
+      DPF_ASSERT_OK_AND_ASSIGN(auto key_pair,
+                               dpf_->GenerateKeys(/*alpha=*/23 + i,
+                                                  /*beta=*/uint64_t{42}));
+      keys_.push_back(std::move(key_pair.first));
+    }
+    path_ = absl::StrCat(testing::TempDir(), "/dpf_key_store_test.keys");
+    DPF_ASSERT_OK_AND_ASSIGN(record_size_,
+                             DpfKeyStore::WriteKeys(*dpf_, keys_, path_));
+  }
+
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::vector<DpfKey> keys_;
+  std::string path_;
+  int64_t record_size_;
+};
+
+TEST_F(DpfKeyStoreTest, ReturnsKeysMatchingOriginals) {
+  DPF_ASSERT_OK_AND_ASSIGN(DpfKeyStore store,
+                           DpfKeyStore::Create(path_, record_size_));
+  ASSERT_EQ(store.size(), static_cast<int64_t>(keys_.size()));
+
+  std::vector<absl::uint128> evaluation_points = {1, 23, 24, 512};
+  for (int64_t i = 0; i < store.size(); ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(DpfKey key, store.GetKey(*dpf_, i));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> output,
+        dpf_->EvaluateAt<uint64_t>(key, 0, evaluation_points));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> expected,
+        dpf_->EvaluateAt<uint64_t>(keys_[i], 0, evaluation_points));
+    EXPECT_EQ(output, expected) << "i=" << i;
+  }
+}
+
+TEST_F(DpfKeyStoreTest, SerializedRecordsMatchSerializeKeyCompact) {
+  DPF_ASSERT_OK_AND_ASSIGN(DpfKeyStore store,
+                           DpfKeyStore::Create(path_, record_size_));
+  for (int64_t i = 0; i < store.size(); ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(absl::string_view record,
+                             store.GetSerializedKey(i));
+    DPF_ASSERT_OK_AND_ASSIGN(std::string expected,
+                             dpf_->SerializeKeyCompact(keys_[i]));
+    EXPECT_EQ(record, expected) << "i=" << i;
+  }
+}
+
+TEST_F(DpfKeyStoreTest, GetKeyFailsOnIndexOutOfRange) {
+  DPF_ASSERT_OK_AND_ASSIGN(DpfKeyStore store,
+                           DpfKeyStore::Create(path_, record_size_));
+  EXPECT_THAT(store.GetKey(*dpf_, -1),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_THAT(store.GetKey(*dpf_, store.size()),
+              StatusIs(absl::StatusCode::kOutOfRange));
+}
+
+TEST_F(DpfKeyStoreTest, CreateFailsOnMismatchedRecordSize) {
+  EXPECT_THAT(DpfKeyStore::Create(path_, record_size_ + 1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(DpfKeyStoreTest, CreateFailsOnNonPositiveRecordSize) {
+  EXPECT_THAT(DpfKeyStore::Create(path_, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`record_size` must be positive"));
+}
+
+TEST_F(DpfKeyStoreTest, CreateFailsOnMissingFile) {
+  EXPECT_THAT(
+      DpfKeyStore::Create(absl::StrCat(path_, ".does_not_exist"), record_size_),
+      StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST_F(DpfKeyStoreTest, WriteKeysFailsOnEmptyKeys) {
+  EXPECT_THAT(DpfKeyStore::WriteKeys(*dpf_, {}, path_),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`keys` must not be empty"));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,320 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/evaluation_state_io.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/config.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "dpf/internal/packed_control_bits.h"
+#include "dpf/status_macros.h"
+#include "hwy/aligned_allocator.h"
+#include "riegeli/bytes/fd_reader.h"
+#include "riegeli/bytes/fd_writer.h"
+#include "riegeli/endian/endian_reading.h"
+#include "riegeli/endian/endian_writing.h"
+
+namespace distributed_point_functions {
+
+namespace dpf_internal {
+
+// Grants the checkpoint code access to the private fields of
+// `EvaluationState`; befriended there.
+class EvaluationStateIoAccess {
+ public:
+  static const DpfKey& Key(const EvaluationState& state) { return state.key_; }
+  static int PreviousHierarchyLevel(const EvaluationState& state) {
+    return state.previous_hierarchy_level_;
+  }
+  static int PartialEvaluationsLevel(const EvaluationState& state) {
+    return state.partial_evaluations_level_;
+  }
+  static const std::vector<absl::uint128>& PartialPrefixes(
+      const EvaluationState& state) {
+    return state.partial_prefixes_;
+  }
+  static const absl::uint128* PartialSeeds(const EvaluationState& state) {
+    return state.partial_seeds_.get();
+  }
+  static const PackedControlBits& PartialControlBits(
+      const EvaluationState& state) {
+    return state.partial_control_bits_;
+  }
+  static void SetPartialEvaluations(
+      EvaluationState& state, int previous_hierarchy_level,
+      int partial_evaluations_level, std::vector<absl::uint128> prefixes,
+      hwy::AlignedFreeUniquePtr<absl::uint128[]> seeds,
+      PackedControlBits control_bits) {
+    state.previous_hierarchy_level_ = previous_hierarchy_level;
+    state.partial_evaluations_level_ = partial_evaluations_level;
+    state.partial_prefixes_ = std::move(prefixes);
+    state.partial_seeds_ = std::move(seeds);
+    state.partial_control_bits_ = std::move(control_bits);
+  }
+};
+
+}  // namespace dpf_internal
+
+namespace {
+
+using Access = dpf_internal::EvaluationStateIoAccess;
+
+// Checkpoint layout, all integers little-endian:
+//   kMagic, kVersion,
+//   key size (u64), serialized `DpfKey`,
+//   previous_hierarchy_level (i32), partial_evaluations_level (i32),
+//   number of partial evaluations n (u64),
+//   n prefixes (16 bytes each, low word first),
+//   n seeds (16 bytes each, low word first),
+//   control bits packed into ceil(n / 64) u64 words.
+constexpr char kMagic[] = "DPFSTATE";
+constexpr size_t kMagicSize = 8;
+constexpr uint32_t kVersion = 1;
+
+// Writes `size` 128-bit values as fixed-width little-endian records. On
+// little-endian machines this is a single bulk write of the array's bytes,
+// which is what keeps large spills at I/O line rate.
+absl::Status WriteUint128Array(const absl::uint128* data, int64_t size,
+                               riegeli::Writer& writer) {
+  if (size == 0) return absl::OkStatus();
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+  if (!writer.Write(absl::string_view(reinterpret_cast<const char*>(data),
+                                      size * sizeof(absl::uint128)))) {
+    return writer.status();
+  }
+#else
+  for (int64_t i = 0; i < size; ++i) {
+    if (!riegeli::WriteLittleEndian64(absl::Uint128Low64(data[i]), writer) ||
+        !riegeli::WriteLittleEndian64(absl::Uint128High64(data[i]), writer)) {
+      return writer.status();
+    }
+  }
+#endif
+  return absl::OkStatus();
+}
+
+// Returns the reader's status if it failed, and INVALID_ARGUMENT for a clean
+// end-of-data in the middle of a checkpoint.
+absl::Status FailedRead(riegeli::Reader& reader) {
+  if (!reader.ok()) return reader.status();
+  return absl::InvalidArgumentError(
+      "Unexpected end of data in evaluation state checkpoint");
+}
+
+absl::Status ReadUint128Array(absl::uint128* data, int64_t size,
+                              riegeli::Reader& reader) {
+  if (size == 0) return absl::OkStatus();
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+  if (!reader.Read(size * sizeof(absl::uint128),
+                   reinterpret_cast<char*>(data))) {
+    return FailedRead(reader);
+  }
+#else
+  for (int64_t i = 0; i < size; ++i) {
+    uint64_t low, high;
+    if (!riegeli::ReadLittleEndian64(reader, low) ||
+        !riegeli::ReadLittleEndian64(reader, high)) {
+      return FailedRead(reader);
+    }
+    data[i] = absl::MakeUint128(high, low);
+  }
+#endif
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status SaveEvaluationState(const EvaluationState& state,
+                                 riegeli::Writer& writer) {
+  std::string serialized_key;
+  if (!Access::Key(state).SerializeToString(&serialized_key)) {
+    return absl::InternalError("Failed to serialize `state.key()`");
+  }
+  const std::vector<absl::uint128>& prefixes = Access::PartialPrefixes(state);
+  const auto num_partial_evaluations = static_cast<int64_t>(prefixes.size());
+  if (!writer.Write(absl::string_view(kMagic, kMagicSize)) ||
+      !riegeli::WriteLittleEndian32(kVersion, writer) ||
+      !riegeli::WriteLittleEndian64(serialized_key.size(), writer) ||
+      !writer.Write(serialized_key) ||
+      !riegeli::WriteLittleEndian32(
+          static_cast<uint32_t>(Access::PreviousHierarchyLevel(state)),
+          writer) ||
+      !riegeli::WriteLittleEndian32(
+          static_cast<uint32_t>(Access::PartialEvaluationsLevel(state)),
+          writer) ||
+      !riegeli::WriteLittleEndian64(
+          static_cast<uint64_t>(num_partial_evaluations), writer)) {
+    return writer.status();
+  }
+  DPF_RETURN_IF_ERROR(
+      WriteUint128Array(prefixes.data(), num_partial_evaluations, writer));
+  DPF_RETURN_IF_ERROR(WriteUint128Array(Access::PartialSeeds(state),
+                                        num_partial_evaluations, writer));
+  if (!riegeli::WriteLittleEndian64s(
+          absl::MakeConstSpan(
+              Access::PartialControlBits(state).words(),
+              dpf_internal::PackedControlBits::NumWords(
+                  num_partial_evaluations)),
+          writer)) {
+    return writer.status();
+  }
+  if (!writer.Flush()) {
+    return writer.status();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SaveEvaluationStateToFile(const EvaluationState& state,
+                                       absl::string_view path) {
+  riegeli::FdWriter writer((std::string(path)));
+  DPF_RETURN_IF_ERROR(SaveEvaluationState(state, writer));
+  if (!writer.Close()) {
+    return writer.status();
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<EvaluationState> RestoreEvaluationState(
+    const DistributedPointFunction& dpf, riegeli::Reader& reader) {
+  char magic[kMagicSize];
+  if (!reader.Read(kMagicSize, magic)) {
+    return FailedRead(reader);
+  }
+  if (std::memcmp(magic, kMagic, kMagicSize) != 0) {
+    return absl::InvalidArgumentError(
+        "Data does not start with an evaluation state checkpoint");
+  }
+  uint32_t version;
+  if (!riegeli::ReadLittleEndian32(reader, version)) {
+    return FailedRead(reader);
+  }
+  if (version != kVersion) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unsupported evaluation state checkpoint version: ", version));
+  }
+  uint64_t key_size;
+  if (!riegeli::ReadLittleEndian64(reader, key_size)) {
+    return FailedRead(reader);
+  }
+  if (key_size > std::numeric_limits<int32_t>::max()) {
+    return absl::InvalidArgumentError(
+        "Invalid key size in evaluation state checkpoint");
+  }
+  std::string serialized_key;
+  if (!reader.Read(key_size, serialized_key)) {
+    return FailedRead(reader);
+  }
+  DpfKey key;
+  if (!key.ParseFromString(serialized_key)) {
+    return absl::InvalidArgumentError(
+        "Failed to parse `DpfKey` from evaluation state checkpoint");
+  }
+  // Validates the key against `dpf`'s parameters, exactly as creating a fresh
+  // state would.
+  DPF_ASSIGN_OR_RETURN(EvaluationState state,
+                       dpf.CreateEvaluationState(std::move(key)));
+
+  uint32_t previous_hierarchy_level_bits, partial_evaluations_level_bits;
+  uint64_t num_partial_evaluations_bits;
+  if (!riegeli::ReadLittleEndian32(reader, previous_hierarchy_level_bits) ||
+      !riegeli::ReadLittleEndian32(reader, partial_evaluations_level_bits) ||
+      !riegeli::ReadLittleEndian64(reader, num_partial_evaluations_bits)) {
+    return FailedRead(reader);
+  }
+  const int num_hierarchy_levels = static_cast<int>(dpf.parameters().size());
+  const auto previous_hierarchy_level =
+      static_cast<int32_t>(previous_hierarchy_level_bits);
+  const auto partial_evaluations_level =
+      static_cast<int32_t>(partial_evaluations_level_bits);
+  if (previous_hierarchy_level < -1 ||
+      previous_hierarchy_level >= num_hierarchy_levels ||
+      partial_evaluations_level < 0 ||
+      partial_evaluations_level >= num_hierarchy_levels) {
+    return absl::InvalidArgumentError(
+        "Hierarchy level out of range in evaluation state checkpoint");
+  }
+  if (num_partial_evaluations_bits >
+      static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) /
+          sizeof(absl::uint128)) {
+    return absl::InvalidArgumentError(
+        "Invalid number of partial evaluations in evaluation state "
+        "checkpoint");
+  }
+  const auto num_partial_evaluations =
+      static_cast<int64_t>(num_partial_evaluations_bits);
+  if (previous_hierarchy_level < 0 && num_partial_evaluations != 0) {
+    return absl::InvalidArgumentError(
+        "Evaluation state checkpoint has partial evaluations but no previous "
+        "hierarchy level");
+  }
+
+  std::vector<absl::uint128> prefixes(num_partial_evaluations);
+  DPF_RETURN_IF_ERROR(
+      ReadUint128Array(prefixes.data(), num_partial_evaluations, reader));
+  for (int64_t i = 1; i < num_partial_evaluations; ++i) {
+    if (prefixes[i] <= prefixes[i - 1]) {
+      return absl::InvalidArgumentError(
+          "Prefixes in evaluation state checkpoint must be sorted and "
+          "unique");
+    }
+  }
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> seeds;
+  if (num_partial_evaluations > 0) {
+    seeds = hwy::AllocateAligned<absl::uint128>(num_partial_evaluations);
+    if (seeds == nullptr) {
+      return absl::ResourceExhaustedError("Memory allocation error");
+    }
+  }
+  DPF_RETURN_IF_ERROR(
+      ReadUint128Array(seeds.get(), num_partial_evaluations, reader));
+  dpf_internal::PackedControlBits control_bits;
+  control_bits.Resize(num_partial_evaluations);
+  if (!riegeli::ReadLittleEndian64s(
+          reader, absl::MakeSpan(control_bits.words(),
+                                 dpf_internal::PackedControlBits::NumWords(
+                                     num_partial_evaluations)))) {
+    return FailedRead(reader);
+  }
+  // Re-mask bits beyond `num_partial_evaluations` in the last word, in case
+  // the checkpoint data left them set.
+  control_bits.Resize(num_partial_evaluations);
+
+  Access::SetPartialEvaluations(state, previous_hierarchy_level,
+                                partial_evaluations_level, std::move(prefixes),
+                                std::move(seeds), std::move(control_bits));
+  return state;
+}
+
+absl::StatusOr<EvaluationState> RestoreEvaluationStateFromFile(
+    const DistributedPointFunction& dpf, absl::string_view path) {
+  riegeli::FdReader reader((std::string(path)));
+  DPF_ASSIGN_OR_RETURN(EvaluationState state,
+                       RestoreEvaluationState(dpf, reader));
+  if (!reader.Close()) {
+    return reader.status();
+  }
+  return state;
+}
+
+}  // namespace distributed_point_functions
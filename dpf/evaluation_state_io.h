@@ -0,0 +1,81 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_EVALUATION_STATE_IO_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_EVALUATION_STATE_IO_H_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dpf/distributed_point_function.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/writer.h"
+
+namespace distributed_point_functions {
+
+// A compact checkpoint format for `EvaluationState`, for jobs that keep many
+// states alive between hierarchy levels and spill them to disk between
+// rounds. The proto round-trip via `SerializeEvaluationState` builds one
+// `PartialEvaluation` submessage (with nested `Block`s) per prefix, which is
+// both bloated in RAM and slow to serialize at millions of prefixes. This
+// format instead streams the in-memory frontier directly: a small header
+// (key, hierarchy levels), followed by the prefix and seed arrays as
+// fixed-width little-endian 128-bit records and the control bits as packed
+// words, so saving and restoring is bounded by I/O bandwidth rather than
+// proto construction.
+//
+// The streaming overloads accept any riegeli writer/reader, so callers can
+// layer compression or custom destinations (e.g.
+// `riegeli::ZstdWriter<riegeli::FdWriter<>>`); seeds are pseudorandom and
+// barely compress, but prefix arrays often do. The file overloads write
+// uncompressed to a local path.
+//
+// The retained-expansion cache (`EvaluationState::set_retain_expansion`) is
+// not part of the checkpoint, matching `SerializeEvaluationState`: a restored
+// state falls back to the regular partial-evaluations path for its first
+// call.
+
+// Writes `state` to `writer` in checkpoint format. The writer is flushed but
+// not closed, so further data may be appended (e.g. the next state when
+// spilling several per file).
+//
+// Returns the writer's status if writing fails, and INTERNAL if the state's
+// key cannot be serialized.
+absl::Status SaveEvaluationState(const EvaluationState& state,
+                                 riegeli::Writer& writer);
+
+// As above, writing to a newly created (or truncated) file at `path`.
+absl::Status SaveEvaluationStateToFile(const EvaluationState& state,
+                                       absl::string_view path);
+
+// Reads an `EvaluationState` in checkpoint format from `reader`, leaving the
+// reader positioned after the checkpoint. The contained key is validated
+// against `dpf` as in `DistributedPointFunction::CreateEvaluationState`, so
+// the restored state can be passed to `EvaluateUntil` without further checks.
+// `dpf` must be the instance (or an identically parameterized one) that
+// produced the saved state.
+//
+// Returns INVALID_ARGUMENT if the data is not a valid checkpoint or is
+// inconsistent with `dpf`'s parameters, and the reader's status on read
+// failures.
+absl::StatusOr<EvaluationState> RestoreEvaluationState(
+    const DistributedPointFunction& dpf, riegeli::Reader& reader);
+
+// As above, reading from the file at `path`.
+absl::StatusOr<EvaluationState> RestoreEvaluationStateFromFile(
+    const DistributedPointFunction& dpf, absl::string_view path);
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_EVALUATION_STATE_IO_H_
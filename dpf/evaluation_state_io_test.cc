@@ -0,0 +1,196 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/evaluation_state_io.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/status_matchers.h"
+#include "riegeli/bytes/string_reader.h"
+#include "riegeli/bytes/string_writer.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::StartsWith;
+
+class EvaluationStateIoTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    std::vector<DpfParameters> parameters(3);
+    parameters[0].set_log_domain_size(5);
+    parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+    parameters[1].set_log_domain_size(10);
+    parameters[1].mutable_value_type()->mutable_integer()->set_bitsize(32);
+    parameters[2].set_log_domain_size(15);
+    parameters[2].mutable_value_type()->mutable_integer()->set_bitsize(32);
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dpf_, DistributedPointFunction::CreateIncremental(parameters));
+    DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_a_, key_b_),
+                             dpf_->GenerateKeysIncremental(alpha_, {1, 2, 3}));
+  }
+
+  absl::uint128 alpha_ = 12345;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  DpfKey key_a_, key_b_;
+};
+
+TEST_F(EvaluationStateIoTest, RoundTripMatchesUninterruptedEvaluation) {
+  // Evaluate two levels, spill to a string, restore, and check that the
+  // restored state continues exactly like the original.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf_->CreateEvaluationState(key_a_));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(0, {}, state).status());
+  std::vector<absl::uint128> prefixes_1 = {0, alpha_ >> 10, 31};
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(1, prefixes_1, state).status());
+
+  std::string checkpoint;
+  riegeli::StringWriter writer(&checkpoint);
+  DPF_ASSERT_OK(SaveEvaluationState(state, writer));
+  ASSERT_TRUE(writer.Close());
+  EXPECT_FALSE(checkpoint.empty());
+
+  riegeli::StringReader reader(checkpoint);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored,
+                           RestoreEvaluationState(*dpf_, reader));
+  ASSERT_TRUE(reader.Close());
+  EXPECT_EQ(restored.previous_hierarchy_level(),
+            state.previous_hierarchy_level());
+
+  std::vector<absl::uint128> prefixes_2 = {1, alpha_ >> 5, (31 << 5) + 7};
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint32_t> expected,
+      dpf_->EvaluateUntil<uint32_t>(2, prefixes_2, state));
+  EXPECT_THAT(dpf_->EvaluateUntil<uint32_t>(2, prefixes_2, restored),
+              IsOkAndHolds(expected));
+}
+
+TEST_F(EvaluationStateIoTest, RoundTripOfFreshState) {
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf_->CreateEvaluationState(key_a_));
+  std::string checkpoint;
+  riegeli::StringWriter writer(&checkpoint);
+  DPF_ASSERT_OK(SaveEvaluationState(state, writer));
+  ASSERT_TRUE(writer.Close());
+
+  riegeli::StringReader reader(checkpoint);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored,
+                           RestoreEvaluationState(*dpf_, reader));
+  EXPECT_EQ(restored.previous_hierarchy_level(), -1);
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(0, {}, restored).status());
+}
+
+TEST_F(EvaluationStateIoTest, SeveralStatesPerStream) {
+  // Spilling thousands of states appends them to a shared stream; check that
+  // two checkpoints restore back-to-back from one reader.
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state_a,
+                           dpf_->CreateEvaluationState(key_a_));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state_b,
+                           dpf_->CreateEvaluationState(key_b_));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(0, {}, state_a).status());
+
+  std::string checkpoint;
+  riegeli::StringWriter writer(&checkpoint);
+  DPF_ASSERT_OK(SaveEvaluationState(state_a, writer));
+  DPF_ASSERT_OK(SaveEvaluationState(state_b, writer));
+  ASSERT_TRUE(writer.Close());
+
+  riegeli::StringReader reader(checkpoint);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored_a,
+                           RestoreEvaluationState(*dpf_, reader));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored_b,
+                           RestoreEvaluationState(*dpf_, reader));
+  EXPECT_EQ(restored_a.previous_hierarchy_level(), 0);
+  EXPECT_EQ(restored_b.previous_hierarchy_level(), -1);
+  EXPECT_EQ(restored_a.key().party(), key_a_.party());
+  EXPECT_EQ(restored_b.key().party(), key_b_.party());
+}
+
+TEST_F(EvaluationStateIoTest, FileRoundTrip) {
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf_->CreateEvaluationState(key_a_));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(0, {}, state).status());
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(1, {alpha_ >> 10}, state).status());
+
+  const std::string path =
+      absl::StrCat(testing::TempDir(), "/evaluation_state_io_test.state");
+  DPF_ASSERT_OK(SaveEvaluationStateToFile(state, path));
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState restored,
+                           RestoreEvaluationStateFromFile(*dpf_, path));
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint32_t> expected,
+      dpf_->EvaluateUntil<uint32_t>(2, {alpha_ >> 5}, state));
+  EXPECT_THAT(dpf_->EvaluateUntil<uint32_t>(2, {alpha_ >> 5}, restored),
+              IsOkAndHolds(expected));
+}
+
+TEST_F(EvaluationStateIoTest, RestoreFailsOnGarbage) {
+  std::string garbage = "this is not a checkpoint";
+  riegeli::StringReader reader(garbage);
+  EXPECT_THAT(RestoreEvaluationState(*dpf_, reader),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       StartsWith("Data does not start")));
+}
+
+TEST_F(EvaluationStateIoTest, RestoreFailsOnTruncatedCheckpoint) {
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf_->CreateEvaluationState(key_a_));
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(0, {}, state).status());
+  DPF_ASSERT_OK(dpf_->EvaluateUntil<uint32_t>(1, {0, 1}, state).status());
+
+  std::string checkpoint;
+  riegeli::StringWriter writer(&checkpoint);
+  DPF_ASSERT_OK(SaveEvaluationState(state, writer));
+  ASSERT_TRUE(writer.Close());
+
+  std::string truncated = checkpoint.substr(0, checkpoint.size() - 8);
+  riegeli::StringReader reader(truncated);
+  EXPECT_THAT(RestoreEvaluationState(*dpf_, reader).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(EvaluationStateIoTest, RestoreFailsOnMismatchingParameters) {
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationState state,
+                           dpf_->CreateEvaluationState(key_a_));
+  std::string checkpoint;
+  riegeli::StringWriter writer(&checkpoint);
+  DPF_ASSERT_OK(SaveEvaluationState(state, writer));
+  ASSERT_TRUE(writer.Close());
+
+  // A `DistributedPointFunction` with different parameters rejects the key.
+  DpfParameters other_parameters;
+  other_parameters.set_log_domain_size(20);
+  other_parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto other_dpf,
+                           DistributedPointFunction::Create(other_parameters));
+  riegeli::StringReader reader(checkpoint);
+  EXPECT_THAT(RestoreEvaluationState(*other_dpf, reader).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
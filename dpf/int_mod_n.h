@@ -25,6 +25,8 @@
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "dpf/internal/int_mod_n_hwy.h"
 
 namespace distributed_point_functions {
 
@@ -204,6 +206,109 @@ class IntModNImpl : public IntModNBase {
     return absl::OkStatus();
   }
 
+  // As `SampleFromBytes`, but extracts samples from `num_batches` independent
+  // byte streams laid out contiguously in `bytes`. Each stream consists of
+  // `GetNumBytesRequired(samples.size() / num_batches, security_parameter)`
+  // bytes, and the samples extracted from the j-th stream are written to the
+  // j-th contiguous chunk of `samples`, which is equivalent to calling
+  // `SampleFromBytes` once per stream.
+  //
+  // Extracting samples from a single stream is inherently sequential, since
+  // every sample updates the 128-bit accumulator the next one is drawn from.
+  // This function interleaves the extraction of the independent streams, so
+  // the CPU can overlap the modular reductions of different streams instead
+  // of stalling on a single dependency chain.
+  static absl::Status SampleBatchFromBytes(absl::string_view bytes,
+                                           int num_batches,
+                                           double security_parameter,
+                                           absl::Span<IntModNImpl> samples) {
+    if (num_batches <= 0) {
+      return absl::InvalidArgumentError("`num_batches` must be positive");
+    }
+    if (samples.empty() ||
+        samples.size() % static_cast<size_t>(num_batches) != 0) {
+      return absl::InvalidArgumentError(
+          "`samples.size()` must be a positive multiple of `num_batches`");
+    }
+    const int samples_per_batch =
+        static_cast<int>(samples.size()) / num_batches;
+    absl::StatusOr<int> bytes_per_batch =
+        GetNumBytesRequired(samples_per_batch, security_parameter);
+    if (!bytes_per_batch.ok()) {
+      return bytes_per_batch.status();
+    }
+    if (static_cast<int64_t>(num_batches) * *bytes_per_batch >
+        static_cast<int64_t>(bytes.size())) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("The number of bytes provided (", bytes.size(),
+                       ") is insufficient for the required "
+                       "statistical security and number of samples."));
+    }
+
+    absl::InlinedVector<absl::uint128, 8> r(num_batches);
+    for (int j = 0; j < num_batches; ++j) {
+      r[j] = ConvertBytesTo<absl::uint128>(
+          bytes.substr(j * *bytes_per_batch, 16));
+    }
+    for (int i = 0; i < samples_per_batch; ++i) {
+      for (int j = 0; j < num_batches; ++j) {
+        samples[j * samples_per_batch + i] =
+            IntModNImpl(static_cast<BaseInteger>(r[j] % kModulus));
+        if (i < samples_per_batch - 1) {
+          r[j] /= kModulus;
+          if (sizeof(BaseInteger) < sizeof(absl::uint128)) {
+            r[j] <<= (sizeof(BaseInteger) * 8);
+          }
+          r[j] |= ConvertBytesTo<BaseInteger>(bytes.substr(
+              j * *bytes_per_batch + 16 + i * sizeof(BaseInteger),
+              sizeof(BaseInteger)));
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Adds the elements of `a` and `b` pointwise and writes the sums to `out`,
+  // which may alias `a` or `b`. All three spans must have the same size. For
+  // 32-bit and 64-bit base integers the addition is performed with a
+  // vectorized kernel; all other base integer types use the scalar operators.
+  static void AddBatch(absl::Span<const IntModNImpl> a,
+                       absl::Span<const IntModNImpl> b,
+                       absl::Span<IntModNImpl> out) {
+    DCHECK(a.size() == b.size() && a.size() == out.size());
+    // IntModNImpl's only data member is a BaseInteger, so spans of IntModNImpl
+    // can be reinterpreted as base integer arrays for the kernel.
+    static_assert(sizeof(IntModNImpl) == sizeof(BaseInteger),
+                  "IntModNImpl must have the same layout as BaseInteger");
+    if (!TryAddModBatch(static_cast<int64_t>(out.size()),
+                        reinterpret_cast<const BaseInteger*>(a.data()),
+                        reinterpret_cast<const BaseInteger*>(b.data()),
+                        static_cast<BaseInteger>(kModulus),
+                        reinterpret_cast<BaseInteger*>(out.data()))) {
+      for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = a[i] + b[i];
+      }
+    }
+  }
+
+  // As `AddBatch`, but writes the pointwise differences `a - b` to `out`.
+  static void SubtractBatch(absl::Span<const IntModNImpl> a,
+                            absl::Span<const IntModNImpl> b,
+                            absl::Span<IntModNImpl> out) {
+    DCHECK(a.size() == b.size() && a.size() == out.size());
+    static_assert(sizeof(IntModNImpl) == sizeof(BaseInteger),
+                  "IntModNImpl must have the same layout as BaseInteger");
+    if (!TrySubModBatch(static_cast<int64_t>(out.size()),
+                        reinterpret_cast<const BaseInteger*>(a.data()),
+                        reinterpret_cast<const BaseInteger*>(b.data()),
+                        static_cast<BaseInteger>(kModulus),
+                        reinterpret_cast<BaseInteger*>(out.data()))) {
+      for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = a[i] - b[i];
+      }
+    }
+  }
+
  private:
   constexpr void SubtractBaseInteger(const BaseInteger& a) {
     if (value_ >= a) {
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <glog/logging.h>
 #include <openssl/rand.h>
 
 #include "absl/status/status.h"
@@ -45,5 +46,39 @@ void BM_Sample(benchmark::State& state) {
 }
 BENCHMARK(BM_Sample)->Range(1, 1 << 20);
 
+void BM_SampleBatch(benchmark::State& state) {
+  int num_batches = state.range(0);
+  double security_parameter = 40 + std::log2(num_batches);
+  const int bytes_per_batch =
+      MyInt::GetNumBytesRequired(kNumSamples, security_parameter).value();
+  std::vector<uint8_t> bytes(static_cast<int64_t>(num_batches) *
+                             bytes_per_batch);
+  RAND_bytes(bytes.data(), bytes.size());
+  std::vector<MyInt> output(num_batches * kNumSamples);
+  for (auto s : state) {
+    absl::Status status = MyInt::SampleBatchFromBytes(
+        absl::string_view(reinterpret_cast<const char*>(bytes.data()),
+                          bytes.size()),
+        num_batches, security_parameter, absl::MakeSpan(output));
+    CHECK(status.ok());
+    benchmark::DoNotOptimize(output);
+  }
+}
+BENCHMARK(BM_SampleBatch)->Range(1, 1 << 20);
+
+void BM_AddBatch(benchmark::State& state) {
+  int num_elements = state.range(0);
+  std::vector<MyInt> a(num_elements), b(num_elements), out(num_elements);
+  for (int i = 0; i < num_elements; ++i) {
+    a[i] = MyInt(MyInt::modulus() - 1 - i % 13);
+    b[i] = MyInt(static_cast<uint32_t>(i));
+  }
+  for (auto s : state) {
+    MyInt::AddBatch(a, b, absl::MakeSpan(out));
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_AddBatch)->Range(1, 1 << 20);
+
 }  // namespace
 }  // namespace distributed_point_functions
@@ -151,6 +151,91 @@ TYPED_TEST(IntModNTest, FirstEntryOfSamplesIsAsExpected) {
           TypeParam::modulus());
 }
 
+TYPED_TEST(IntModNTest, AddBatchMatchesScalarOperators) {
+  constexpr int kBatchSize = 100;
+  std::vector<TypeParam> a(kBatchSize), b(kBatchSize), sum(kBatchSize),
+      difference(kBatchSize);
+  for (int i = 0; i < kBatchSize; ++i) {
+    // Include values close to the modulus to exercise wrap-around.
+    a[i] = TypeParam(TypeParam::modulus() - 1 - i % 7);
+    b[i] = TypeParam(static_cast<typename TypeParam::Base>(13 * i));
+  }
+
+  TypeParam::AddBatch(a, b, absl::MakeSpan(sum));
+  TypeParam::SubtractBatch(a, b, absl::MakeSpan(difference));
+
+  for (int i = 0; i < kBatchSize; ++i) {
+    EXPECT_EQ(sum[i], a[i] + b[i]) << "i=" << i;
+    EXPECT_EQ(difference[i], a[i] - b[i]) << "i=" << i;
+  }
+}
+
+TYPED_TEST(IntModNTest, AddBatchWorksInPlace) {
+  constexpr int kBatchSize = 35;
+  std::vector<TypeParam> a(kBatchSize), b(kBatchSize), expected(kBatchSize);
+  for (int i = 0; i < kBatchSize; ++i) {
+    a[i] = TypeParam(TypeParam::modulus() - 2 - i);
+    b[i] = TypeParam(static_cast<typename TypeParam::Base>(i));
+    expected[i] = a[i] + b[i];
+  }
+
+  TypeParam::AddBatch(a, b, absl::MakeSpan(a));
+
+  EXPECT_EQ(a, expected);
+}
+
+TYPED_TEST(IntModNTest, SampleBatchFromBytesMatchesPerBatchSampling) {
+  constexpr int kNumBatches = 3;
+  absl::StatusOr<int> bytes_per_batch =
+      TypeParam::GetNumBytesRequired(kNumSamples, kFeasibleSecurityParameter);
+  ASSERT_EQ(bytes_per_batch.ok(), true);
+
+  std::string bytes;
+  for (int j = 0; j < kNumBatches * *bytes_per_batch; ++j) {
+    bytes.push_back(static_cast<char>((j * 11 + 3) % 256));
+  }
+
+  std::vector<TypeParam> batch_samples(kNumBatches * kNumSamples);
+  DPF_EXPECT_OK(TypeParam::SampleBatchFromBytes(
+      bytes, kNumBatches, kFeasibleSecurityParameter,
+      absl::MakeSpan(batch_samples)));
+
+  for (int j = 0; j < kNumBatches; ++j) {
+    std::vector<TypeParam> samples(kNumSamples);
+    DPF_EXPECT_OK(TypeParam::SampleFromBytes(
+        bytes.substr(j * *bytes_per_batch, *bytes_per_batch),
+        kFeasibleSecurityParameter, absl::MakeSpan(samples)));
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_EQ(batch_samples[j * kNumSamples + i], samples[i])
+          << "j=" << j << ", i=" << i;
+    }
+  }
+}
+
+TYPED_TEST(IntModNTest, SampleBatchFromBytesFailsOnInvalidArguments) {
+  std::vector<TypeParam> samples(6);
+  EXPECT_THAT(TypeParam::SampleBatchFromBytes(std::string(1000, '#'), 0,
+                                              kFeasibleSecurityParameter,
+                                              absl::MakeSpan(samples)),
+              dpf_internal::StatusIs(absl::StatusCode::kInvalidArgument,
+                                     "`num_batches` must be positive"));
+  EXPECT_THAT(
+      TypeParam::SampleBatchFromBytes(std::string(1000, '#'), 4,
+                                      kFeasibleSecurityParameter,
+                                      absl::MakeSpan(samples)),
+      dpf_internal::StatusIs(
+          absl::StatusCode::kInvalidArgument,
+          "`samples.size()` must be a positive multiple of `num_batches`"));
+  EXPECT_THAT(
+      TypeParam::SampleBatchFromBytes(std::string(16, '#'), 2,
+                                      kFeasibleSecurityParameter,
+                                      absl::MakeSpan(samples)),
+      dpf_internal::StatusIs(
+          absl::StatusCode::kInvalidArgument,
+          "The number of bytes provided (16) is insufficient for the required "
+          "statistical security and number of samples."));
+}
+
 using BaseInteger = uint32_t;
 constexpr BaseInteger kModulus32 = 4294967291u;  // 2**32 - 5
 using MyIntModN = IntModN<BaseInteger, kModulus32>;
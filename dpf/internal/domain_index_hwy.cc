@@ -0,0 +1,151 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/domain_index_hwy.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/base/config.h"
+#include "absl/base/optimization.h"
+#include "absl/numeric/int128.h"
+
+// clang-format off
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "dpf/internal/domain_index_hwy.cc"
+#include "hwy/foreach_target.h"
+// clang-format on
+
+#include "hwy/highway.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace HWY_NAMESPACE {
+
+#if HWY_TARGET != HWY_SCALAR
+namespace hn = hwy::HWY_NAMESPACE;
+#endif  // HWY_TARGET != HWY_SCALAR
+
+// Computes `tree_indices[i] = domain_indices[i] >> block_index_bits` for
+// `num_indices` 128-bit indices, with `0 < block_index_bits < 64`. Each
+// vector covers several (lo, hi) word pairs; the shifted low word needs the
+// `block_index_bits` low bits of its high neighbor, which are brought into
+// place by swapping the words within each 128-bit block and shifting left.
+bool DomainToTreeIndicesHwy(int64_t num_indices,
+                            const absl::uint128* domain_indices,
+                            int block_index_bits,
+                            absl::uint128* tree_indices) {
+#if HWY_TARGET == HWY_SCALAR
+  // Without SIMD support, the caller's scalar loop is just as fast.
+  return false;
+#else
+  const hn::ScalableTag<uint64_t> d;
+  const size_t lanes = hn::Lanes(d);
+  // Only run the vectorized version if vectors consist of whole 128-bit
+  // blocks, so that `Shuffle01` swaps exactly the (lo, hi) pairs.
+  if (ABSL_PREDICT_FALSE(lanes < 2 || lanes % 2 != 0)) {
+    return false;
+  }
+  const uint64_t* in = reinterpret_cast<const uint64_t*>(domain_indices);
+  uint64_t* out = reinterpret_cast<uint64_t*>(tree_indices);
+  const int64_t num_words = 2 * num_indices;
+  const auto zero = hn::Zero(d);
+
+  int64_t i = 0;
+  for (; i + static_cast<int64_t>(lanes) <= num_words;
+       i += static_cast<int64_t>(lanes)) {
+    const auto vec = hn::LoadU(d, in + i);
+    // The low bits of each high word, shifted into the top of the
+    // corresponding low word. High lanes must not receive a carry, so the
+    // swapped-and-shifted vector is zeroed in the odd (high) lanes.
+    const auto carry =
+        hn::ShiftLeftSame(hn::Shuffle01(vec), 64 - block_index_bits);
+    const auto shifted = hn::Or(hn::ShiftRightSame(vec, block_index_bits),
+                                hn::OddEven(zero, carry));
+    hn::StoreU(shifted, d, out + i);
+  }
+
+  // Scalar tail for the remaining indices that don't fill a whole vector.
+  for (int64_t j = i / 2; j < num_indices; ++j) {
+    const uint64_t lo = in[2 * j];
+    const uint64_t hi = in[2 * j + 1];
+    out[2 * j] = (lo >> block_index_bits) | (hi << (64 - block_index_bits));
+    out[2 * j + 1] = hi >> block_index_bits;
+  }
+  return true;
+#endif  // HWY_TARGET == HWY_SCALAR
+}
+
+}  // namespace HWY_NAMESPACE
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE || HWY_IDE
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+// The kernel interprets each 128-bit index as a (lo, hi) pair of 64-bit
+// words, which matches the memory layout of `absl::uint128` only on
+// little-endian machines.
+constexpr bool kIsLittleEndian =
+#ifdef ABSL_IS_LITTLE_ENDIAN
+    true;
+#else
+    false;
+#endif
+
+}  // namespace
+
+HWY_EXPORT(DomainToTreeIndicesHwy);
+
+bool DomainToTreeAndBlockIndices(int64_t num_indices,
+                                 const absl::uint128* domain_indices,
+                                 int block_index_bits,
+                                 absl::uint128* tree_indices,
+                                 int* block_indices) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_indices == 0) {
+    return true;  // Nothing to do.
+  }
+  if (tree_indices != nullptr) {
+    if (block_index_bits == 0) {
+      // The tree indices are the domain indices; no shifting needed.
+      std::copy_n(domain_indices, num_indices, tree_indices);
+    } else if (!HWY_DYNAMIC_DISPATCH(DomainToTreeIndicesHwy)(
+                   num_indices, domain_indices, block_index_bits,
+                   tree_indices)) {
+      return false;
+    }
+  }
+  if (block_indices != nullptr) {
+    // Extracting one small masked value per 128-bit index is a strided
+    // narrowing store that doesn't vectorize profitably, but as a single AND
+    // per index on the low words it is negligible next to the shifts.
+    const uint64_t* in = reinterpret_cast<const uint64_t*>(domain_indices);
+    const uint64_t mask = (uint64_t{1} << block_index_bits) - 1;
+    for (int64_t i = 0; i < num_indices; ++i) {
+      block_indices[i] = static_cast<int>(in[2 * i] & mask);
+    }
+  }
+  return true;
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+#endif
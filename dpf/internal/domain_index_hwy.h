@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_DOMAIN_INDEX_HWY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_DOMAIN_INDEX_HWY_H_
+
+#include <cstdint>
+
+#include "absl/numeric/int128.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// Translates `num_indices` domain indices into tree and block indices in one
+// batched pass: `tree_indices[i] = domain_indices[i] >> block_index_bits` and
+// `block_indices[i] = domain_indices[i] % (1 << block_index_bits)`. The
+// 128-bit right shift is computed with Highway 64-bit lane operations on the
+// domain indices reinterpreted as pairs of 64-bit words, so large spans
+// translate at memory bandwidth instead of one `absl::uint128` shift per
+// element. Either output pointer may be null, in which case the corresponding
+// indices are not computed. `block_index_bits` must be in [0, 64); in
+// practice it is at most 7, since a 128-bit block packs at most 128 elements.
+//
+// Returns true if the translation was performed, and false if no suitable
+// SIMD implementation is available on the current target (e.g., HWY_SCALAR,
+// or a big-endian machine where the word order within an `absl::uint128` does
+// not match the vector lane order). In the latter case the outputs are left
+// untouched and the caller has to fall back to the scalar translation loop.
+bool DomainToTreeAndBlockIndices(int64_t num_indices,
+                                 const absl::uint128* domain_indices,
+                                 int block_index_bits,
+                                 absl::uint128* tree_indices,
+                                 int* block_indices);
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_DOMAIN_INDEX_HWY_H_
@@ -0,0 +1,99 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/domain_index_hwy.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+class DomainIndexHwyTest : public testing::TestWithParam<int> {
+ protected:
+  void SetUpInputs(int64_t num_indices) {
+    absl::BitGen rng;
+    domain_indices_.resize(num_indices);
+    for (int64_t i = 0; i < num_indices; ++i) {
+      domain_indices_[i] = absl::MakeUint128(absl::Uniform<uint64_t>(rng),
+                                             absl::Uniform<uint64_t>(rng));
+    }
+  }
+
+  std::vector<absl::uint128> domain_indices_;
+};
+
+TEST_P(DomainIndexHwyTest, MatchesScalarTranslation) {
+  const int block_index_bits = GetParam();
+  // Sizes chosen to exercise the vector loop and the scalar tail for all
+  // vector lengths up to 512 bits.
+  for (int64_t num_indices : {0, 1, 2, 3, 4, 7, 8, 15, 16, 31, 64, 1000}) {
+    SetUpInputs(num_indices);
+    std::vector<absl::uint128> tree_indices(num_indices);
+    std::vector<int> block_indices(num_indices);
+    if (!DomainToTreeAndBlockIndices(num_indices, domain_indices_.data(),
+                                     block_index_bits, tree_indices.data(),
+                                     block_indices.data())) {
+      GTEST_SKIP() << "No suitable SIMD implementation on this target";
+    }
+    for (int64_t i = 0; i < num_indices; ++i) {
+      EXPECT_EQ(tree_indices[i], domain_indices_[i] >> block_index_bits)
+          << "i=" << i << ", block_index_bits=" << block_index_bits;
+      EXPECT_EQ(block_indices[i],
+                static_cast<int>(
+                    domain_indices_[i] &
+                    ((absl::uint128{1} << block_index_bits) - 1)))
+          << "i=" << i << ", block_index_bits=" << block_index_bits;
+    }
+  }
+}
+
+TEST_P(DomainIndexHwyTest, SupportsNullOutputs) {
+  const int block_index_bits = GetParam();
+  SetUpInputs(100);
+  std::vector<absl::uint128> tree_indices(100);
+  std::vector<int> block_indices(100);
+  if (!DomainToTreeAndBlockIndices(100, domain_indices_.data(),
+                                   block_index_bits, tree_indices.data(),
+                                   /*block_indices=*/nullptr) ||
+      !DomainToTreeAndBlockIndices(100, domain_indices_.data(),
+                                   block_index_bits,
+                                   /*tree_indices=*/nullptr,
+                                   block_indices.data())) {
+    GTEST_SKIP() << "No suitable SIMD implementation on this target";
+  }
+  for (int64_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(tree_indices[i], domain_indices_[i] >> block_index_bits);
+    EXPECT_EQ(block_indices[i],
+              static_cast<int>(
+                  domain_indices_[i] &
+                  ((absl::uint128{1} << block_index_bits) - 1)));
+  }
+}
+
+// `block_index_bits` is at most 7 in practice (128 packed bits per block),
+// but the kernel supports any shift below the word size.
+INSTANTIATE_TEST_SUITE_P(AllBlockIndexBits, DomainIndexHwyTest,
+                         testing::Values(0, 1, 2, 3, 4, 5, 6, 7, 20, 63));
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
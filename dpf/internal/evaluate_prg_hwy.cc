@@ -17,8 +17,10 @@
 #include <glog/logging.h>
 #include <openssl/aes.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <memory>
 
 #include "absl/base/config.h"
 #include "absl/base/optimization.h"
@@ -505,6 +507,56 @@ absl::Status EvaluateSeeds(
       seeds_out, control_bits_out);
 }
 
+absl::Status EvaluateSeedsPacked(
+    int64_t num_seeds, int num_levels, const absl::uint128* seeds_in,
+    const uint64_t* control_bits_in, const absl::uint128* paths,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    uint64_t* control_bits_out) {
+  // Unpack the control bits into a fixed-size bool scratch buffer and process
+  // the seeds in chunks. The chunk size is a multiple of 64 so that chunk
+  // boundaries coincide with word boundaries, and large enough to amortize
+  // the per-call setup of the SIMD kernel, while the scratch buffer (64 KiB)
+  // stays negligible compared to the seeds themselves.
+  constexpr int64_t kBitsPerWord = 64;
+  constexpr int64_t kChunkSize = int64_t{1} << 16;
+  static_assert(kChunkSize % kBitsPerWord == 0,
+                "Chunks must consist of whole control-bit words");
+  const int64_t scratch_size = std::min(num_seeds, kChunkSize);
+  auto control_bits_buffer = std::make_unique<bool[]>(scratch_size);
+  if (control_bits_buffer == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  for (int64_t start_seed = 0; start_seed < num_seeds;
+       start_seed += kChunkSize) {
+    const int64_t batch_size =
+        std::min<int64_t>(num_seeds - start_seed, kChunkSize);
+    for (int64_t i = 0; i < batch_size; ++i) {
+      control_bits_buffer[i] =
+          (control_bits_in[(start_seed + i) / kBitsPerWord] >>
+           ((start_seed + i) % kBitsPerWord)) &
+          1;
+    }
+    DPF_RETURN_IF_ERROR(EvaluateSeeds(
+        batch_size, num_levels, seeds_in + start_seed,
+        control_bits_buffer.get(), paths + start_seed, correction_seeds,
+        correction_controls_left, correction_controls_right, prg_left,
+        prg_right, seeds_out + start_seed, control_bits_buffer.get()));
+    for (int64_t word = 0; word * kBitsPerWord < batch_size; ++word) {
+      uint64_t word_out = 0;
+      const int64_t word_bits =
+          std::min(batch_size - word * kBitsPerWord, kBitsPerWord);
+      for (int64_t i = 0; i < word_bits; ++i) {
+        word_out |= uint64_t{control_bits_buffer[word * kBitsPerWord + i]}
+                    << i;
+      }
+      control_bits_out[start_seed / kBitsPerWord + word] = word_out;
+    }
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace dpf_internal
 }  // namespace distributed_point_functions
 #endif
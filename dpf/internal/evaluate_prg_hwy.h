@@ -63,6 +63,21 @@ absl::Status EvaluateSeeds(
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
     bool* control_bits_out);
 
+// As `EvaluateSeeds`, but reads and writes control bits packed into 64-bit
+// words (bit `i` of the packed vector lives in word `i / 64` at position
+// `i % 64`, see `PackedControlBits` in
+// dpf/internal/packed_control_bits.h). `control_bits_in` and
+// `control_bits_out` must hold at least `(num_seeds + 63) / 64` words. This
+// keeps the control-bit working set 8x smaller than the bool-based variant;
+// the unpacking to the SIMD kernel happens on L1-resident 64-seed batches.
+absl::Status EvaluateSeedsPacked(
+    int64_t num_seeds, int num_levels, const absl::uint128* seeds_in,
+    const uint64_t* control_bits_in, const absl::uint128* paths,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    uint64_t* control_bits_out);
+
 // As `EvaluateSeeds`, but does not require any SIMD support.
 absl::Status EvaluateSeedsNoHwy(
     int64_t num_seeds, int num_levels, const absl::uint128* seeds_in,
@@ -0,0 +1,139 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/hash_seeds_hwy.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/base/optimization.h"
+#include "absl/numeric/int128.h"
+#include "hwy/aligned_allocator.h"
+
+// clang-format off
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "dpf/internal/hash_seeds_hwy.cc"
+#include "hwy/foreach_target.h"
+// clang-format on
+
+#include "dpf/internal/aes_128_fixed_key_hash_hwy.h"
+#include "hwy/highway.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace HWY_NAMESPACE {
+
+#if HWY_TARGET == HWY_SCALAR
+
+bool HashSeedsHwy(int64_t num_seeds, const absl::uint128* seeds_in,
+                  absl::uint128* seeds_out, const uint8_t* round_keys) {
+  // No AES support on HWY_SCALAR; the caller falls back to OpenSSL.
+  return false;
+}
+
+#else
+
+namespace hn = hwy::HWY_NAMESPACE;
+
+bool HashSeedsHwy(int64_t num_seeds, const absl::uint128* seeds_in,
+                  absl::uint128* seeds_out, const uint8_t* round_keys) {
+  // Vector type used throughout this function: Largest byte vector available.
+  const hn::ScalableTag<uint8_t> d8;
+  // Only run the highway version if the number of bytes in a vector is at
+  // least 16 and a multiple of 16.
+  if (ABSL_PREDICT_FALSE(hn::Lanes(d8) < 16 || hn::Lanes(d8) % 16 != 0)) {
+    return false;
+  }
+  const hn::Repartition<uint64_t, decltype(d8)> d64;
+  // All blocks are hashed with the same key, so the key selection mask of
+  // `HashOneWithKeyMask` and `HashFourWithKeyMask` is constantly zero and both
+  // key pointers are equal.
+  const auto mask_all_zero = hn::FirstN(d64, 0);
+  const int64_t num_bytes = num_seeds * sizeof(absl::uint128);
+
+  // Pointer aliases for reading and writing data.
+  const uint8_t* in_ptr = reinterpret_cast<const uint8_t*>(seeds_in);
+  uint8_t* out_ptr = reinterpret_cast<uint8_t*>(seeds_out);
+
+  // Four vectors at a time, to pipeline AES instructions.
+  int64_t i = 0;
+  for (; i + 4 * hn::Lanes(d8) <= num_bytes; i += 4 * hn::Lanes(d8)) {
+    auto vec_0 = hn::LoadU(d8, in_ptr + i);
+    auto vec_1 = hn::LoadU(d8, in_ptr + i + 1 * hn::Lanes(d8));
+    auto vec_2 = hn::LoadU(d8, in_ptr + i + 2 * hn::Lanes(d8));
+    auto vec_3 = hn::LoadU(d8, in_ptr + i + 3 * hn::Lanes(d8));
+    HashFourWithKeyMask(d8, vec_0, vec_1, vec_2, vec_3, mask_all_zero,
+                        mask_all_zero, mask_all_zero, mask_all_zero, round_keys,
+                        round_keys, vec_0, vec_1, vec_2, vec_3);
+    hn::StoreU(vec_0, d8, out_ptr + i);
+    hn::StoreU(vec_1, d8, out_ptr + i + 1 * hn::Lanes(d8));
+    hn::StoreU(vec_2, d8, out_ptr + i + 2 * hn::Lanes(d8));
+    hn::StoreU(vec_3, d8, out_ptr + i + 3 * hn::Lanes(d8));
+  }
+
+  // Single full vectors.
+  for (; i + hn::Lanes(d8) <= num_bytes; i += hn::Lanes(d8)) {
+    auto vec = hn::LoadU(d8, in_ptr + i);
+    HashOneWithKeyMask(d8, vec, mask_all_zero, round_keys, round_keys, vec);
+    hn::StoreU(vec, d8, out_ptr + i);
+  }
+
+  // Elements less than a full vector. Copy to an owned buffer first, so that
+  // we can load and store whole vectors without out-of-bounds accesses.
+  const int64_t remaining_blocks = num_seeds - i / sizeof(absl::uint128);
+  if (remaining_blocks > 0) {
+    const int64_t blocks_per_lane = hn::Lanes(d8) / sizeof(absl::uint128);
+    auto buffer = hwy::AllocateAligned<absl::uint128>(blocks_per_lane);
+    if (buffer == nullptr) {
+      return false;  // Fall back to OpenSSL on allocation failure.
+    }
+    std::copy_n(seeds_in + i / sizeof(absl::uint128), remaining_blocks,
+                buffer.get());
+    auto buffer_ptr = reinterpret_cast<uint8_t*>(buffer.get());
+    auto vec = hn::Load(d8, buffer_ptr);
+    HashOneWithKeyMask(d8, vec, mask_all_zero, round_keys, round_keys, vec);
+    hn::Store(vec, d8, buffer_ptr);
+    std::copy_n(buffer.get(), remaining_blocks,
+                seeds_out + i / sizeof(absl::uint128));
+  }
+
+  return true;
+}
+
+#endif  // HWY_TARGET == HWY_SCALAR
+
+}  // namespace HWY_NAMESPACE
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE || HWY_IDE
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+HWY_EXPORT(HashSeedsHwy);
+
+bool HashSeeds(int64_t num_seeds, const absl::uint128* seeds_in,
+               absl::uint128* seeds_out, const uint8_t* round_keys) {
+  if (num_seeds == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(HashSeedsHwy)(num_seeds, seeds_in, seeds_out,
+                                            round_keys);
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_HASH_SEEDS_HWY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_HASH_SEEDS_HWY_H_
+
+#include <cstdint>
+
+#include "absl/numeric/int128.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// Computes the circular correlation-robust MMO hash
+//
+//     seeds_out[i] = AES.Encrypt(key, sigma(seeds_in[i])) ^ sigma(seeds_in[i])
+//
+// for each of the `num_seeds` blocks in `seeds_in`, using direct AES
+// instructions via Highway instead of OpenSSL's EVP interface. This skips the
+// per-call EVP dispatch overhead, which dominates the AES rounds themselves
+// for bulk hashing. `round_keys` must point to an AES-128 key schedule as
+// produced by `AES_set_encrypt_key` (11 round keys of 16 bytes each).
+// `seeds_in` and `seeds_out` may be equal, but must not overlap partially.
+// Neither pointer is required to be aligned.
+//
+// Returns true if the hash was computed, and false if no suitable SIMD
+// implementation is available on the current target (e.g., when Highway falls
+// back to HWY_SCALAR, which has no AES support). In the latter case
+// `seeds_out` is left untouched and the caller has to fall back to OpenSSL.
+bool HashSeeds(int64_t num_seeds, const absl::uint128* seeds_in,
+               absl::uint128* seeds_out, const uint8_t* round_keys);
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_HASH_SEEDS_HWY_H_
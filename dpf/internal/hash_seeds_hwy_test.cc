@@ -0,0 +1,95 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/hash_seeds_hwy.h"
+
+#include <glog/logging.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <openssl/aes.h>
+
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "dpf/internal/get_hwy_mode.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+constexpr absl::uint128 kKey =
+    absl::MakeUint128(0x0123456789abcdef, 0xfedcba9876543210);
+
+// Reference implementation of the fixed-key MMO hash, using OpenSSL's
+// single-block AES directly.
+absl::uint128 HashOneSeed(absl::uint128 in, const AES_KEY& expanded_key) {
+  absl::uint128 sigma = absl::MakeUint128(
+      absl::Uint128High64(in) ^ absl::Uint128Low64(in), absl::Uint128High64(in));
+  absl::uint128 out;
+  AES_encrypt(reinterpret_cast<const uint8_t*>(&sigma),
+              reinterpret_cast<uint8_t*>(&out), &expanded_key);
+  return out ^ sigma;
+}
+
+class HashSeedsHwyTest : public testing::TestWithParam<int> {};
+
+TEST_P(HashSeedsHwyTest, MatchesSingleBlockAes) {
+  const int num_seeds = GetParam();
+  alignas(16) AES_KEY expanded_key;
+  ASSERT_EQ(0, AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(&kKey),
+                                   128, &expanded_key));
+  std::vector<absl::uint128> in(num_seeds), out(num_seeds), expected(num_seeds);
+  for (int i = 0; i < num_seeds; ++i) {
+    in[i] = absl::MakeUint128(i, ~uint64_t{0} - i);
+    expected[i] = HashOneSeed(in[i], expanded_key);
+  }
+
+  if (!HashSeeds(num_seeds, in.data(), out.data(),
+                 reinterpret_cast<const uint8_t*>(expanded_key.rd_key))) {
+    GTEST_SKIP() << "No SIMD AES support on this target (Highway is in "
+                 << GetHwyModeAsString() << " mode)";
+  }
+
+  EXPECT_THAT(out, testing::ElementsAreArray(expected));
+}
+
+TEST_P(HashSeedsHwyTest, InPlaceEvaluationMatches) {
+  const int num_seeds = GetParam();
+  alignas(16) AES_KEY expanded_key;
+  ASSERT_EQ(0, AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(&kKey),
+                                   128, &expanded_key));
+  std::vector<absl::uint128> seeds(num_seeds), expected(num_seeds);
+  for (int i = 0; i < num_seeds; ++i) {
+    seeds[i] = absl::MakeUint128(2 * i + 1, i);
+    expected[i] = HashOneSeed(seeds[i], expanded_key);
+  }
+
+  if (!HashSeeds(num_seeds, seeds.data(), seeds.data(),
+                 reinterpret_cast<const uint8_t*>(expanded_key.rd_key))) {
+    GTEST_SKIP() << "No SIMD AES support on this target (Highway is in "
+                 << GetHwyModeAsString() << " mode)";
+  }
+
+  EXPECT_THAT(seeds, testing::ElementsAreArray(expected));
+}
+
+// Sizes chosen to exercise the four-vector loop, single-vector loop, and the
+// partial-vector tail for all vector lengths up to 512 bits.
+INSTANTIATE_TEST_SUITE_P(VaryingSizes, HashSeedsHwyTest,
+                         testing::Values(0, 1, 2, 3, 5, 16, 17, 63, 64, 65,
+                                         1000));
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
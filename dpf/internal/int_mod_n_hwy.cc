@@ -0,0 +1,175 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/int_mod_n_hwy.h"
+
+#include <cstdint>
+
+// clang-format off
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "dpf/internal/int_mod_n_hwy.cc"
+#include "hwy/foreach_target.h"
+// clang-format on
+
+#include "hwy/highway.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace HWY_NAMESPACE {
+
+#if HWY_TARGET != HWY_SCALAR
+namespace hn = hwy::HWY_NAMESPACE;
+
+// Shared implementation for both element widths. Elements of `a` and `b` are
+// fully reduced, so the exact sum is less than `2 * modulus`: after a
+// wrapping add, the result needs `modulus` subtracted iff it is at least
+// `modulus`, or iff the add wrapped around the integer range (in which case
+// the wrapping subtraction restores the reduced value).
+template <typename T>
+bool AddModBatchHwyImpl(int64_t n, const T* a, const T* b, T modulus, T* out) {
+  const hn::ScalableTag<T> d;
+  const auto modulus_vec = hn::Set(d, modulus);
+  const int64_t lanes = static_cast<int64_t>(hn::Lanes(d));
+  int64_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    const auto va = hn::LoadU(d, a + i);
+    const auto vb = hn::LoadU(d, b + i);
+    const auto sum = hn::Add(va, vb);
+    const auto needs_reduction =
+        hn::Or(hn::Ge(sum, modulus_vec), hn::Lt(sum, va));
+    const auto reduced =
+        hn::IfThenElse(needs_reduction, hn::Sub(sum, modulus_vec), sum);
+    hn::StoreU(reduced, d, out + i);
+  }
+  // Scalar tail.
+  for (; i < n; ++i) {
+    const T sum = static_cast<T>(a[i] + b[i]);
+    out[i] = (sum >= modulus || sum < a[i]) ? static_cast<T>(sum - modulus)
+                                            : sum;
+  }
+  return true;
+}
+
+// As above, for subtraction: the wrapping difference needs `modulus` added
+// back iff `b[i] > a[i]`.
+template <typename T>
+bool SubModBatchHwyImpl(int64_t n, const T* a, const T* b, T modulus, T* out) {
+  const hn::ScalableTag<T> d;
+  const auto modulus_vec = hn::Set(d, modulus);
+  const int64_t lanes = static_cast<int64_t>(hn::Lanes(d));
+  int64_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    const auto va = hn::LoadU(d, a + i);
+    const auto vb = hn::LoadU(d, b + i);
+    const auto diff = hn::Sub(va, vb);
+    const auto wrapped = hn::Lt(va, vb);
+    const auto reduced =
+        hn::IfThenElse(wrapped, hn::Add(diff, modulus_vec), diff);
+    hn::StoreU(reduced, d, out + i);
+  }
+  for (; i < n; ++i) {
+    const T diff = static_cast<T>(a[i] - b[i]);
+    out[i] = (a[i] < b[i]) ? static_cast<T>(diff + modulus) : diff;
+  }
+  return true;
+}
+#endif  // HWY_TARGET != HWY_SCALAR
+
+bool AddModBatchUint32Hwy(int64_t n, const uint32_t* a, const uint32_t* b,
+                          uint32_t modulus, uint32_t* out) {
+#if HWY_TARGET == HWY_SCALAR
+  // Without SIMD support, the caller's scalar loop is just as fast.
+  return false;
+#else
+  return AddModBatchHwyImpl(n, a, b, modulus, out);
+#endif
+}
+
+bool AddModBatchUint64Hwy(int64_t n, const uint64_t* a, const uint64_t* b,
+                          uint64_t modulus, uint64_t* out) {
+#if HWY_TARGET == HWY_SCALAR
+  return false;
+#else
+  return AddModBatchHwyImpl(n, a, b, modulus, out);
+#endif
+}
+
+bool SubModBatchUint32Hwy(int64_t n, const uint32_t* a, const uint32_t* b,
+                          uint32_t modulus, uint32_t* out) {
+#if HWY_TARGET == HWY_SCALAR
+  return false;
+#else
+  return SubModBatchHwyImpl(n, a, b, modulus, out);
+#endif
+}
+
+bool SubModBatchUint64Hwy(int64_t n, const uint64_t* a, const uint64_t* b,
+                          uint64_t modulus, uint64_t* out) {
+#if HWY_TARGET == HWY_SCALAR
+  return false;
+#else
+  return SubModBatchHwyImpl(n, a, b, modulus, out);
+#endif
+}
+
+}  // namespace HWY_NAMESPACE
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE || HWY_IDE
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+HWY_EXPORT(AddModBatchUint32Hwy);
+HWY_EXPORT(AddModBatchUint64Hwy);
+HWY_EXPORT(SubModBatchUint32Hwy);
+HWY_EXPORT(SubModBatchUint64Hwy);
+
+bool AddModBatch(int64_t n, const uint32_t* a, const uint32_t* b,
+                 uint32_t modulus, uint32_t* out) {
+  if (n == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(AddModBatchUint32Hwy)(n, a, b, modulus, out);
+}
+
+bool AddModBatch(int64_t n, const uint64_t* a, const uint64_t* b,
+                 uint64_t modulus, uint64_t* out) {
+  if (n == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(AddModBatchUint64Hwy)(n, a, b, modulus, out);
+}
+
+bool SubModBatch(int64_t n, const uint32_t* a, const uint32_t* b,
+                 uint32_t modulus, uint32_t* out) {
+  if (n == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(SubModBatchUint32Hwy)(n, a, b, modulus, out);
+}
+
+bool SubModBatch(int64_t n, const uint64_t* a, const uint64_t* b,
+                 uint64_t modulus, uint64_t* out) {
+  if (n == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(SubModBatchUint64Hwy)(n, a, b, modulus, out);
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_INT_MOD_N_HWY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_INT_MOD_N_HWY_H_
+
+#include <cstdint>
+#include <type_traits>
+
+#include "absl/meta/type_traits.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// Computes `out[i] = (a[i] + b[i]) mod modulus` for all `i < n` with vector
+// loads/stores. All elements of `a` and `b` must be fully reduced (i.e., less
+// than `modulus`), so the sum is at most `2 * modulus - 2` and a single
+// conditional subtraction suffices; the kernel detects wrap-around of the
+// base integer, which makes it correct for moduli larger than half the
+// integer range. `out` may alias `a` or `b`.
+//
+// Returns true if the addition was performed, and false if no suitable SIMD
+// implementation is available on the current target (e.g., HWY_SCALAR). In
+// the latter case `out` is left untouched and the caller has to fall back to
+// the scalar operators.
+bool AddModBatch(int64_t n, const uint32_t* a, const uint32_t* b,
+                 uint32_t modulus, uint32_t* out);
+bool AddModBatch(int64_t n, const uint64_t* a, const uint64_t* b,
+                 uint64_t modulus, uint64_t* out);
+
+// As `AddModBatch`, but computes `out[i] = (a[i] - b[i]) mod modulus`.
+bool SubModBatch(int64_t n, const uint32_t* a, const uint32_t* b,
+                 uint32_t modulus, uint32_t* out);
+bool SubModBatch(int64_t n, const uint64_t* a, const uint64_t* b,
+                 uint64_t modulus, uint64_t* out);
+
+// Type-generic entry points used by the templated code in dpf/int_mod_n.h.
+// Forward to the overloads above for 32-bit and 64-bit base integers, and
+// return false (leaving `out` untouched) for all other base integer types, so
+// that callers can keep a single scalar fallback path.
+template <typename T>
+constexpr bool has_vectorized_mod_arithmetic_v =
+    std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value;
+
+template <typename T,
+          absl::enable_if_t<has_vectorized_mod_arithmetic_v<T>, int> = 0>
+bool TryAddModBatch(int64_t n, const T* a, const T* b, T modulus, T* out) {
+  return AddModBatch(n, a, b, modulus, out);
+}
+template <typename T,
+          absl::enable_if_t<!has_vectorized_mod_arithmetic_v<T>, int> = 0>
+bool TryAddModBatch(int64_t /*n*/, const T* /*a*/, const T* /*b*/,
+                    T /*modulus*/, T* /*out*/) {
+  return false;
+}
+
+template <typename T,
+          absl::enable_if_t<has_vectorized_mod_arithmetic_v<T>, int> = 0>
+bool TrySubModBatch(int64_t n, const T* a, const T* b, T modulus, T* out) {
+  return SubModBatch(n, a, b, modulus, out);
+}
+template <typename T,
+          absl::enable_if_t<!has_vectorized_mod_arithmetic_v<T>, int> = 0>
+bool TrySubModBatch(int64_t /*n*/, const T* /*a*/, const T* /*b*/,
+                    T /*modulus*/, T* /*out*/) {
+  return false;
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_INT_MOD_N_HWY_H_
@@ -0,0 +1,113 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/int_mod_n_hwy.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+template <typename T>
+class IntModNHwyTest : public testing::Test {
+ protected:
+  // A modulus larger than half the integer range, so that sums of reduced
+  // values wrap around the base integer.
+  static constexpr T kModulus = std::numeric_limits<T>::max() - 94;
+
+  void SetUpInputs(int64_t n) {
+    a_.resize(n);
+    b_.resize(n);
+    for (int64_t i = 0; i < n; ++i) {
+      // Include values close to the modulus to exercise both reduction
+      // branches.
+      a_[i] = static_cast<T>(i * 0x9e3779b97f4a7c15ull) % kModulus;
+      b_[i] = (i % 2 == 0) ? static_cast<T>(kModulus - 1 - i % 95)
+                           : static_cast<T>(i);
+    }
+  }
+
+  std::vector<T> a_, b_;
+};
+
+using MyTypes = testing::Types<uint32_t, uint64_t>;
+TYPED_TEST_SUITE(IntModNHwyTest, MyTypes);
+
+TYPED_TEST(IntModNHwyTest, AddMatchesScalarReduction) {
+  // Sizes chosen to exercise the vector loop and the scalar tail for all
+  // vector lengths up to 512 bits.
+  for (int64_t n : {0, 1, 2, 3, 5, 16, 17, 63, 64, 65, 1000}) {
+    this->SetUpInputs(n);
+    std::vector<TypeParam> out(n);
+    if (!AddModBatch(n, this->a_.data(), this->b_.data(), this->kModulus,
+                     out.data())) {
+      GTEST_SKIP() << "No suitable vectorized kernel on this target";
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      const TypeParam expected = static_cast<TypeParam>(
+          (absl::uint128{this->a_[i]} + this->b_[i]) % this->kModulus);
+      EXPECT_EQ(out[i], expected) << "n=" << n << ", i=" << i;
+    }
+  }
+}
+
+TYPED_TEST(IntModNHwyTest, SubMatchesScalarReduction) {
+  for (int64_t n : {0, 1, 3, 64, 65, 1000}) {
+    this->SetUpInputs(n);
+    std::vector<TypeParam> out(n);
+    if (!SubModBatch(n, this->a_.data(), this->b_.data(), this->kModulus,
+                     out.data())) {
+      GTEST_SKIP() << "No suitable vectorized kernel on this target";
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      const TypeParam expected = static_cast<TypeParam>(
+          (absl::uint128{this->kModulus} + this->a_[i] - this->b_[i]) %
+          this->kModulus);
+      EXPECT_EQ(out[i], expected) << "n=" << n << ", i=" << i;
+    }
+  }
+}
+
+TYPED_TEST(IntModNHwyTest, InPlaceOperationMatches) {
+  constexpr int64_t kNumElements = 129;
+  this->SetUpInputs(kNumElements);
+  std::vector<TypeParam> expected(kNumElements);
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    expected[i] = static_cast<TypeParam>(
+        (absl::uint128{this->a_[i]} + this->b_[i]) % this->kModulus);
+  }
+  if (!AddModBatch(kNumElements, this->a_.data(), this->b_.data(),
+                   this->kModulus, this->a_.data())) {
+    GTEST_SKIP() << "No suitable vectorized kernel on this target";
+  }
+  EXPECT_THAT(this->a_, testing::ElementsAreArray(expected));
+}
+
+TEST(IntModNHwyTest, TryAddReturnsFalseForUnsupportedBaseIntegers) {
+  uint16_t a = 1, b = 2, out = 42;
+  EXPECT_FALSE(TryAddModBatch<uint16_t>(1, &a, &b, 100, &out));
+  EXPECT_EQ(out, 42);
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,136 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/numa.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/types/span.h"
+
+#if defined(__linux__)
+#include <sched.h>
+
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+namespace {
+
+// CPUs per NUMA node. Nodes without CPUs (e.g. memory-only CXL nodes) are
+// dropped, so indices here are dense but don't necessarily match kernel node
+// IDs. The kernel IDs are not needed: placement works purely through CPU
+// affinity and first-touch allocation.
+std::vector<std::vector<int>> ReadNumaTopology() {
+  std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+  // Node directories are dense in practice, but tolerate gaps by probing a
+  // few IDs past the last hit.
+  constexpr int kMaxProbeGap = 8;
+  int misses = 0;
+  for (int node = 0; misses < kMaxProbeGap; ++node) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    std::ifstream cpulist_file(path.str());
+    if (!cpulist_file.is_open()) {
+      ++misses;
+      continue;
+    }
+    misses = 0;
+    std::string cpulist;
+    std::getline(cpulist_file, cpulist);
+    std::vector<int> cpus = ParseCpuList(cpulist);
+    if (!cpus.empty()) {
+      nodes.push_back(std::move(cpus));
+    }
+  }
+#endif
+  if (nodes.empty()) {
+    nodes.emplace_back();  // Single anonymous node; no pinning possible.
+  }
+  return nodes;
+}
+
+const std::vector<std::vector<int>>& GetNumaTopology() {
+  static const std::vector<std::vector<int>>* const topology =
+      new std::vector<std::vector<int>>(ReadNumaTopology());
+  return *topology;
+}
+
+}  // namespace
+
+int NumNumaNodes() { return static_cast<int>(GetNumaTopology().size()); }
+
+absl::Span<const int> NumaNodeCpus(int node) {
+  const std::vector<std::vector<int>>& topology = GetNumaTopology();
+  if (node < 0 || node >= static_cast<int>(topology.size())) {
+    return {};
+  }
+  return topology[node];
+}
+
+bool PinCurrentThreadToNode(int node) {
+#if defined(__linux__)
+  absl::Span<const int> cpus = NumaNodeCpus(node);
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  return sched_setaffinity(/*pid=*/0, sizeof(cpu_set), &cpu_set) == 0;
+#else
+  (void)node;
+  return false;
+#endif
+}
+
+std::vector<int> ParseCpuList(absl::string_view cpu_list) {
+  std::vector<int> cpus;
+  for (absl::string_view entry :
+       absl::StrSplit(cpu_list, ',', absl::SkipEmpty())) {
+    entry = absl::StripAsciiWhitespace(entry);
+    const size_t dash = entry.find('-');
+    int first, last;
+    if (dash == absl::string_view::npos) {
+      if (!absl::SimpleAtoi(entry, &first)) continue;
+      last = first;
+    } else {
+      if (!absl::SimpleAtoi(entry.substr(0, dash), &first) ||
+          !absl::SimpleAtoi(entry.substr(dash + 1), &last)) {
+        continue;
+      }
+    }
+    if (first < 0 || last < first) continue;
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
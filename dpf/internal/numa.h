@@ -0,0 +1,55 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_NUMA_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_NUMA_H_
+
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// Best-effort NUMA topology discovery and thread placement, used by
+// `DistributedPointFunction::ExpandSeedsParallel` to keep each expansion
+// shard's buffers and worker threads on the same socket. On Linux, the
+// topology is read from /sys/devices/system/node; everywhere else (and on
+// machines where sysfs is unavailable), the machine is treated as a single
+// node and pinning is a no-op. Callers must therefore work correctly without
+// any NUMA awareness, and only rely on these functions for performance.
+
+// Returns the number of NUMA nodes with at least one CPU. Always at least 1.
+// The topology is read once and cached for the lifetime of the process.
+int NumNumaNodes();
+
+// Returns the CPUs belonging to `node`, or an empty span if `node` is not in
+// [0, NumNumaNodes()).
+absl::Span<const int> NumaNodeCpus(int node);
+
+// Restricts the calling thread to the CPUs of `node`. Returns true on
+// success, false if `node` is out of range, the platform doesn't support
+// thread affinity, or the kernel rejected the mask. Failures are safe to
+// ignore: the thread simply keeps its previous affinity.
+bool PinCurrentThreadToNode(int node);
+
+// Parses a sysfs cpulist string such as "0-15,32-47" into the list of CPUs it
+// denotes. Malformed entries are skipped. Exposed for testing.
+std::vector<int> ParseCpuList(absl::string_view cpu_list);
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_NUMA_H_
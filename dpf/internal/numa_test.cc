@@ -0,0 +1,76 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/numa.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(ParseCpuListTest, ParsesSingleCpus) {
+  EXPECT_THAT(ParseCpuList("0"), ElementsAre(0));
+  EXPECT_THAT(ParseCpuList("0,2,5"), ElementsAre(0, 2, 5));
+}
+
+TEST(ParseCpuListTest, ParsesRanges) {
+  EXPECT_THAT(ParseCpuList("0-3"), ElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(ParseCpuList("0-1,4-5"), ElementsAre(0, 1, 4, 5));
+  EXPECT_THAT(ParseCpuList("0-15,32-47").size(), 32);
+}
+
+TEST(ParseCpuListTest, ToleratesWhitespaceAndEmptyEntries) {
+  EXPECT_THAT(ParseCpuList(" 0-1 , 3 \n"), ElementsAre(0, 1, 3));
+  EXPECT_THAT(ParseCpuList(""), IsEmpty());
+  EXPECT_THAT(ParseCpuList(","), IsEmpty());
+}
+
+TEST(ParseCpuListTest, SkipsMalformedEntries) {
+  EXPECT_THAT(ParseCpuList("x,1,3-2,-1,4"), ElementsAre(1, 4));
+}
+
+TEST(NumaTest, ReportsAtLeastOneNode) {
+  EXPECT_GE(NumNumaNodes(), 1);
+}
+
+TEST(NumaTest, NodeCpusOutOfRangeIsEmpty) {
+  EXPECT_THAT(NumaNodeCpus(-1), IsEmpty());
+  EXPECT_THAT(NumaNodeCpus(NumNumaNodes()), IsEmpty());
+}
+
+TEST(NumaTest, PinningOutOfRangeFails) {
+  EXPECT_FALSE(PinCurrentThreadToNode(-1));
+  EXPECT_FALSE(PinCurrentThreadToNode(NumNumaNodes()));
+}
+
+TEST(NumaTest, PinningToValidNodeDoesNotCrash) {
+  // Pinning may legitimately fail (non-Linux, restricted cpusets), so only
+  // check that it is consistent with the reported topology.
+  for (int node = 0; node < NumNumaNodes(); ++node) {
+    if (NumaNodeCpus(node).empty()) {
+      EXPECT_FALSE(PinCurrentThreadToNode(node));
+    } else {
+      PinCurrentThreadToNode(node);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_PACKED_CONTROL_BITS_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_PACKED_CONTROL_BITS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// PackedControlBits stores DPF control bits packed into 64-bit words, using
+// 8x less memory than a byte-per-bool representation. At large expansion
+// frontiers (2^30 seeds and more) the control bits would otherwise account
+// for gigabytes of working set. The word layout is little-endian within each
+// word: bit `i` lives in `words()[i / 64]` at position `i % 64`.
+class PackedControlBits {
+ public:
+  static constexpr int64_t kBitsPerWord = 64;
+
+  // Returns the number of words needed to store `num_bits` bits.
+  static constexpr int64_t NumWords(int64_t num_bits) {
+    return (num_bits + kBitsPerWord - 1) / kBitsPerWord;
+  }
+
+  PackedControlBits() = default;
+  explicit PackedControlBits(int64_t size, bool value = false) {
+    Resize(size, value);
+  }
+
+  // Returns the number of bits stored.
+  int64_t size() const { return size_; }
+
+  // Returns the bit at position `i`. Does not check bounds.
+  bool operator[](int64_t i) const {
+    return (words_[i / kBitsPerWord] >> (i % kBitsPerWord)) & 1;
+  }
+
+  // Sets the bit at position `i` to `value`. Does not check bounds.
+  void Set(int64_t i, bool value) {
+    const uint64_t mask = uint64_t{1} << (i % kBitsPerWord);
+    if (value) {
+      words_[i / kBitsPerWord] |= mask;
+    } else {
+      words_[i / kBitsPerWord] &= ~mask;
+    }
+  }
+
+  // Appends `value` at the end.
+  void PushBack(bool value) {
+    if (size_ % kBitsPerWord == 0) {
+      words_.push_back(0);
+    }
+    ++size_;
+    if (value) {
+      Set(size_ - 1, true);
+    }
+  }
+
+  // Resizes to `size` bits, setting any newly added bits to `value`.
+  void Resize(int64_t size, bool value = false) {
+    const int64_t old_size = size_;
+    words_.resize(NumWords(size), value ? ~uint64_t{0} : uint64_t{0});
+    size_ = size;
+    if (value && size > old_size && old_size % kBitsPerWord != 0) {
+      // The last pre-existing word was only partially filled; set its
+      // remaining bits by hand.
+      for (int64_t i = old_size;
+           i < size && i < NumWords(old_size) * kBitsPerWord; ++i) {
+        Set(i, true);
+      }
+    }
+    // Clear any bits beyond `size` in the last word, so that whole-word
+    // consumers don't see garbage.
+    if (size % kBitsPerWord != 0 && !words_.empty()) {
+      words_.back() &= (uint64_t{1} << (size % kBitsPerWord)) - 1;
+    }
+  }
+
+  // Reserves storage for `size` bits.
+  void Reserve(int64_t size) { words_.reserve(NumWords(size)); }
+
+  // Removes all bits.
+  void Clear() {
+    words_.clear();
+    size_ = 0;
+  }
+
+  // Copies `count` bits starting at `src_begin` in `src` to positions
+  // starting at `dst_begin` in this vector, which must already be large
+  // enough. Note that concurrent calls for disjoint bit ranges are only safe
+  // if the destination ranges do not share any words, i.e., if all
+  // `dst_begin` and `dst_begin + count` are multiples of `kBitsPerWord`.
+  void CopyBitsFrom(const PackedControlBits& src, int64_t src_begin,
+                    int64_t count, int64_t dst_begin) {
+    for (int64_t i = 0; i < count; ++i) {
+      Set(dst_begin + i, src[src_begin + i]);
+    }
+  }
+
+  // Direct access to the underlying words, e.g. for passing to
+  // `dpf_internal::EvaluateSeedsPacked`.
+  const uint64_t* words() const { return words_.data(); }
+  uint64_t* words() { return words_.data(); }
+
+ private:
+  std::vector<uint64_t> words_;
+  int64_t size_ = 0;
+};
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_PACKED_CONTROL_BITS_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dpf/internal/packed_control_bits.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+TEST(PackedControlBitsTest, DefaultConstructedIsEmpty) {
+  PackedControlBits bits;
+
+  EXPECT_EQ(bits.size(), 0);
+}
+
+TEST(PackedControlBitsTest, PushBackAndRead) {
+  PackedControlBits bits;
+  std::vector<bool> expected;
+  for (int i = 0; i < 200; ++i) {
+    bool value = (i % 3 == 0);
+    bits.PushBack(value);
+    expected.push_back(value);
+  }
+
+  ASSERT_EQ(bits.size(), 200);
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(bits[i], expected[i]) << "i = " << i;
+  }
+}
+
+TEST(PackedControlBitsTest, ConstructorFillsWithValue) {
+  PackedControlBits bits(130, true);
+
+  ASSERT_EQ(bits.size(), 130);
+  for (int i = 0; i < 130; ++i) {
+    EXPECT_TRUE(bits[i]) << "i = " << i;
+  }
+}
+
+TEST(PackedControlBitsTest, SetAndClearIndividualBits) {
+  PackedControlBits bits(100);
+
+  bits.Set(0, true);
+  bits.Set(63, true);
+  bits.Set(64, true);
+  bits.Set(99, true);
+  bits.Set(63, false);
+
+  EXPECT_TRUE(bits[0]);
+  EXPECT_FALSE(bits[63]);
+  EXPECT_TRUE(bits[64]);
+  EXPECT_TRUE(bits[99]);
+  EXPECT_FALSE(bits[1]);
+}
+
+TEST(PackedControlBitsTest, ResizeGrowsWithValueAcrossWordBoundary) {
+  PackedControlBits bits;
+  bits.PushBack(false);
+  bits.PushBack(true);
+
+  bits.Resize(70, true);
+
+  ASSERT_EQ(bits.size(), 70);
+  EXPECT_FALSE(bits[0]);
+  for (int i = 1; i < 70; ++i) {
+    EXPECT_TRUE(bits[i]) << "i = " << i;
+  }
+}
+
+TEST(PackedControlBitsTest, ResizeClearsTrailingBitsInLastWord) {
+  PackedControlBits bits(64, true);
+
+  bits.Resize(10);
+
+  ASSERT_EQ(bits.size(), 10);
+  // Bits beyond `size()` must be zero in the packed words, so that whole-word
+  // consumers such as EvaluateSeedsPacked don't see garbage.
+  EXPECT_EQ(bits.words()[0], (uint64_t{1} << 10) - 1);
+}
+
+TEST(PackedControlBitsTest, CopyBitsFromCopiesUnalignedRanges) {
+  PackedControlBits src;
+  for (int i = 0; i < 150; ++i) {
+    src.PushBack(i % 5 == 0);
+  }
+  PackedControlBits dst(200);
+
+  dst.CopyBitsFrom(src, 3, 140, 17);
+
+  for (int i = 0; i < 140; ++i) {
+    EXPECT_EQ(dst[17 + i], src[3 + i]) << "i = " << i;
+  }
+  EXPECT_FALSE(dst[16]);
+  EXPECT_FALSE(dst[157]);
+}
+
+TEST(PackedControlBitsTest, ClearRemovesAllBits) {
+  PackedControlBits bits(100, true);
+
+  bits.Clear();
+
+  EXPECT_EQ(bits.size(), 0);
+  bits.PushBack(false);
+  EXPECT_FALSE(bits[0]);
+}
+
+TEST(PackedControlBitsTest, NumWordsRoundsUp) {
+  EXPECT_EQ(PackedControlBits::NumWords(0), 0);
+  EXPECT_EQ(PackedControlBits::NumWords(1), 1);
+  EXPECT_EQ(PackedControlBits::NumWords(64), 1);
+  EXPECT_EQ(PackedControlBits::NumWords(65), 2);
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,394 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/value_correction_hwy.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/base/config.h"
+#include "absl/base/optimization.h"
+#include "absl/numeric/int128.h"
+
+// clang-format off
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "dpf/internal/value_correction_hwy.cc"
+#include "hwy/foreach_target.h"
+// clang-format on
+
+#include "hwy/highway.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace HWY_NAMESPACE {
+
+#if HWY_TARGET != HWY_SCALAR
+namespace hn = hwy::HWY_NAMESPACE;
+
+// Builds a lane-level mask for vectors described by `d` from the packed
+// control bits in `words`, such that all lanes belonging to block
+// `first_block + b` are set iff the corresponding control bit is set. Since a
+// vector covers only a handful of 128-bit blocks, this sets the mask bits a
+// whole block at a time instead of looping over lanes.
+template <typename D>
+auto MaskFromPackedControlBits(D d, const uint64_t* words,
+                               int64_t first_block) {
+  using T = hn::TFromD<D>;
+  constexpr size_t kElementsPerBlock = sizeof(absl::uint128) / sizeof(T);
+  constexpr int buffer_size = std::max(HWY_MAX_BYTES / 8, 64);
+  uint8_t mask_bits[buffer_size] = {0};
+  const size_t num_blocks = hn::Lanes(d) / kElementsPerBlock;
+  for (size_t b = 0; b < num_blocks; ++b) {
+    const int64_t block = first_block + static_cast<int64_t>(b);
+    if ((words[block / 64] >> (block % 64)) & 1) {
+      const size_t start = b * kElementsPerBlock;
+      if (kElementsPerBlock >= 8) {
+        std::fill_n(mask_bits + start / 8, kElementsPerBlock / 8,
+                    uint8_t{0xff});
+      } else {
+        // Blocks of 64-bit or 32-bit elements cover only 2 or 4 mask bits;
+        // `start` is always a multiple of `kElementsPerBlock`.
+        mask_bits[start / 8] |= static_cast<uint8_t>(
+            ((size_t{1} << kElementsPerBlock) - 1) << (start % 8));
+      }
+    }
+  }
+  return hn::LoadMaskBits(d, mask_bits);
+}
+#endif  // HWY_TARGET != HWY_SCALAR
+
+template <typename T>
+bool ApplyValueCorrectionHwyImpl(int64_t num_blocks,
+                                 const absl::uint128* hashed_expansion,
+                                 const uint64_t* control_bits,
+                                 const T* correction, bool negate, T* output) {
+#if HWY_TARGET == HWY_SCALAR
+  // Without SIMD support, the caller's scalar loop is just as fast.
+  return false;
+#else
+  const hn::ScalableTag<T> d;
+  constexpr size_t kElementsPerBlock = sizeof(absl::uint128) / sizeof(T);
+  const size_t lanes = hn::Lanes(d);
+  // Only run the vectorized version if vectors consist of whole blocks.
+  if (ABSL_PREDICT_FALSE(lanes < kElementsPerBlock ||
+                         lanes % kElementsPerBlock != 0)) {
+    return false;
+  }
+  // The correction constant repeats every 128 bits, so it can be broadcast
+  // across all blocks covered by a vector.
+  const auto correction_vec = hn::LoadDup128(d, correction);
+  const auto zero = hn::Zero(d);
+  const T* in = reinterpret_cast<const T*>(hashed_expansion);
+  const int64_t num_elements =
+      num_blocks * static_cast<int64_t>(kElementsPerBlock);
+
+  int64_t i = 0;
+  for (; i + static_cast<int64_t>(lanes) <= num_elements;
+       i += static_cast<int64_t>(lanes)) {
+    const auto mask =
+        MaskFromPackedControlBits(d, control_bits, i / kElementsPerBlock);
+    auto vec = hn::LoadU(d, in + i);
+    vec = hn::Add(vec, hn::IfThenElseZero(mask, correction_vec));
+    if (negate) {
+      vec = hn::Sub(zero, vec);
+    }
+    hn::StoreU(vec, d, output + i);
+  }
+
+  // Scalar tail for the remaining blocks that don't fill a whole vector.
+  for (; i < num_elements; ++i) {
+    const int64_t block = i / kElementsPerBlock;
+    T element = in[i];
+    if ((control_bits[block / 64] >> (block % 64)) & 1) {
+      element += correction[i % kElementsPerBlock];
+    }
+    if (negate) {
+      element = -element;
+    }
+    output[i] = element;
+  }
+  return true;
+#endif  // HWY_TARGET == HWY_SCALAR
+}
+
+// XOR variant of the above: corrections are XORed in at 64-bit word
+// granularity, with no negation step (negation is the identity under XOR
+// sharing). If `accumulate` is true, the corrected blocks are additionally
+// XORed with the previous contents of `output`.
+bool ApplyXorValueCorrectionHwy(int64_t num_blocks,
+                                const absl::uint128* hashed_expansion,
+                                const uint64_t* control_bits,
+                                const uint64_t* correction, bool accumulate,
+                                uint64_t* output) {
+#if HWY_TARGET == HWY_SCALAR
+  // Without SIMD support, the caller's scalar loop is just as fast.
+  return false;
+#else
+  const hn::ScalableTag<uint64_t> d;
+  constexpr size_t kWordsPerBlock = sizeof(absl::uint128) / sizeof(uint64_t);
+  const size_t lanes = hn::Lanes(d);
+  // Only run the vectorized version if vectors consist of whole blocks.
+  if (ABSL_PREDICT_FALSE(lanes < kWordsPerBlock ||
+                         lanes % kWordsPerBlock != 0)) {
+    return false;
+  }
+  // The correction block repeats every 128 bits, so it can be broadcast
+  // across all blocks covered by a vector.
+  const auto correction_vec = hn::LoadDup128(d, correction);
+  const uint64_t* in = reinterpret_cast<const uint64_t*>(hashed_expansion);
+  const int64_t num_words = num_blocks * static_cast<int64_t>(kWordsPerBlock);
+
+  int64_t i = 0;
+  for (; i + static_cast<int64_t>(lanes) <= num_words;
+       i += static_cast<int64_t>(lanes)) {
+    const auto mask =
+        MaskFromPackedControlBits(d, control_bits, i / kWordsPerBlock);
+    auto vec =
+        hn::Xor(hn::LoadU(d, in + i), hn::IfThenElseZero(mask, correction_vec));
+    if (accumulate) {
+      vec = hn::Xor(vec, hn::LoadU(d, output + i));
+    }
+    hn::StoreU(vec, d, output + i);
+  }
+
+  // Scalar tail for the remaining blocks that don't fill a whole vector.
+  for (; i < num_words; ++i) {
+    const int64_t block = i / static_cast<int64_t>(kWordsPerBlock);
+    uint64_t word = in[i];
+    if ((control_bits[block / 64] >> (block % 64)) & 1) {
+      word ^= correction[i % kWordsPerBlock];
+    }
+    if (accumulate) {
+      word ^= output[i];
+    }
+    output[i] = word;
+  }
+  return true;
+#endif  // HWY_TARGET == HWY_SCALAR
+}
+
+bool ApplyValueCorrectionUint8Hwy(int64_t num_blocks,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const uint8_t* correction, bool negate,
+                                  uint8_t* output) {
+  return ApplyValueCorrectionHwyImpl(num_blocks, hashed_expansion,
+                                     control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrectionUint16Hwy(int64_t num_blocks,
+                                   const absl::uint128* hashed_expansion,
+                                   const uint64_t* control_bits,
+                                   const uint16_t* correction, bool negate,
+                                   uint16_t* output) {
+  return ApplyValueCorrectionHwyImpl(num_blocks, hashed_expansion,
+                                     control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrectionUint32Hwy(int64_t num_blocks,
+                                   const absl::uint128* hashed_expansion,
+                                   const uint64_t* control_bits,
+                                   const uint32_t* correction, bool negate,
+                                   uint32_t* output) {
+  return ApplyValueCorrectionHwyImpl(num_blocks, hashed_expansion,
+                                     control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrectionUint64Hwy(int64_t num_blocks,
+                                   const absl::uint128* hashed_expansion,
+                                   const uint64_t* control_bits,
+                                   const uint64_t* correction, bool negate,
+                                   uint64_t* output) {
+  return ApplyValueCorrectionHwyImpl(num_blocks, hashed_expansion,
+                                     control_bits, correction, negate, output);
+}
+
+}  // namespace HWY_NAMESPACE
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE || HWY_IDE
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+// The kernels interpret the hashed blocks as little-endian element arrays,
+// matching `DirectlyFromBytes` in value_type_helpers.h only on little-endian
+// machines.
+constexpr bool kIsLittleEndian =
+#ifdef ABSL_IS_LITTLE_ENDIAN
+    true;
+#else
+    false;
+#endif
+
+template <typename T>
+bool ApplyValueCorrectionSelectedImpl(int64_t num_points,
+                                      const absl::uint128* hashed_expansion,
+                                      const uint64_t* control_bits,
+                                      const int* block_indices,
+                                      const T* correction, bool negate,
+                                      T* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  constexpr int64_t kElementsPerBlock = sizeof(absl::uint128) / sizeof(T);
+  const T* in = reinterpret_cast<const T*>(hashed_expansion);
+  for (int64_t i = 0; i < num_points; ++i) {
+    const int block_index = block_indices[i];
+    T element = in[i * kElementsPerBlock + block_index];
+    if ((control_bits[i / 64] >> (i % 64)) & 1) {
+      element += correction[block_index];
+    }
+    if (negate) {
+      element = -element;
+    }
+    output[i] = element;
+  }
+  return true;
+}
+
+}  // namespace
+
+HWY_EXPORT(ApplyXorValueCorrectionHwy);
+HWY_EXPORT(ApplyValueCorrectionUint8Hwy);
+HWY_EXPORT(ApplyValueCorrectionUint16Hwy);
+HWY_EXPORT(ApplyValueCorrectionUint32Hwy);
+HWY_EXPORT(ApplyValueCorrectionUint64Hwy);
+
+bool ApplyXorValueCorrection(int64_t num_blocks,
+                             const absl::uint128* hashed_expansion,
+                             const uint64_t* control_bits,
+                             const uint64_t* correction, bool accumulate,
+                             uint64_t* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_blocks == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(ApplyXorValueCorrectionHwy)(
+      num_blocks, hashed_expansion, control_bits, correction, accumulate,
+      output);
+}
+
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint8_t* correction, bool negate,
+                          uint8_t* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_blocks == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(ApplyValueCorrectionUint8Hwy)(
+      num_blocks, hashed_expansion, control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint16_t* correction, bool negate,
+                          uint16_t* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_blocks == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(ApplyValueCorrectionUint16Hwy)(
+      num_blocks, hashed_expansion, control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint32_t* correction, bool negate,
+                          uint32_t* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_blocks == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(ApplyValueCorrectionUint32Hwy)(
+      num_blocks, hashed_expansion, control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint64_t* correction, bool negate,
+                          uint64_t* output) {
+  if (!kIsLittleEndian) {
+    return false;
+  }
+  if (num_blocks == 0) {
+    return true;  // Nothing to do.
+  }
+  return HWY_DYNAMIC_DISPATCH(ApplyValueCorrectionUint64Hwy)(
+      num_blocks, hashed_expansion, control_bits, correction, negate, output);
+}
+
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint8_t* correction, bool negate,
+                                  uint8_t* output) {
+  return ApplyValueCorrectionSelectedImpl(num_points, hashed_expansion,
+                                          control_bits, block_indices,
+                                          correction, negate, output);
+}
+
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint16_t* correction, bool negate,
+                                  uint16_t* output) {
+  return ApplyValueCorrectionSelectedImpl(num_points, hashed_expansion,
+                                          control_bits, block_indices,
+                                          correction, negate, output);
+}
+
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint32_t* correction, bool negate,
+                                  uint32_t* output) {
+  return ApplyValueCorrectionSelectedImpl(num_points, hashed_expansion,
+                                          control_bits, block_indices,
+                                          correction, negate, output);
+}
+
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint64_t* correction, bool negate,
+                                  uint64_t* output) {
+  return ApplyValueCorrectionSelectedImpl(num_points, hashed_expansion,
+                                          control_bits, block_indices,
+                                          correction, negate, output);
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+#endif
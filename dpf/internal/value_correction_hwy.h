@@ -0,0 +1,177 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_VALUE_CORRECTION_HWY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_VALUE_CORRECTION_HWY_H_
+
+#include <cstdint>
+#include <type_traits>
+
+#include "absl/meta/type_traits.h"
+#include "absl/numeric/int128.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// True for output types that are handled by the vectorized value correction
+// kernels below, i.e., unsigned integers of at most 64 bits.
+template <typename T>
+constexpr bool has_vectorized_value_correction_v =
+    std::is_integral<T>::value && std::is_unsigned<T>::value &&
+    !std::is_same<T, bool>::value && sizeof(T) <= 8;
+
+// Applies the DPF output value correction to `num_blocks` hashed 128-bit
+// blocks. Each block packs 16 / sizeof(T) elements in little-endian order,
+// matching the layout produced by `HashExpandedSeeds` for unsigned integer
+// output types with a single block per seed. For every element of block `i`,
+// `correction` (one element per position in a block) is added if bit `i` of
+// the packed `control_bits` (bit `i % 64` of word `i / 64`, see
+// `PackedControlBits`) is set, the result is negated if `negate` is true, and
+// written to the corresponding position of `output`. `output` must hold
+// `num_blocks` full blocks of elements and may alias `hashed_expansion`.
+//
+// Returns true if the correction was applied, and false if no suitable SIMD
+// implementation is available on the current target (e.g., HWY_SCALAR, or a
+// big-endian machine where the vector lane layout does not match the byte
+// deserialization order). In the latter case `output` is left untouched and
+// the caller has to fall back to the scalar correction loop.
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint8_t* correction, bool negate,
+                          uint8_t* output);
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint16_t* correction, bool negate,
+                          uint16_t* output);
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint32_t* correction, bool negate,
+                          uint32_t* output);
+bool ApplyValueCorrection(int64_t num_blocks,
+                          const absl::uint128* hashed_expansion,
+                          const uint64_t* control_bits,
+                          const uint64_t* correction, bool negate,
+                          uint64_t* output);
+
+// Applies the value correction for XOR-shared output types (`XorWrapper<T>`
+// with unsigned integer `T`) to `num_blocks` hashed 128-bit blocks. Under XOR
+// sharing, group addition is a bitwise XOR and negation is the identity, so
+// the correction for both parties reduces to XORing the 16-byte `correction`
+// block into block `i` of `hashed_expansion` iff bit `i` of the packed
+// `control_bits` is set. This is independent of the element width, so the
+// kernel runs on whole 64-bit words regardless of `T`. `correction` and
+// `output` are the (possibly unaligned) element arrays reinterpreted as raw
+// 64-bit words; `correction` must span one full block and `output` must hold
+// `num_blocks` full blocks. If `accumulate` is true, the corrected blocks are
+// XORed into `output` instead of overwriting it, fusing the correction with
+// XOR-aggregation of the outputs.
+//
+// Returns false under the same conditions as `ApplyValueCorrection`.
+bool ApplyXorValueCorrection(int64_t num_blocks,
+                             const absl::uint128* hashed_expansion,
+                             const uint64_t* control_bits,
+                             const uint64_t* correction, bool accumulate,
+                             uint64_t* output);
+
+// As `ApplyValueCorrection`, but selects a single element per block: for each
+// point `i < num_points`, reads the element at position `block_indices[i]` of
+// the i-th block of `hashed_expansion`, corrects it with
+// `correction[block_indices[i]]` if bit `i` of `control_bits` is set, negates
+// it if `negate` is true, and writes it to `output[i]`. Since this is a
+// gather of one element per 16-byte block, it is bound by memory latency
+// rather than arithmetic and is therefore implemented as a scalar loop over
+// the reinterpreted element array; the win over the generic code is that it
+// avoids materializing a full std::array of elements per block.
+//
+// Returns false under the same conditions as `ApplyValueCorrection`.
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint8_t* correction, bool negate,
+                                  uint8_t* output);
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint16_t* correction, bool negate,
+                                  uint16_t* output);
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint32_t* correction, bool negate,
+                                  uint32_t* output);
+bool ApplyValueCorrectionSelected(int64_t num_points,
+                                  const absl::uint128* hashed_expansion,
+                                  const uint64_t* control_bits,
+                                  const int* block_indices,
+                                  const uint64_t* correction, bool negate,
+                                  uint64_t* output);
+
+// Type-generic entry points for the templated evaluation code in
+// distributed_point_function.h. Forward to the overloads above when `T` is
+// covered by the kernels, and return false (leaving `output` untouched) for
+// all other types, so that callers can keep a single scalar fallback path.
+template <typename T,
+          absl::enable_if_t<has_vectorized_value_correction_v<T>, int> = 0>
+bool TryApplyValueCorrection(int64_t num_blocks,
+                             const absl::uint128* hashed_expansion,
+                             const uint64_t* control_bits, const T* correction,
+                             bool negate, T* output) {
+  return ApplyValueCorrection(num_blocks, hashed_expansion, control_bits,
+                              correction, negate, output);
+}
+template <typename T,
+          absl::enable_if_t<!has_vectorized_value_correction_v<T>, int> = 0>
+bool TryApplyValueCorrection(int64_t /*num_blocks*/,
+                             const absl::uint128* /*hashed_expansion*/,
+                             const uint64_t* /*control_bits*/,
+                             const T* /*correction*/, bool /*negate*/,
+                             T* /*output*/) {
+  return false;
+}
+
+template <typename T,
+          absl::enable_if_t<has_vectorized_value_correction_v<T>, int> = 0>
+bool TryApplyValueCorrectionSelected(int64_t num_points,
+                                     const absl::uint128* hashed_expansion,
+                                     const uint64_t* control_bits,
+                                     const int* block_indices,
+                                     const T* correction, bool negate,
+                                     T* output) {
+  return ApplyValueCorrectionSelected(num_points, hashed_expansion,
+                                      control_bits, block_indices, correction,
+                                      negate, output);
+}
+template <typename T,
+          absl::enable_if_t<!has_vectorized_value_correction_v<T>, int> = 0>
+bool TryApplyValueCorrectionSelected(int64_t /*num_points*/,
+                                     const absl::uint128* /*hashed_expansion*/,
+                                     const uint64_t* /*control_bits*/,
+                                     const int* /*block_indices*/,
+                                     const T* /*correction*/, bool /*negate*/,
+                                     T* /*output*/) {
+  return false;
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_VALUE_CORRECTION_HWY_H_
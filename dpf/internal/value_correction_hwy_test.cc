@@ -0,0 +1,187 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/value_correction_hwy.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "dpf/internal/packed_control_bits.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+template <typename T>
+class ValueCorrectionHwyTest : public testing::Test {
+ protected:
+  static constexpr int kElementsPerBlock = sizeof(absl::uint128) / sizeof(T);
+
+  void SetUpInputs(int64_t num_blocks) {
+    blocks_.resize(num_blocks);
+    control_bits_.Resize(num_blocks);
+    for (int64_t i = 0; i < num_blocks; ++i) {
+      blocks_[i] = absl::MakeUint128(i * 0x0123456789abcdef, ~uint64_t{i});
+      control_bits_.Set(i, i % 3 == 0);
+    }
+    for (int j = 0; j < kElementsPerBlock; ++j) {
+      correction_[j] = static_cast<T>(j * j + 1);
+    }
+  }
+
+  // Reference implementation: per-element scalar correction, reading the
+  // little-endian element layout with memcpy.
+  std::vector<T> ExpectedFullBlocks(bool negate) const {
+    std::vector<T> expected(blocks_.size() * kElementsPerBlock);
+    for (int64_t i = 0; i < static_cast<int64_t>(blocks_.size()); ++i) {
+      for (int j = 0; j < kElementsPerBlock; ++j) {
+        T element;
+        std::memcpy(&element,
+                    reinterpret_cast<const char*>(&blocks_[i]) + j * sizeof(T),
+                    sizeof(T));
+        if (control_bits_[i]) {
+          element += correction_[j];
+        }
+        if (negate) {
+          element = -element;
+        }
+        expected[i * kElementsPerBlock + j] = element;
+      }
+    }
+    return expected;
+  }
+
+  std::vector<absl::uint128> blocks_;
+  PackedControlBits control_bits_;
+  T correction_[kElementsPerBlock];
+};
+
+using MyTypes = testing::Types<uint8_t, uint16_t, uint32_t, uint64_t>;
+TYPED_TEST_SUITE(ValueCorrectionHwyTest, MyTypes);
+
+TYPED_TEST(ValueCorrectionHwyTest, MatchesScalarCorrection) {
+  // Sizes chosen to exercise the vector loop and the scalar tail for all
+  // vector lengths up to 512 bits.
+  for (int64_t num_blocks : {0, 1, 2, 3, 5, 63, 64, 65, 1000}) {
+    for (bool negate : {false, true}) {
+      this->SetUpInputs(num_blocks);
+      std::vector<TypeParam> output(num_blocks * this->kElementsPerBlock);
+      if (!ApplyValueCorrection(num_blocks, this->blocks_.data(),
+                                this->control_bits_.words(),
+                                this->correction_, negate, output.data())) {
+        GTEST_SKIP() << "No suitable vectorized kernel on this target";
+      }
+      EXPECT_THAT(output, testing::ElementsAreArray(
+                              this->ExpectedFullBlocks(negate)))
+          << "num_blocks=" << num_blocks << ", negate=" << negate;
+    }
+  }
+}
+
+TYPED_TEST(ValueCorrectionHwyTest, InPlaceCorrectionMatches) {
+  constexpr int64_t kNumBlocks = 129;
+  this->SetUpInputs(kNumBlocks);
+  std::vector<TypeParam> expected = this->ExpectedFullBlocks(/*negate=*/true);
+  // Correct in place, aliasing the input blocks.
+  auto* output = reinterpret_cast<TypeParam*>(this->blocks_.data());
+  if (!ApplyValueCorrection(kNumBlocks, this->blocks_.data(),
+                            this->control_bits_.words(), this->correction_,
+                            /*negate=*/true, output)) {
+    GTEST_SKIP() << "No suitable vectorized kernel on this target";
+  }
+  EXPECT_THAT(std::vector<TypeParam>(
+                  output, output + kNumBlocks * this->kElementsPerBlock),
+              testing::ElementsAreArray(expected));
+}
+
+TYPED_TEST(ValueCorrectionHwyTest, SelectedMatchesScalarCorrection) {
+  constexpr int64_t kNumPoints = 200;
+  this->SetUpInputs(kNumPoints);
+  std::vector<int> block_indices(kNumPoints);
+  for (int64_t i = 0; i < kNumPoints; ++i) {
+    block_indices[i] = i % this->kElementsPerBlock;
+  }
+  for (bool negate : {false, true}) {
+    std::vector<TypeParam> expected_full = this->ExpectedFullBlocks(negate);
+    std::vector<TypeParam> output(kNumPoints);
+    if (!ApplyValueCorrectionSelected(
+            kNumPoints, this->blocks_.data(), this->control_bits_.words(),
+            block_indices.data(), this->correction_, negate, output.data())) {
+      GTEST_SKIP() << "No suitable kernel on this target";
+    }
+    for (int64_t i = 0; i < kNumPoints; ++i) {
+      EXPECT_EQ(output[i],
+                expected_full[i * this->kElementsPerBlock + block_indices[i]])
+          << "i=" << i << ", negate=" << negate;
+    }
+  }
+}
+
+TEST(ApplyXorValueCorrectionTest, MatchesScalarXor) {
+  const absl::uint128 correction =
+      absl::MakeUint128(0x0f0f0f0f0f0f0f0f, 0xfedcba9876543210);
+  // Sizes chosen to exercise the vector loop and the scalar tail for all
+  // vector lengths up to 512 bits.
+  for (int64_t num_blocks : {0, 1, 2, 3, 5, 63, 64, 65, 1000}) {
+    for (bool accumulate : {false, true}) {
+      std::vector<absl::uint128> blocks(num_blocks);
+      PackedControlBits control_bits;
+      control_bits.Resize(num_blocks);
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        blocks[i] = absl::MakeUint128(i * 0x0123456789abcdef, ~uint64_t{i});
+        control_bits.Set(i, i % 3 == 0);
+      }
+      // Start from a nonzero output to check that `accumulate` XORs into the
+      // previous contents instead of overwriting them.
+      std::vector<absl::uint128> output(num_blocks, absl::uint128{42});
+      std::vector<absl::uint128> expected(num_blocks);
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        expected[i] = blocks[i];
+        if (control_bits[i]) {
+          expected[i] ^= correction;
+        }
+        if (accumulate) {
+          expected[i] ^= output[i];
+        }
+      }
+      if (!ApplyXorValueCorrection(
+              num_blocks, blocks.data(), control_bits.words(),
+              reinterpret_cast<const uint64_t*>(&correction), accumulate,
+              reinterpret_cast<uint64_t*>(output.data()))) {
+        GTEST_SKIP() << "No suitable vectorized kernel on this target";
+      }
+      EXPECT_THAT(output, testing::ElementsAreArray(expected))
+          << "num_blocks=" << num_blocks << ", accumulate=" << accumulate;
+    }
+  }
+}
+
+TEST(ValueCorrectionHwyTest, TryApplyReturnsFalseForUnsupportedTypes) {
+  absl::uint128 block = 0;
+  uint64_t control_word = 0;
+  absl::uint128 correction = 0;
+  absl::uint128 output = 42;
+  EXPECT_FALSE(TryApplyValueCorrection(1, &block, &control_word, &correction,
+                                       /*negate=*/false, &output));
+  EXPECT_EQ(output, absl::uint128{42});
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -20,6 +20,7 @@
 #include "absl/meta/type_traits.h"
 #include "absl/numeric/int128.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "absl/utility/utility.h"
 #include "dpf/distributed_point_function.pb.h"
 #include "dpf/int_mod_n.h"
@@ -447,6 +448,16 @@ struct ValueTypeHelper<Tuple<ElementType...>, void> {
 // XorWrapper Helpers                                                         //
 /******************************************************************************/
 
+// Type trait for XOR-wrapped unsigned integers. For these types group addition
+// is a bitwise XOR and negation is the identity, which allows the evaluation
+// code to apply value corrections as plain XORs on whole 128-bit blocks.
+template <typename T>
+struct is_xor_wrapper : std::false_type {};
+template <typename T>
+struct is_xor_wrapper<XorWrapper<T>> : is_unsigned_integer<T> {};
+template <typename T>
+constexpr bool is_xor_wrapper_v = is_xor_wrapper<T>::value;
+
 template <typename T>
 struct ValueTypeHelper<XorWrapper<T>, void> {
   static constexpr bool IsSupportedType() {
@@ -588,21 +599,50 @@ std::array<T, ElementsPerBlock<T>()> ConvertBytesToArrayOf(
   return {FromBytes<T>(bytes)};
 }
 
+// Computes the elementwise difference `b - a` (or its negation, if `invert`
+// is true) used when computing value corrections, writing the result to `b`.
+template <typename T>
+void SubtractAndMaybeInvert(absl::Span<const T> a, absl::Span<T> b,
+                            bool invert) {
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = b[i] - a[i];
+    if (invert) {
+      b[i] = -b[i];
+    }
+  }
+}
+// Overload for IntModN, which uses the batched modular arithmetic kernels
+// from dpf/int_mod_n.h. Since negating a difference swaps its operands, the
+// inverted case is a single batched subtraction as well.
+template <typename BaseInteger, typename ModulusType, ModulusType kModulus>
+void SubtractAndMaybeInvert(
+    absl::Span<const IntModNImpl<BaseInteger, ModulusType, kModulus>> a,
+    absl::Span<IntModNImpl<BaseInteger, ModulusType, kModulus>> b,
+    bool invert) {
+  using IntModNType = IntModNImpl<BaseInteger, ModulusType, kModulus>;
+  if (invert) {
+    IntModNType::SubtractBatch(a, b, b);
+  } else {
+    IntModNType::SubtractBatch(b, a, b);
+  }
+}
+
 // Computes the value correction word given two seeds `seed_a`, `seed_b` for
 // parties a and b, such that the element at `block_index` is equal to `beta`.
 // If `invert` is true, the result is multiplied element-wise by -1. Templated
 // to use the correct integer type without needing modular reduction.
 //
 // Returns multiple values in case of packing, and a single value otherwise.
+//
+// This variant takes `beta` as a native element of type T. It cannot fail,
+// since no proto parsing is involved. Note that this is deliberately not an
+// overload of `ComputeValueCorrectionFor`, so that the latter can be assigned
+// to a `std::function` without an ambiguous overload set.
 template <typename T>
-absl::StatusOr<std::vector<Value>> ComputeValueCorrectionFor(
-    absl::string_view seed_a, absl::string_view seed_b, int block_index,
-    const Value& beta, bool invert) {
-  absl::StatusOr<T> beta_T = ValueTypeHelper<T>::FromValue(beta);
-  if (!beta_T.ok()) {
-    return beta_T.status();
-  }
-
+std::vector<Value> ComputeValueCorrectionForTyped(absl::string_view seed_a,
+                                                  absl::string_view seed_b,
+                                                  int block_index,
+                                                  const T& beta, bool invert) {
   constexpr int elements_per_block = ElementsPerBlock<T>();
 
   // Compute values from seeds. Both arrays will have multiple elements if T
@@ -611,15 +651,11 @@ absl::StatusOr<std::vector<Value>> ComputeValueCorrectionFor(
                                     ints_b = ConvertBytesToArrayOf<T>(seed_b);
 
   // Add beta to the right position.
-  ints_b[block_index] += *beta_T;
+  ints_b[block_index] += beta;
 
   // Add up shares, invert if needed.
-  for (int i = 0; i < elements_per_block; i++) {
-    ints_b[i] = ints_b[i] - ints_a[i];
-    if (invert) {
-      ints_b[i] = -ints_b[i];
-    }
-  }
+  SubtractAndMaybeInvert(absl::MakeConstSpan(ints_a), absl::MakeSpan(ints_b),
+                         invert);
 
   // Convert to a vector of Value protos and return.
   std::vector<Value> result;
@@ -630,6 +666,21 @@ absl::StatusOr<std::vector<Value>> ComputeValueCorrectionFor(
   return result;
 }
 
+// As above, but takes `beta` as a Value proto.
+//
+// Returns INVALID_ARGUMENT if `beta` cannot be converted to T.
+template <typename T>
+absl::StatusOr<std::vector<Value>> ComputeValueCorrectionFor(
+    absl::string_view seed_a, absl::string_view seed_b, int block_index,
+    const Value& beta, bool invert) {
+  absl::StatusOr<T> beta_T = ValueTypeHelper<T>::FromValue(beta);
+  if (!beta_T.ok()) {
+    return beta_T.status();
+  }
+  return ComputeValueCorrectionForTyped<T>(seed_a, seed_b, block_index, *beta_T,
+                                           invert);
+}
+
 // Computes the number of pseudorandom bits needed to get a uniform element of
 // the given `ValueType`. For types whose elements can be bijectively mapped to
 // strings (e.g., unsigned integers and tuples of integers), this is equivalent
@@ -14,6 +14,15 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <deque>
+#include <mutex>   // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/container/btree_map.h"
 #include "absl/container/btree_set.h"
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -48,6 +57,20 @@ ABSL_FLAG(bool, only_nonzeros, false,
 ABSL_FLAG(std::vector<std::string>, levels_to_evaluate, {},
           "List of integers specifying the log domain sizes at which to insert "
           "hierarchy levels.");
+ABSL_FLAG(std::vector<std::string>, input_shards, {},
+          "Comma-separated list of sharded CSV input files. If non-empty, runs "
+          "the streaming pipeline benchmark instead of a single evaluation: "
+          "reader threads stream the shards into a bounded task queue, "
+          "evaluator threads run the hierarchical evaluation per shard, and "
+          "per-bucket results are reduced in parallel. Mutually exclusive "
+          "with --input.");
+ABSL_FLAG(int, num_reader_threads, 2,
+          "Number of input reader threads in pipeline mode.");
+ABSL_FLAG(int, num_evaluator_threads, 4,
+          "Number of evaluation threads in pipeline mode.");
+ABSL_FLAG(int, queue_capacity, 16,
+          "Capacity of the bounded task queue between the reader and "
+          "evaluator stages in pipeline mode.");
 
 #ifndef QCHECK
 #define QCHECK(x) CHECK(x)
@@ -60,7 +83,10 @@ const char* Usage() {
          "Runs a single DPF key evaluation on the specified domain. If an "
          "input file is specified with --input, it is read as a CSV file "
          "containing the bucket IDs to expand in the first column. Otherwise, "
-         "the full domain will be expanded.";
+         "the full domain will be expanded. If --input_shards is specified, "
+         "runs a streaming pipeline over the given shards instead, modeling a "
+         "sharded aggregation job with concurrent readers, evaluators, and a "
+         "parallel reduction.";
 }
 
 void ValidateFlags() {
@@ -83,6 +109,18 @@ void ValidateFlags() {
     QCHECK(level > 0 && level <= log_domain_size)
         << "--levels_to_evaluate must be in [1, log_domain_size]";
   }
+  if (!absl::GetFlag(FLAGS_input_shards).empty()) {
+    QCHECK(absl::GetFlag(FLAGS_input).empty())
+        << "--input and --input_shards are mutually exclusive";
+    QCHECK(!absl::GetFlag(FLAGS_only_nonzeros))
+        << "--only_nonzeros is not supported in pipeline mode";
+  }
+  QCHECK(absl::GetFlag(FLAGS_num_reader_threads) >= 1)
+      << "--num_reader_threads must be positive";
+  QCHECK(absl::GetFlag(FLAGS_num_evaluator_threads) >= 1)
+      << "--num_evaluator_threads must be positive";
+  QCHECK(absl::GetFlag(FLAGS_queue_capacity) >= 1)
+      << "--queue_capacity must be positive";
 }
 
 // Returns the prefixes of the given `last_level_prefixes` for each bit-length
@@ -164,6 +202,218 @@ std::vector<int> ComputeLevelsToEvaluate(
   return levels_to_evaluate;
 }
 
+// A bounded FIFO queue connecting two pipeline stages. `Push` blocks while
+// the queue is at capacity, providing backpressure from the evaluators to the
+// readers; `Pop` blocks until an element is available or the queue is closed.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(int capacity) : capacity_(capacity) {}
+
+  void Push(T element) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] {
+      return static_cast<int>(elements_.size()) < capacity_;
+    });
+    elements_.push_back(std::move(element));
+    not_empty_.notify_one();
+  }
+
+  // Returns false when the queue has been closed and drained.
+  bool Pop(T& element) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !elements_.empty() || closed_; });
+    if (elements_.empty()) {
+      return false;
+    }
+    element = std::move(elements_.front());
+    elements_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  const int capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> elements_;
+  bool closed_ = false;
+};
+
+// One shard's worth of evaluation work, produced by a reader thread.
+struct EvaluationTask {
+  // Prefixes to pass to `EvaluateUntil` for each hierarchy level, in the same
+  // layout as `prefixes_to_evaluate` in the single-run mode.
+  std::vector<std::vector<absl::uint128>> prefixes_per_level;
+  // The shard's nonzero buckets at the last hierarchy level, sorted.
+  std::vector<absl::uint128> nonzeros;
+};
+
+// Per-stage busy time and item counters, aggregated across all threads of a
+// stage with relaxed atomics.
+struct StageCounters {
+  std::atomic<int64_t> nanos{0};
+  std::atomic<int64_t> items{0};
+
+  void Record(absl::Duration elapsed, int64_t num_items) {
+    nanos.fetch_add(absl::ToInt64Nanoseconds(elapsed),
+                    std::memory_order_relaxed);
+    items.fetch_add(num_items, std::memory_order_relaxed);
+  }
+};
+
+void LogStageThroughput(absl::string_view stage, const StageCounters& counters,
+                        absl::string_view unit) {
+  const double seconds = counters.nanos.load() * 1e-9;
+  LOG(INFO) << stage << ": " << counters.items.load() << " " << unit << " in "
+            << seconds << " busy-seconds across all threads ("
+            << (seconds > 0 ? counters.items.load() / seconds : 0) << " "
+            << unit << "/s)";
+}
+
+// Runs the streaming pipeline: `num_reader_threads` threads read the
+// `shards` round-robin (each shard `num_iterations` times) and push
+// evaluation tasks into a bounded queue; `num_evaluator_threads` threads pop
+// tasks, run the hierarchical evaluation, and reduce the values at each
+// shard's nonzero buckets into thread-local per-bucket totals, which are
+// merged at the end. Reports per-stage throughput.
+template <typename T>
+void RunPipeline(
+    const distributed_point_functions::DistributedPointFunction& dpf,
+    const distributed_point_functions::DpfKey& key,
+    absl::Span<const std::string> shards,
+    absl::Span<const int> levels_to_evaluate, int log_domain_size,
+    int num_iterations) {
+  const distributed_point_functions::EvaluationContext ctx =
+      dpf.CreateEvaluationContext(key).value();
+  const int num_levels = static_cast<int>(levels_to_evaluate.size());
+  CHECK_EQ(num_levels, ctx.parameters_size());
+
+  const int num_reader_threads = absl::GetFlag(FLAGS_num_reader_threads);
+  const int num_evaluator_threads = absl::GetFlag(FLAGS_num_evaluator_threads);
+  BoundedQueue<EvaluationTask> queue(absl::GetFlag(FLAGS_queue_capacity));
+  StageCounters read_counters, evaluate_counters, reduce_counters;
+
+  const int64_t total_tasks =
+      static_cast<int64_t>(shards.size()) * num_iterations;
+  std::atomic<int64_t> next_task{0};
+
+  // Reader stage: claim tasks from a shared counter, so fast readers steal
+  // work from slow ones, then parse the shard and derive its prefixes.
+  auto reader_fn = [&] {
+    int64_t task_index;
+    while ((task_index = next_task.fetch_add(1)) < total_tasks) {
+      const absl::Time start = absl::Now();
+      absl::btree_set<absl::uint128> nonzeros =
+          ReadUniqueValuesFromFile(shards[task_index % shards.size()]);
+      std::vector<std::vector<absl::uint128>> prefixes =
+          ComputePrefixes(nonzeros, log_domain_size);
+      EvaluationTask task;
+      task.prefixes_per_level.resize(num_levels);
+      for (int i = 1; i < num_levels; ++i) {
+        task.prefixes_per_level[i] = prefixes[levels_to_evaluate[i - 1]];
+      }
+      task.nonzeros = std::move(prefixes[levels_to_evaluate.back()]);
+      read_counters.Record(absl::Now() - start, task.nonzeros.size());
+      queue.Push(std::move(task));
+    }
+  };
+
+  // Evaluator stage: hierarchical evaluation per task, then reduction of the
+  // values at the task's nonzero buckets into thread-local totals.
+  std::vector<absl::btree_map<absl::uint128, T>> local_totals(
+      num_evaluator_threads);
+  auto evaluator_fn = [&](absl::btree_map<absl::uint128, T>& totals) {
+    EvaluationTask task;
+    while (queue.Pop(task)) {
+      absl::Time start = absl::Now();
+      distributed_point_functions::EvaluationContext ctx_copy = ctx;
+      std::vector<T> result;
+      int64_t outputs_produced = 0;
+      for (int level = 0; level < num_levels; ++level) {
+        result =
+            dpf.EvaluateUntil<T>(level, task.prefixes_per_level[level], ctx_copy)
+                .value();
+        outputs_produced += result.size();
+      }
+      evaluate_counters.Record(absl::Now() - start, outputs_produced);
+
+      // Locate each nonzero bucket in the last expansion: the outputs of
+      // prefix j of the previous level occupy indices [j << shift,
+      // (j + 1) << shift). With a single hierarchy level, the expansion
+      // covers the full domain and buckets are their own indices.
+      start = absl::Now();
+      const std::vector<absl::uint128>& previous_prefixes =
+          task.prefixes_per_level.back();
+      const int shift =
+          num_levels > 1
+              ? levels_to_evaluate[num_levels - 1] -
+                    levels_to_evaluate[num_levels - 2]
+              : 0;
+      for (const absl::uint128& bucket : task.nonzeros) {
+        int64_t index;
+        if (num_levels == 1) {
+          index = static_cast<int64_t>(bucket);
+        } else {
+          const auto it =
+              std::lower_bound(previous_prefixes.begin(),
+                               previous_prefixes.end(), bucket >> shift);
+          CHECK(it != previous_prefixes.end() && *it == bucket >> shift);
+          index = ((it - previous_prefixes.begin()) << shift) +
+                  static_cast<int64_t>(bucket &
+                                       ((absl::uint128{1} << shift) - 1));
+        }
+        totals[bucket] += result[index];
+      }
+      reduce_counters.Record(absl::Now() - start, task.nonzeros.size());
+    }
+  };
+
+  const absl::Time pipeline_start = absl::Now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_reader_threads + num_evaluator_threads);
+  for (int i = 0; i < num_evaluator_threads; ++i) {
+    threads.emplace_back(evaluator_fn, std::ref(local_totals[i]));
+  }
+  for (int i = 0; i < num_reader_threads; ++i) {
+    threads.emplace_back(reader_fn);
+  }
+  // Readers are at the end of `threads`; join them first, then close the
+  // queue so the evaluators drain and exit.
+  for (int i = 0; i < num_reader_threads; ++i) {
+    threads[num_evaluator_threads + i].join();
+  }
+  queue.Close();
+  for (int i = 0; i < num_evaluator_threads; ++i) {
+    threads[i].join();
+  }
+
+  // Final merge of the thread-local totals.
+  const absl::Time merge_start = absl::Now();
+  absl::btree_map<absl::uint128, T> totals;
+  for (absl::btree_map<absl::uint128, T>& local : local_totals) {
+    for (const auto& [bucket, value] : local) {
+      totals[bucket] += value;
+    }
+  }
+  reduce_counters.Record(absl::Now() - merge_start, 0);
+  benchmark::DoNotOptimize(totals);
+  const absl::Duration wallclock = absl::Now() - pipeline_start;
+
+  LOG(INFO) << "Pipeline processed " << total_tasks << " shard tasks in "
+            << wallclock << " (" << totals.size() << " distinct buckets)";
+  LogStageThroughput("Reader stage", read_counters, "nonzeros");
+  LogStageThroughput("Evaluation stage", evaluate_counters, "outputs");
+  LogStageThroughput("Reduction stage", reduce_counters, "buckets");
+}
+
 // Evaluates the given `key` for `dpf` at each hierarchy level, using the given
 // `prefixes` for each level. Repeats `num_iterations` times.
 template <typename T>
@@ -287,6 +537,12 @@ int main(int argc, char* argv[]) {
   // Run the experiment and measure time.
   int num_iterations = absl::GetFlag(FLAGS_num_iterations);
   using T = uint32_t;
+  std::vector<std::string> input_shards = absl::GetFlag(FLAGS_input_shards);
+  if (!input_shards.empty()) {
+    RunPipeline<T>(*dpf, key, input_shards, levels_to_evaluate, log_domain_size,
+                   num_iterations);
+    return 0;
+  }
   absl::Time start = absl::Now();
   if (only_nonzeros) {
     RunBatchedSinglePointEvaluation<T>(*dpf, key, prefixes.back(),